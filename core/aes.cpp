@@ -1,6 +1,12 @@
 #include <assert.h>
 #include "aes.h"
 
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || defined(__GNUC__))
+#	define BEAM_AES_X86
+#	include <immintrin.h>
+#	include <cpuid.h>
+#endif
+
 /*
 *  FIPS-197 compliant AES implementation
 *
@@ -822,8 +828,107 @@ void AES::StreamCipher::PerfXor(uint8_t* pBuf, uint32_t nSize)
 	m_nBuf -= (uint8_t) nSize;
 }
 
+#ifdef BEAM_AES_X86
+
+namespace AesNi
+{
+#define BEAM_AESNI_FN __attribute__((target("aes,sse2")))
+
+	// The portable round keys are big-endian words
+	BEAM_AESNI_FN static void LoadKeys(__m128i* pRk, const uint32_t* pErk)
+	{
+		for (int i = 0; i <= AES::Nr; i++, pErk += 4)
+			pRk[i] = _mm_set_epi32(
+				(int) __builtin_bswap32(pErk[3]),
+				(int) __builtin_bswap32(pErk[2]),
+				(int) __builtin_bswap32(pErk[1]),
+				(int) __builtin_bswap32(pErk[0]));
+	}
+
+	template <uint32_t nLanes>
+	BEAM_AESNI_FN static void XCryptN(const __m128i* pRk, beam::uintBig_t<AES::s_BlockSize>& ctr, uint8_t* pBuf)
+	{
+		__m128i pX[nLanes];
+		for (uint32_t j = 0; j < nLanes; j++)
+		{
+			pX[j] = _mm_xor_si128(_mm_loadu_si128((const __m128i*) ctr.m_pData), pRk[0]);
+			ctr.Inc();
+		}
+
+		for (int i = 1; i < AES::Nr; i++)
+			for (uint32_t j = 0; j < nLanes; j++)
+				pX[j] = _mm_aesenc_si128(pX[j], pRk[i]);
+
+		for (uint32_t j = 0; j < nLanes; j++)
+		{
+			__m128i* p = ((__m128i*) pBuf) + j;
+			__m128i x = _mm_aesenclast_si128(pX[j], pRk[AES::Nr]);
+			_mm_storeu_si128(p, _mm_xor_si128(x, _mm_loadu_si128(p)));
+		}
+	}
+
+	BEAM_AESNI_FN static void XCryptBlocks(const AES::Encoder& enc, beam::uintBig_t<AES::s_BlockSize>& ctr, uint8_t* pBuf, uint32_t nBlocks)
+	{
+		const uint32_t nLanes = 8;
+
+		__m128i pRk[AES::Nr + 1];
+		LoadKeys(pRk, enc.m_erk);
+
+		for (; nBlocks >= nLanes; nBlocks -= nLanes, pBuf += AES::s_BlockSize * nLanes)
+			XCryptN<nLanes>(pRk, ctr, pBuf);
+
+		for (; nBlocks; nBlocks--, pBuf += AES::s_BlockSize)
+			XCryptN<1>(pRk, ctr, pBuf);
+	}
+
+} // namespace AesNi
+
+#endif // BEAM_AES_X86
+
+AES::Impl::Enum AES::get_ImplMax()
+{
+#ifdef BEAM_AES_X86
+	__builtin_cpu_init(); // may be called during static initialization
+
+	unsigned int a, b, c, d;
+	if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_AES))
+		return Impl::AesNi;
+#endif // BEAM_AES_X86
+
+	return Impl::Portable;
+}
+
+AES::Impl::Enum AES::s_Impl = AES::get_ImplMax();
+
 void AES::StreamCipher::XCrypt(const Encoder& enc, uint8_t* pBuf, uint32_t nSize)
 {
+#ifdef BEAM_AES_X86
+	if (Impl::AesNi == s_Impl)
+	{
+		// use the remaining cipherstream, then the whole blocks in parallel. The tail is handled normally
+		if (m_nBuf)
+		{
+			uint8_t n = (m_nBuf < nSize) ? m_nBuf : (uint8_t) nSize;
+			PerfXor(pBuf, n);
+
+			pBuf += n;
+			nSize -= n;
+		}
+
+		uint32_t nBlocks = nSize / s_BlockSize;
+		if (nBlocks)
+		{
+			AesNi::XCryptBlocks(enc, m_Counter, pBuf, nBlocks);
+
+			pBuf += nBlocks * s_BlockSize;
+			nSize -= nBlocks * s_BlockSize;
+		}
+
+		if (!nSize)
+			return;
+	}
+#endif // BEAM_AES_X86
+
 	while (true)
 	{
 		if (!m_nBuf)
@@ -22,6 +22,16 @@ struct AES
 		void Proceed(uint8_t* pDst, const uint8_t* pSrc) const;
 	};
 
+	struct Impl {
+		enum Enum {
+			Portable,
+			AesNi, // 8 blocks in parallel
+		};
+	};
+
+	static Impl::Enum s_Impl; // best supported by the CPU, may be lowered (for tests)
+	static Impl::Enum get_ImplMax();
+
 	struct StreamCipher
 	{
 		beam::uintBig_t<s_BlockSize> m_Counter; // CTR mode
@@ -2352,6 +2352,12 @@ namespace beam
 		return ret ? ret : 1;
 	}
 
+	uint64_t GetTime_us()
+	{
+		using namespace std::chrono;
+		return (uint64_t)duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+	}
+
 	/////////////
 	// Asset
 	void Asset::Base::get_Generator(ECC::Point::Native& res, ECC::Point::Storage& res_s) const
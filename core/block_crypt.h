@@ -49,6 +49,7 @@ namespace beam
 	Timestamp getTimestamp();
 	uint32_t GetTime_ms(); // platform-independent GetTickCount
 	uint32_t GetTimeNnz_ms(); // guaranteed non-zero
+	uint64_t GetTime_us(); // monotonic, for profiling/stats
 
 	void HeightAdd(Height& trg, Height val); // saturates if overflow
 
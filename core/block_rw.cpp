@@ -15,6 +15,7 @@
 //#include <ctime>
 #include "block_rw.h"
 #include "utility/serialize.h"
+#include "utility/executor.h"
 #include "utilstrencodings.h"
 #include "serialization_adapters.h"
 #include "shielded.h"
@@ -585,6 +586,17 @@ namespace beam
 		return true;
 	}
 
+	static bool RecognizeShieldedOut(ShieldedTxo::DataParams& pars, const ShieldedTxo& txo, const ECC::Hash::Value& hvMsg, const ShieldedTxo::Viewer& viewer)
+	{
+		if (!pars.m_Serial.Recover(txo.m_Serial, viewer))
+			return false;
+
+		ECC::Oracle oracle;
+		oracle << hvMsg;
+
+		return pars.m_Output.Recover(txo, pars.m_Serial.m_SharedSecret, oracle, viewer);
+	}
+
 	bool RecoveryInfo::IRecognizer::OnUtxo(Height h, const Output& outp)
 	{
 		if (m_pOwner)
@@ -602,25 +614,203 @@ namespace beam
 		if (m_pViewer)
 		{
 			ShieldedTxo::DataParams pars;
+			if (RecognizeShieldedOut(pars, txo, hvMsg, *m_pViewer))
+				return OnShieldedOutRecognized(dout, pars);
+		}
+
+		return true;
+	}
+
+	bool RecoveryInfo::IRecognizer::OnAsset(Asset::Full& ai)
+	{
+		if (m_pOwner && ai.Recognize(*m_pOwner))
+			return OnAssetRecognized(ai);
+
+		return true;
+	}
+
+	/////////////////////////////
+	// RecoveryInfo::IRecognizerMulti
+	struct RecoveryInfo::IRecognizerMulti::Chunk
+	{
+		struct ShieldedOut
+		{
+			ShieldedTxo::DescriptionOutp m_Desc;
+			ShieldedTxo m_Txo;
+			ECC::Hash::Value m_hvMsg;
+		};
+
+		struct Match
+		{
+			uint32_t m_iOwner;
+			CoinID m_Cid;
+			ShieldedTxo::DataParams m_Pars;
+		};
 
-			if (pars.m_Serial.Recover(txo.m_Serial, *m_pViewer))
+		// only one of the elements is set
+		struct Item
+		{
+			Height m_Height;
+			Output::Ptr m_pUtxo;
+			std::unique_ptr<ShieldedOut> m_pShieldedOut;
+			std::unique_ptr<ShieldedTxo::DescriptionInp> m_pShieldedIn;
+
+			std::vector<Match> m_vMatches; // filled in parallel
+		};
+
+		std::vector<Item> m_vItems;
+
+		static void Recognize(Item&, const std::vector<Owner>&);
+
+		struct Task
+			:public Executor::TaskSync
+		{
+			Chunk* m_pThis;
+			const std::vector<Owner>* m_pOwners;
+
+			virtual void Exec(Executor::Context& ctx) override
+			{
+				uint32_t i0, nCount;
+				ctx.get_Portion(i0, nCount, static_cast<uint32_t>(m_pThis->m_vItems.size()));
+
+				for (uint32_t i = 0; i < nCount; i++)
+					Recognize(m_pThis->m_vItems[i0 + i], *m_pOwners);
+			}
+		};
+	};
+
+	void RecoveryInfo::IRecognizerMulti::Chunk::Recognize(Item& x, const std::vector<Owner>& vOwners)
+	{
+		for (uint32_t iOwner = 0; iOwner < vOwners.size(); iOwner++)
+		{
+			const Owner& owner = vOwners[iOwner];
+
+			if (x.m_pUtxo)
 			{
-				ECC::Oracle oracle;
-				oracle << hvMsg;
+				CoinID cid;
+				if (owner.m_pOwner && x.m_pUtxo->Recover(x.m_Height, *owner.m_pOwner, cid))
+				{
+					Match& m = x.m_vMatches.emplace_back();
+					m.m_iOwner = iOwner;
+					m.m_Cid = cid;
+				}
+			}
 
-				if (pars.m_Output.Recover(txo, pars.m_Serial.m_SharedSecret, oracle, *m_pViewer))
-					return OnShieldedOutRecognized(dout, pars);
+			if (x.m_pShieldedOut && owner.m_pViewer)
+			{
+				ShieldedTxo::DataParams pars;
+				if (RecognizeShieldedOut(pars, x.m_pShieldedOut->m_Txo, x.m_pShieldedOut->m_hvMsg, *owner.m_pViewer))
+				{
+					Match& m = x.m_vMatches.emplace_back();
+					m.m_iOwner = iOwner;
+					m.m_Pars = pars;
+				}
 			}
 		}
+	}
+
+	RecoveryInfo::IRecognizerMulti::IRecognizerMulti()
+		:m_pChunk(std::make_unique<Chunk>())
+	{
+	}
+
+	RecoveryInfo::IRecognizerMulti::~IRecognizerMulti()
+	{
+	}
+
+	bool RecoveryInfo::IRecognizerMulti::Proceed(const char* sz)
+	{
+		m_pChunk->m_vItems.clear();
+
+		return
+			IParser::Proceed(sz) &&
+			FlushChunk();
+	}
+
+	bool RecoveryInfo::IRecognizerMulti::OnUtxo(Height h, const Output& outp)
+	{
+		Chunk::Item& x = m_pChunk->m_vItems.emplace_back();
+		x.m_Height = h;
+		x.m_pUtxo = std::make_unique<Output>();
+		*x.m_pUtxo = outp;
+
+		return (m_pChunk->m_vItems.size() < m_ChunkSize) || FlushChunk();
+	}
+
+	bool RecoveryInfo::IRecognizerMulti::OnShieldedOut(const ShieldedTxo::DescriptionOutp& dout, const ShieldedTxo& txo, const ECC::Hash::Value& hvMsg)
+	{
+		Chunk::Item& x = m_pChunk->m_vItems.emplace_back();
+		x.m_pShieldedOut = std::make_unique<Chunk::ShieldedOut>();
+		x.m_pShieldedOut->m_Desc = dout;
+		x.m_pShieldedOut->m_Txo = txo;
+		x.m_pShieldedOut->m_hvMsg = hvMsg;
+
+		return (m_pChunk->m_vItems.size() < m_ChunkSize) || FlushChunk();
+	}
+
+	bool RecoveryInfo::IRecognizerMulti::OnShieldedIn(const ShieldedTxo::DescriptionInp& din)
+	{
+		// nothing to recognize, but must be reported in order with the outputs
+		Chunk::Item& x = m_pChunk->m_vItems.emplace_back();
+		x.m_pShieldedIn = std::make_unique<ShieldedTxo::DescriptionInp>(din);
+
+		return (m_pChunk->m_vItems.size() < m_ChunkSize) || FlushChunk();
+	}
+
+	bool RecoveryInfo::IRecognizerMulti::OnAsset(Asset::Full& ai)
+	{
+		// assets are few, no need to parallelize
+		if (!FlushChunk())
+			return false;
+
+		for (uint32_t iOwner = 0; iOwner < m_vOwners.size(); iOwner++)
+		{
+			const Owner& owner = m_vOwners[iOwner];
+			if (owner.m_pOwner && ai.Recognize(*owner.m_pOwner) && !OnAssetRecognized(iOwner, ai))
+				return false;
+		}
 
 		return true;
 	}
 
-	bool RecoveryInfo::IRecognizer::OnAsset(Asset::Full& ai)
+	bool RecoveryInfo::IRecognizerMulti::FlushChunk()
 	{
-		if (m_pOwner && ai.Recognize(*m_pOwner))
-			return OnAssetRecognized(ai);
+		Chunk& c = *m_pChunk;
+
+		if (Executor::s_pInstance)
+		{
+			Chunk::Task t;
+			t.m_pThis = &c;
+			t.m_pOwners = &m_vOwners;
+			Executor::s_pInstance->ExecAll(t);
+		}
+		else
+		{
+			for (size_t i = 0; i < c.m_vItems.size(); i++)
+				Chunk::Recognize(c.m_vItems[i], m_vOwners);
+		}
+
+		for (size_t i = 0; i < c.m_vItems.size(); i++)
+		{
+			Chunk::Item& x = c.m_vItems[i];
+
+			if (x.m_pShieldedIn && !OnShieldedInOrdered(*x.m_pShieldedIn))
+				return false;
+
+			for (size_t j = 0; j < x.m_vMatches.size(); j++)
+			{
+				Chunk::Match& m = x.m_vMatches[j];
+
+				bool bOk = x.m_pUtxo ?
+					OnUtxoRecognized(m.m_iOwner, x.m_Height, *x.m_pUtxo, m.m_Cid) :
+					OnShieldedOutRecognized(m.m_iOwner, x.m_pShieldedOut->m_Desc, m.m_Pars);
+
+				if (!bOk)
+					return false;
+			}
+		}
 
+		c.m_vItems.clear();
 		return true;
 	}
 
@@ -78,6 +78,43 @@ namespace beam
 			virtual bool OnShieldedOutRecognized(const ShieldedTxo::DescriptionOutp&, const ShieldedTxo::DataParams&) { return true; }
 			virtual bool OnAssetRecognized(Asset::Full&) { return true; }
 		};
+
+		// Recognizes the elements of several owners in a single pass. Parsed utxos and shielded in/outs are collected in chunks,
+		// each chunk is recognized in parallel (by the current Executor, if any), then the results are reported in the file order.
+		struct IRecognizerMulti
+			:public IParser
+		{
+			struct Owner
+			{
+				Key::IPKdf::Ptr m_pOwner;
+				const ShieldedTxo::Viewer* m_pViewer = nullptr;
+			};
+
+			std::vector<Owner> m_vOwners;
+			uint32_t m_ChunkSize = 2048;
+
+			IRecognizerMulti();
+			~IRecognizerMulti();
+
+			bool Proceed(const char*); // also flushes the last chunk
+
+			virtual bool OnUtxo(Height, const Output&) override;
+			virtual bool OnShieldedOut(const ShieldedTxo::DescriptionOutp&, const ShieldedTxo&, const ECC::Hash::Value& hvMsg) override;
+			virtual bool OnShieldedIn(const ShieldedTxo::DescriptionInp&) override;
+			virtual bool OnAsset(Asset::Full&) override;
+
+			// called in the file order, on the parsing thread
+			virtual bool OnUtxoRecognized(uint32_t iOwner, Height, const Output&, CoinID&) { return true; }
+			virtual bool OnShieldedOutRecognized(uint32_t iOwner, const ShieldedTxo::DescriptionOutp&, const ShieldedTxo::DataParams&) { return true; }
+			virtual bool OnShieldedInOrdered(const ShieldedTxo::DescriptionInp&) { return true; }
+			virtual bool OnAssetRecognized(uint32_t iOwner, Asset::Full&) { return true; }
+
+		private:
+			struct Chunk;
+			std::unique_ptr<Chunk> m_pChunk;
+
+			bool FlushChunk();
+		};
 	};
 
 }
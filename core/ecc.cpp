@@ -633,6 +633,15 @@ namespace ECC {
 		get_As(ge, ptNormalized);
 		secp256k1_ge_to_storage(&ge_s, &ge);
 	}
+
+	void Point::Native::BatchNormalizer::get_As(Point& v, const Point::Native& ptNormalized)
+	{
+		secp256k1_ge ge;
+		get_As(ge, ptNormalized);
+		secp256k1_fe_normalize(&ge.x);
+		secp256k1_fe_normalize(&ge.y);
+		ExportEx(v, ge);
+	}
 
 	void Point::Native::BatchNormalizer_Arr::get_At(Element& el, uint32_t iIdx)
 	{
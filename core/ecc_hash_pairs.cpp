@@ -0,0 +1,323 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "common.h"
+#include "ecc_native.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || defined(__GNUC__))
+#	define BEAM_HASH_PAIRS_X86
+#	include <immintrin.h>
+#	include <cpuid.h>
+#endif
+
+namespace ECC
+{
+#ifdef BEAM_HASH_PAIRS_X86
+
+	// Multi-buffer SHA-256 for 64-byte messages. The message fills exactly one block, the 2nd block is the constant padding.
+	namespace Sha256
+	{
+		static const uint32_t s_pK[64] = {
+			0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+			0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+			0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+			0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+			0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+			0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+			0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+			0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+		};
+
+		static const uint32_t s_pInit[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+
+		// padding block for a 64-byte message: 0x80 marker, zeroes, and the length in bits
+		static const uint32_t s_pPad[16] = {
+			0x80000000, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 512
+		};
+
+		// The padding block message schedule is constant, it's pre-added to the round constants
+		struct PadSchedule
+		{
+			uint32_t m_pWK[64];
+
+			static uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+			PadSchedule()
+			{
+				uint32_t pW[64];
+				for (int i = 0; i < 16; i++)
+					pW[i] = s_pPad[i];
+
+				for (int i = 16; i < 64; i++)
+				{
+					uint32_t s0 = Rotr(pW[i - 15], 7) ^ Rotr(pW[i - 15], 18) ^ (pW[i - 15] >> 3);
+					uint32_t s1 = Rotr(pW[i - 2], 17) ^ Rotr(pW[i - 2], 19) ^ (pW[i - 2] >> 10);
+					pW[i] = pW[i - 16] + s0 + pW[i - 7] + s1;
+				}
+
+				for (int i = 0; i < 64; i++)
+					m_pWK[i] = pW[i] + s_pK[i];
+			}
+		};
+
+		static const PadSchedule s_PadSchedule;
+
+		static uint32_t LoadBE(const uint8_t* p)
+		{
+			return
+				(uint32_t(p[0]) << 24) |
+				(uint32_t(p[1]) << 16) |
+				(uint32_t(p[2]) << 8) |
+				uint32_t(p[3]);
+		}
+
+		static void StoreBE(uint8_t* p, uint32_t x)
+		{
+			p[0] = uint8_t(x >> 24);
+			p[1] = uint8_t(x >> 16);
+			p[2] = uint8_t(x >> 8);
+			p[3] = uint8_t(x);
+		}
+
+		/////////////////////
+		// AVX2, 8 messages at once, each 32-bit lane is a separate message
+		namespace Avx2
+		{
+			static const uint32_t s_Lanes = 8;
+
+#define BEAM_AVX2_FN __attribute__((target("avx2")))
+
+			BEAM_AVX2_FN static inline __m256i Rotr(__m256i x, int n)
+			{
+				return _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n));
+			}
+
+			BEAM_AVX2_FN static inline __m256i Sigma0(__m256i x) { return _mm256_xor_si256(_mm256_xor_si256(Rotr(x, 7), Rotr(x, 18)), _mm256_srli_epi32(x, 3)); }
+			BEAM_AVX2_FN static inline __m256i Sigma1(__m256i x) { return _mm256_xor_si256(_mm256_xor_si256(Rotr(x, 17), Rotr(x, 19)), _mm256_srli_epi32(x, 10)); }
+
+			BEAM_AVX2_FN static inline void Round(__m256i* pS, __m256i wk)
+			{
+				// pS is the state, rotated in-place: a, b, c, d, e, f, g, h
+				__m256i a = pS[0], b = pS[1], c = pS[2], e = pS[4], f = pS[5], g = pS[6];
+
+				__m256i s1 = _mm256_xor_si256(_mm256_xor_si256(Rotr(e, 6), Rotr(e, 11)), Rotr(e, 25));
+				__m256i ch = _mm256_xor_si256(g, _mm256_and_si256(e, _mm256_xor_si256(f, g)));
+				__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(pS[7], s1), _mm256_add_epi32(ch, wk));
+
+				__m256i s0 = _mm256_xor_si256(_mm256_xor_si256(Rotr(a, 2), Rotr(a, 13)), Rotr(a, 22));
+				__m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+				__m256i t2 = _mm256_add_epi32(s0, maj);
+
+				pS[7] = g;
+				pS[6] = f;
+				pS[5] = e;
+				pS[4] = _mm256_add_epi32(pS[3], t1);
+				pS[3] = c;
+				pS[2] = b;
+				pS[1] = a;
+				pS[0] = _mm256_add_epi32(t1, t2);
+			}
+
+			BEAM_AVX2_FN static void Process8(const Hash::Processor::Pair* p)
+			{
+				__m256i pW[16];
+				uint32_t pTmp[s_Lanes];
+
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					for (uint32_t j = 0; j < s_Lanes; j++)
+					{
+						const Hash::Value& hv = (i < 8) ? *p[j].m_pL : *p[j].m_pR;
+						pTmp[j] = LoadBE(hv.m_pData + ((i & 7) << 2));
+					}
+					pW[i] = _mm256_loadu_si256((const __m256i*) pTmp);
+				}
+
+				__m256i pS[8], pS0[8];
+				for (uint32_t i = 0; i < 8; i++)
+					pS[i] = _mm256_set1_epi32(s_pInit[i]);
+
+				// message block
+				for (uint32_t i = 0; i < 64; i++)
+				{
+					__m256i& w = pW[i & 15];
+					if (i >= 16)
+						w = _mm256_add_epi32(
+							_mm256_add_epi32(w, Sigma0(pW[(i - 15) & 15])),
+							_mm256_add_epi32(pW[(i - 7) & 15], Sigma1(pW[(i - 2) & 15])));
+
+					Round(pS, _mm256_add_epi32(w, _mm256_set1_epi32(s_pK[i])));
+				}
+
+				for (uint32_t i = 0; i < 8; i++)
+					pS0[i] = pS[i] = _mm256_add_epi32(pS[i], _mm256_set1_epi32(s_pInit[i]));
+
+				// padding block
+				for (uint32_t i = 0; i < 64; i++)
+					Round(pS, _mm256_set1_epi32(s_PadSchedule.m_pWK[i]));
+
+				for (uint32_t i = 0; i < 8; i++)
+				{
+					_mm256_storeu_si256((__m256i*) pTmp, _mm256_add_epi32(pS[i], pS0[i]));
+
+					for (uint32_t j = 0; j < s_Lanes; j++)
+						StoreBE(p[j].m_pRes->m_pData + (i << 2), pTmp[j]);
+				}
+			}
+
+#undef BEAM_AVX2_FN
+
+		} // namespace Avx2
+
+		/////////////////////
+		// SHA extensions, one message at a time
+		namespace ShaNi
+		{
+#define BEAM_SHANI_FN __attribute__((target("sha,sse4.1")))
+
+			BEAM_SHANI_FN static inline void Rounds4(__m128i& s0, __m128i& s1, __m128i wk)
+			{
+				s1 = _mm_sha256rnds2_epu32(s1, s0, wk);
+				s0 = _mm_sha256rnds2_epu32(s0, s1, _mm_shuffle_epi32(wk, 0x0E));
+			}
+
+			BEAM_SHANI_FN static void Process1(const Hash::Processor::Pair& p)
+			{
+				const __m128i mskBE = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+				__m128i pW[4];
+				pW[0] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) p.m_pL->m_pData), mskBE);
+				pW[1] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (p.m_pL->m_pData + 16)), mskBE);
+				pW[2] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) p.m_pR->m_pData), mskBE);
+				pW[3] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (p.m_pR->m_pData + 16)), mskBE);
+
+				// state in the layout expected by the instructions: ABEF, CDGH
+				__m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) s_pInit), 0xB1); // CDAB
+				__m128i s1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*) (s_pInit + 4)), 0x1B); // EFGH
+				__m128i s0 = _mm_alignr_epi8(tmp, s1, 8); // ABEF
+				s1 = _mm_blend_epi16(s1, tmp, 0xF0); // CDGH
+
+				const __m128i s0Init = s0;
+				const __m128i s1Init = s1;
+
+				// message block
+				for (uint32_t i = 0; i < 16; i++)
+				{
+					__m128i& w = pW[i & 3];
+					if (i >= 4)
+					{
+						__m128i wPrev = pW[(i - 1) & 3];
+						w = _mm_sha256msg1_epu32(w, pW[(i - 3) & 3]);
+						w = _mm_add_epi32(w, _mm_alignr_epi8(wPrev, pW[(i - 2) & 3], 4));
+						w = _mm_sha256msg2_epu32(w, wPrev);
+					}
+
+					Rounds4(s0, s1, _mm_add_epi32(w, _mm_loadu_si128((const __m128i*) (s_pK + (i << 2)))));
+				}
+
+				s0 = _mm_add_epi32(s0, s0Init);
+				s1 = _mm_add_epi32(s1, s1Init);
+
+				const __m128i s0Mid = s0;
+				const __m128i s1Mid = s1;
+
+				// padding block
+				for (uint32_t i = 0; i < 16; i++)
+					Rounds4(s0, s1, _mm_loadu_si128((const __m128i*) (s_PadSchedule.m_pWK + (i << 2))));
+
+				s0 = _mm_add_epi32(s0, s0Mid);
+				s1 = _mm_add_epi32(s1, s1Mid);
+
+				// back to ABCD, EFGH
+				tmp = _mm_shuffle_epi32(s0, 0x1B); // FEBA
+				s1 = _mm_shuffle_epi32(s1, 0xB1); // DCHG
+				s0 = _mm_blend_epi16(tmp, s1, 0xF0); // DCBA
+				s1 = _mm_alignr_epi8(s1, tmp, 8); // HGFE
+
+				_mm_storeu_si128((__m128i*) p.m_pRes->m_pData, _mm_shuffle_epi8(s0, mskBE));
+				_mm_storeu_si128((__m128i*) (p.m_pRes->m_pData + 16), _mm_shuffle_epi8(s1, mskBE));
+			}
+
+#undef BEAM_SHANI_FN
+
+		} // namespace ShaNi
+
+	} // namespace Sha256
+
+#endif // BEAM_HASH_PAIRS_X86
+
+	bool Hash::Processor::IsPairsImplSupported(PairsImpl::Enum e)
+	{
+		switch (e)
+		{
+		case PairsImpl::Scalar:
+			return true;
+
+#ifdef BEAM_HASH_PAIRS_X86
+		case PairsImpl::Avx2:
+			__builtin_cpu_init(); // may be called during static initialization
+			return __builtin_cpu_supports("avx2");
+
+		case PairsImpl::ShaNi:
+			{
+				__builtin_cpu_init();
+
+				unsigned int a, b, c, d;
+				return __get_cpuid_count(7, 0, &a, &b, &c, &d) && (b & bit_SHA) && __builtin_cpu_supports("sse4.1");
+			}
+#endif // BEAM_HASH_PAIRS_X86
+
+		default:
+			return false;
+		}
+	}
+
+	Hash::Processor::PairsImpl::Enum Hash::Processor::get_PairsImplMax()
+	{
+		if (IsPairsImplSupported(PairsImpl::ShaNi))
+			return PairsImpl::ShaNi;
+
+		if (IsPairsImplSupported(PairsImpl::Avx2))
+			return PairsImpl::Avx2;
+
+		return PairsImpl::Scalar;
+	}
+
+	Hash::Processor::PairsImpl::Enum Hash::Processor::s_PairsImpl = Hash::Processor::get_PairsImplMax();
+
+	void Hash::Processor::HashPairs(const Pair* p, uint32_t nCount)
+	{
+#ifdef BEAM_HASH_PAIRS_X86
+		if (PairsImpl::ShaNi == s_PairsImpl)
+		{
+			for (; nCount; p++, nCount--)
+				Sha256::ShaNi::Process1(*p);
+			return;
+		}
+
+		if (PairsImpl::Avx2 == s_PairsImpl)
+		{
+			for (; nCount >= Sha256::Avx2::s_Lanes; p += Sha256::Avx2::s_Lanes, nCount -= Sha256::Avx2::s_Lanes)
+				Sha256::Avx2::Process8(p);
+		}
+#endif // BEAM_HASH_PAIRS_X86
+
+		// the remaining are hashed one-by-one
+		for (; nCount; p++, nCount--)
+			Processor() << *p->m_pL << *p->m_pR >> *p->m_pRes;
+	}
+
+} // namespace ECC
@@ -200,6 +200,7 @@ namespace ECC
 
 			static void get_As(secp256k1_ge&, const Point::Native& ptNormalized);
 			static void get_As(secp256k1_ge_storage&, const Point::Native& ptNormalized);
+			static void get_As(Point&, const Point::Native& ptNormalized);
 
 		private:
 			void NormalizeInternal(secp256k1_fe&, bool bNormalize);
@@ -602,6 +603,30 @@ namespace ECC
 		Processor& Serialize(const T&);
 
 		void operator >> (Value& hv) { Finalize(hv); }
+
+		// Batched hashing of independent 64-byte messages (Merkle node pairs). Each is equivalent to Processor() << *m_pL << *m_pR >> *m_pRes.
+		// Several messages are hashed at once in SIMD lanes, if supported by the CPU.
+		// The result may alias its own inputs, but not inputs of other pairs in the same call.
+		struct Pair
+		{
+			const Value* m_pL;
+			const Value* m_pR;
+			Value* m_pRes;
+		};
+
+		struct PairsImpl {
+			enum Enum {
+				Scalar,
+				Avx2, // 8 lanes
+				ShaNi,
+			};
+		};
+
+		static PairsImpl::Enum s_PairsImpl; // best supported by the CPU, may be lowered (for tests)
+		static PairsImpl::Enum get_PairsImplMax();
+		static bool IsPairsImplSupported(PairsImpl::Enum); // each is checked on its own, a CPU may support ShaNi without Avx2
+
+		static void HashPairs(const Pair*, uint32_t nCount);
 	};
 
 	class Hash::Mac
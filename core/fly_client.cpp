@@ -573,7 +573,10 @@ void FlyClient::NetworkStd::PostRequestInternal(Request& r)
     m_lst.push_back(*pNode);
     pNode->m_pRequest = &r;
 
-    OnNewRequests();
+    if (!m_pNewRequestsTimer)
+        m_pNewRequestsTimer = io::Timer::create(io::Reactor::get_Current());
+
+    m_pNewRequestsTimer->start(0, false, [this]() { OnNewRequests(); });
 }
 
 void FlyClient::NetworkStd::OnNewRequests()
@@ -600,6 +603,8 @@ void FlyClient::NetworkStd::Connection::AssignRequests()
     for (RequestList::iterator it = m_This.m_lst.begin(); m_This.m_lst.end() != it; )
         AssignRequest(*it++);
 
+    FlushBatch();
+
     if (m_lst.empty() && m_This.m_Cfg.m_PollPeriod_ms)
         SetTimer(m_This.m_Cfg.m_CloseConnectionDelay_ms); // this should allow to get sbbs messages
     else
@@ -774,6 +779,7 @@ bool FlyClient::NetworkStd::Connection::IsSupported(RequestBbsMsg& req)
 
 void FlyClient::NetworkStd::Connection::SendRequest(RequestBbsMsg& req)
 {
+	FlushBatch();
 	Send(req.m_Msg);
 
 	Ping msg2(Zero);
@@ -784,6 +790,220 @@ void FlyClient::NetworkStd::Connection::OnRequestData(RequestBbsMsg& req)
 {
 }
 
+void FlyClient::NetworkStd::Connection::SendRequest(RequestKernel2& req)
+{
+    if (!(LoginFlags::Extension5 & m_LoginFlags))
+    {
+        Send(req.m_Msg);
+        return;
+    }
+
+    if (!m_BatchUtxos.m_Utxos.empty() || (!m_BatchKernels.m_IDs.empty() && (m_BatchKernels.m_Fetch != req.m_Msg.m_Fetch)))
+        FlushBatch();
+
+    m_BatchKernels.m_Fetch = req.m_Msg.m_Fetch;
+    m_BatchKernels.m_IDs.push_back(req.m_Msg.m_ID);
+
+    if (m_BatchKernels.m_IDs.size() >= g_ProofsBatchMax)
+        FlushBatch();
+}
+
+void FlyClient::NetworkStd::Connection::SendRequest(RequestUtxo& req)
+{
+    if (!(LoginFlags::Extension5 & m_LoginFlags) || req.m_Msg.m_MaturityMin)
+    {
+        FlushBatch();
+        Send(req.m_Msg);
+        return;
+    }
+
+    if (!m_BatchKernels.m_IDs.empty())
+        FlushBatch();
+
+    m_BatchUtxos.m_Utxos.push_back(req.m_Msg.m_Utxo);
+
+    if (m_BatchUtxos.m_Utxos.size() >= g_ProofsBatchMax)
+        FlushBatch();
+}
+
+void FlyClient::NetworkStd::Connection::FlushBatch()
+{
+    // a single request is sent as-is
+    switch (m_BatchKernels.m_IDs.size())
+    {
+    case 0:
+        break;
+
+    case 1:
+        {
+            GetProofKernel2 msg;
+            msg.m_ID = m_BatchKernels.m_IDs.front();
+            msg.m_Fetch = m_BatchKernels.m_Fetch;
+            Send(msg);
+        }
+        break;
+
+    default:
+        Send(m_BatchKernels);
+    }
+
+    switch (m_BatchUtxos.m_Utxos.size())
+    {
+    case 0:
+        break;
+
+    case 1:
+        {
+            GetProofUtxo msg;
+            msg.m_Utxo = m_BatchUtxos.m_Utxos.front();
+            Send(msg);
+        }
+        break;
+
+    default:
+        Send(m_BatchUtxos);
+    }
+
+    m_BatchKernels.m_IDs.clear();
+    m_BatchUtxos.m_Utxos.clear();
+}
+
+bool FlyClient::NetworkStd::Connection::IsValidProofKernels(const ProofKernels& msg) const
+{
+    // the batch corresponds to the first in-progress requests
+    size_t nCount = msg.m_Heights.size();
+    if ((nCount < 2) || (msg.m_Indices.size() != nCount))
+        return false;
+
+    struct Item {
+        Height m_Height;
+        uint32_t m_Index;
+        const Merkle::Hash* m_pID;
+
+        bool operator < (const Item& x) const {
+            return (m_Height != x.m_Height) ? (m_Height < x.m_Height) : (m_Index < x.m_Index);
+        }
+    };
+
+    if (m_lst.empty() || (Request::Type::Kernel2 != m_lst.front().m_pRequest->get_Type()))
+        return false;
+
+    bool bFetch = Cast::Up<RequestKernel2>(*m_lst.front().m_pRequest).m_Msg.m_Fetch;
+    if (msg.m_Kernels.size() != (bFetch ? nCount : 0))
+        return false;
+
+    std::vector<Item> vItems;
+    vItems.reserve(nCount);
+
+    RequestList::const_iterator it = m_lst.begin();
+    for (size_t i = 0; i < nCount; i++, ++it)
+    {
+        if ((m_lst.end() == it) || (Request::Type::Kernel2 != it->m_pRequest->get_Type()))
+            return false;
+
+        const RequestKernel2& req = Cast::Up<RequestKernel2>(*it->m_pRequest);
+        if (bFetch != req.m_Msg.m_Fetch)
+            return false;
+
+        if (bFetch && msg.m_Heights[i] && (!msg.m_Kernels[i] || (msg.m_Kernels[i]->m_Internal.m_ID != req.m_Msg.m_ID)))
+            return false;
+
+        if (msg.m_Heights[i])
+        {
+            vItems.emplace_back();
+            vItems.back().m_Height = msg.m_Heights[i];
+            vItems.back().m_Index = msg.m_Indices[i];
+            vItems.back().m_pID = &req.m_Msg.m_ID;
+        }
+    }
+
+    std::sort(vItems.begin(), vItems.end());
+
+    struct MyVerifier
+        :public Merkle::MultiProof::Verifier
+    {
+        const Merkle::Hash* m_pRoot;
+
+        MyVerifier(const Merkle::MultiProof& x, uint64_t nCount) :Verifier(x, nCount) {}
+
+        virtual bool IsRootValid(const Merkle::Hash& hv) override {
+            return hv == *m_pRoot;
+        }
+    };
+
+    // verify the blocks whose headers we have. Otherwise only the kernel height is used, as for a single request
+    size_t iItem = 0;
+    for (size_t iBlock = 0; iBlock < msg.m_Proofs.size(); iBlock++)
+    {
+        const BlockKernelsProof& bp = msg.m_Proofs[iBlock];
+        if ((vItems.size() == iItem) || (vItems[iItem].m_Height != bp.m_Height))
+            return false;
+
+        Block::SystemState::Full s;
+        bool bVerify = m_This.m_Client.get_History().get_At(s, bp.m_Height);
+
+        MyVerifier ver(bp.m_Proof, bp.m_Count);
+        ver.m_pRoot = &s.m_Kernels;
+
+        for (size_t i0 = iItem; (vItems.size() > iItem) && (vItems[iItem].m_Height == bp.m_Height); iItem++)
+        {
+            const Item& x = vItems[iItem];
+            if ((iItem > i0) && (vItems[iItem - 1].m_Index == x.m_Index))
+            {
+                if (*vItems[iItem - 1].m_pID != *x.m_pID)
+                    return false; // different kernels at the same position
+                continue;
+            }
+
+            if (bVerify)
+            {
+                ver.m_hvPos = *x.m_pID;
+                ver.Process(x.m_Index);
+                if (!ver.m_bVerify)
+                    return false;
+            }
+        }
+    }
+
+    return vItems.size() == iItem;
+}
+
+void FlyClient::NetworkStd::Connection::OnMsg(ProofKernels&& msg)
+{
+    if (!IsValidProofKernels(msg))
+        ThrowUnexpected();
+
+    for (size_t i = 0; i < msg.m_Heights.size(); i++)
+    {
+        RequestKernel2& req = Cast::Up<RequestKernel2>(get_FirstRequestStrict(Request::Type::Kernel2));
+
+        req.m_Res.m_Height = msg.m_Heights[i];
+        if (req.m_Msg.m_Fetch)
+            req.m_Res.m_Kernel = std::move(msg.m_Kernels[i]);
+
+        OnRequestData(req);
+        OnFirstRequestDone(IsSupported(req));
+    }
+}
+
+void FlyClient::NetworkStd::Connection::OnMsg(ProofUtxos&& msg)
+{
+    if (msg.m_Proofs.size() < 2)
+        ThrowUnexpected();
+
+    for (size_t i = 0; i < msg.m_Proofs.size(); i++)
+    {
+        RequestUtxo& req = Cast::Up<RequestUtxo>(get_FirstRequestStrict(Request::Type::Utxo));
+        if (req.m_Msg.m_MaturityMin)
+            ThrowUnexpected(); // wasn't batched
+
+        std::swap(req.m_Res.m_Proofs, msg.m_Proofs[i]);
+
+        OnRequestData(req);
+        OnFirstRequestDone(IsSupported(req));
+    }
+}
+
 void FlyClient::NetworkStd::Connection::OnFirstRequestDone(bool bStillSupported)
 {
     RequestNode& n = m_lst.front();
@@ -855,5 +1075,269 @@ void FlyClient::NetworkStd::Connection::OnMsg(BbsMsg&& msg)
     }
 }
 
+
+////////////////////////////////////////
+// NetworkShared
+FlyClient::NetworkShared::~NetworkShared()
+{
+    assert(m_Endpoints.empty()); // endpoints keep us alive
+    m_Net.Disconnect();
+}
+
+FlyClient::NetworkShared::Endpoint::Endpoint(const NetworkShared::Ptr& pThis, FlyClient& fc)
+    :m_pThis(pThis)
+    ,m_Client(fc)
+{
+}
+
+FlyClient::NetworkShared::Endpoint::~Endpoint()
+{
+    Disconnect();
+
+    for (BbsSubscribers::iterator it = m_pThis->m_BbsSubscribers.begin(); m_pThis->m_BbsSubscribers.end() != it; )
+    {
+        BbsSubscribers::iterator itThis = it++;
+        if (this == itThis->second.m_pEndpoint)
+            m_pThis->BbsSubscribe(*this, itThis->first, 0, nullptr);
+    }
+}
+
+void FlyClient::NetworkShared::Endpoint::Connect()
+{
+    if (!m_Attached)
+    {
+        m_pThis->m_Endpoints.push_back(*this);
+        m_Attached = true;
+    }
+
+    m_pThis->Sync(*this);
+}
+
+void FlyClient::NetworkShared::Endpoint::Disconnect()
+{
+    if (m_Attached)
+    {
+        m_pThis->m_Endpoints.erase(EndpointList::s_iterator_to(*this));
+        m_Attached = false;
+    }
+}
+
+void FlyClient::NetworkShared::Endpoint::PostRequestInternal(Request& r)
+{
+    m_pThis->m_Net.PostRequestInternal(r); // the response is routed by m_pTrg
+}
+
+void FlyClient::NetworkShared::Endpoint::BbsSubscribe(BbsChannel ch, Timestamp ts, FlyClient::IBbsReceiver* p)
+{
+    m_pThis->BbsSubscribe(*this, ch, ts, p);
+}
+
+void FlyClient::NetworkShared::BbsSubscribe(Endpoint& ep, BbsChannel ch, Timestamp ts, FlyClient::IBbsReceiver* p)
+{
+    BbsSubscribers::iterator it = m_BbsSubscribers.lower_bound(ch);
+    for (; (m_BbsSubscribers.end() != it) && (it->first == ch); ++it)
+        if (&ep == it->second.m_pEndpoint)
+            break;
+
+    bool bFound = (m_BbsSubscribers.end() != it) && (it->first == ch);
+
+    if (!p)
+    {
+        if (!bFound)
+            return;
+
+        m_BbsSubscribers.erase(it);
+        if (m_BbsSubscribers.end() == m_BbsSubscribers.find(ch))
+        {
+            m_BbsChannels.erase(ch);
+            m_Net.BbsSubscribe(ch, 0, nullptr);
+        }
+        return;
+    }
+
+    auto itCh = m_BbsChannels.find(ch);
+    bool bNewChannel = (m_BbsChannels.end() == itCh);
+    if (bNewChannel)
+    {
+        itCh = m_BbsChannels.insert(std::make_pair(ch, BbsChannelState())).first;
+        itCh->second.m_Time = ts;
+    }
+
+    BbsChannelState& c = itCh->second;
+
+    if (bFound)
+    {
+        BbsSubscriber& x = it->second;
+        x.m_pRcv = p;
+
+        if (x.m_Time <= ts)
+        {
+            x.m_Time = ts;
+            return; // nothing new for it
+        }
+
+        // treated as a fresh join. The msgs in [ts, x.m_Time) may have been delivered to others since it joined, their keys don't tell it didn't get them
+        x.m_Time = ts;
+        x.m_nJoined = c.m_nDelivered;
+    }
+    else
+    {
+        BbsSubscriber x;
+        x.m_pEndpoint = &ep;
+        x.m_pRcv = p;
+        x.m_Time = ts;
+        x.m_nJoined = c.m_nDelivered;
+        m_BbsSubscribers.insert(std::make_pair(ch, x));
+    }
+
+    if (!bNewChannel)
+    {
+        // the node replays the msgs only on (re)subscription, the newcomer needs the stored ones too.
+        // Resubscribe from the earliest time, the msgs already delivered to other subscribers are skipped by their keys
+        std::setmin(c.m_Time, ts);
+        m_Net.BbsSubscribe(ch, 0, nullptr);
+    }
+
+    m_Net.BbsSubscribe(ch, c.m_Time, this);
+}
+
+void FlyClient::NetworkShared::OnMsg(proto::BbsMsg&& msg)
+{
+    auto itCh = m_BbsChannels.find(msg.m_Channel);
+    if (m_BbsChannels.end() == itCh)
+        return;
+
+    ECC::Hash::Value key;
+    ECC::Hash::Processor()
+        << Blob(msg.m_Message)
+        << msg.m_Channel
+        >> key;
+
+    auto itKey = itCh->second.m_mapDelivered.find(key);
+    uint64_t nSeq = (itCh->second.m_mapDelivered.end() == itKey) ? 0 : itKey->second;
+
+    std::vector<FlyClient::IBbsReceiver*> vRcv; // the receivers may (un)subscribe while handling the msg
+
+    for (BbsSubscribers::iterator it = m_BbsSubscribers.lower_bound(msg.m_Channel); (m_BbsSubscribers.end() != it) && (it->first == msg.m_Channel); ++it)
+    {
+        const BbsSubscriber& x = it->second;
+        if (msg.m_TimePosted < x.m_Time)
+            continue;
+
+        if (nSeq > x.m_nJoined)
+            continue; // replayed, already delivered to this one
+
+        vRcv.push_back(x.m_pRcv);
+    }
+
+    if (vRcv.empty())
+        return;
+
+    itCh->second.OnDelivered(key, msg.m_TimePosted);
+
+    for (size_t i = 0; i < vRcv.size(); i++)
+    {
+        if (i + 1 == vRcv.size())
+            vRcv[i]->OnMsg(std::move(msg));
+        else
+        {
+            proto::BbsMsg msgCopy = msg;
+            vRcv[i]->OnMsg(std::move(msgCopy));
+        }
+    }
+}
+
+void FlyClient::NetworkShared::BbsChannelState::OnDelivered(const ECC::Hash::Value& key, Timestamp t)
+{
+    uint64_t nSeq = ++m_nDelivered;
+    m_mapDelivered[key] = nSeq;
+
+    m_queDelivered.emplace_back();
+    Delivered& d = m_queDelivered.back();
+    d.m_Time = t;
+    d.m_Key = key;
+    d.m_nSeq = nSeq;
+
+    std::setmax(m_TimeMax, t);
+
+    while (!m_queDelivered.empty())
+    {
+        const Delivered& d0 = m_queDelivered.front();
+        if (d0.m_Time + s_Window_s >= m_TimeMax)
+            break;
+
+        auto it = m_mapDelivered.find(d0.m_Key);
+        if ((m_mapDelivered.end() != it) && (it->second == d0.m_nSeq))
+            m_mapDelivered.erase(it); // not delivered again since
+
+        m_queDelivered.pop_front();
+    }
+}
+
+void FlyClient::NetworkShared::OnNewTip()
+{
+    m_Hist.ShrinkToWindow(Rules::get().MaxRollback);
+
+    for (EndpointList::iterator it = m_Endpoints.begin(); m_Endpoints.end() != it; )
+        Sync(*it++);
+}
+
+void FlyClient::NetworkShared::OnTipUnchanged()
+{
+    for (EndpointList::iterator it = m_Endpoints.begin(); m_Endpoints.end() != it; )
+        (it++)->m_Client.OnTipUnchanged();
+}
+
+void FlyClient::NetworkShared::Sync(Endpoint& ep)
+{
+    if (m_Hist.m_Map.empty())
+        return; // not synced yet
+
+    struct Walker :public Block::SystemState::IHistory::IWalker
+    {
+        Block::SystemState::HistoryMap* m_pHist;
+        Height m_LowHeight; // below it there's nothing to compare with, assume it's valid
+        Height m_LowErase = MaxHeight;
+        Height m_Common = 0;
+
+        virtual bool OnState(const Block::SystemState::Full& s) override
+        {
+            Block::SystemState::Full s2;
+            if ((s.m_Height < m_LowHeight) || (m_pHist->get_At(s2, s.m_Height) && (s2 == s)))
+            {
+                m_Common = s.m_Height;
+                return false;
+            }
+
+            m_LowErase = s.m_Height;
+            return true;
+        }
+    } w;
+
+    w.m_pHist = &m_Hist;
+    w.m_LowHeight = m_Hist.m_Map.begin()->first;
+
+    Block::SystemState::IHistory& h = ep.m_Client.get_History();
+    h.Enum(w, NULL);
+
+    if (w.m_LowErase != MaxHeight)
+    {
+        h.DeleteFrom(w.m_LowErase);
+        ep.m_Client.OnRolledBack();
+    }
+
+    std::vector<Block::SystemState::Full> vStates;
+    for (auto it = m_Hist.m_Map.upper_bound(w.m_Common); m_Hist.m_Map.end() != it; ++it)
+        vStates.push_back(it->second);
+
+    if (vStates.empty())
+        ep.m_Client.OnTipUnchanged();
+    else
+    {
+        h.AddStates(&vStates.front(), vStates.size());
+        ep.m_Client.OnNewTip();
+    }
+}
+
 } // namespace proto
 } // namespace beam
@@ -129,6 +129,9 @@ namespace proto {
 			RequestList m_lst; // idle
 			void OnNewRequests();
 
+			// the requests posted within the same reactor turn are assigned at once, so that they can be batched
+			io::Timer::Ptr m_pNewRequestsTimer;
+
 			struct Config {
 				std::vector<io::Address> m_vNodes;
 				uint32_t m_PollPeriod_ms = 0; // set to 0 to keep connection. Anyway poll period would be no less than the expected rate of blocks
@@ -219,8 +222,19 @@ namespace proto {
 				REQUEST_TYPES_All(THE_MACRO)
 #undef THE_MACRO
 
-				template <typename Req> void SendRequest(Req& r) { Send(r.m_Msg); }
+				template <typename Req> void SendRequest(Req& r) { FlushBatch(); Send(r.m_Msg); }
 				void SendRequest(RequestBbsMsg&);
+				void SendRequest(RequestKernel2&);
+				void SendRequest(RequestUtxo&);
+
+				// consecutive Kernel2 and Utxo requests are coalesced, if supported by the node
+				proto::GetProofKernels m_BatchKernels;
+				proto::GetProofUtxos m_BatchUtxos;
+				void FlushBatch();
+				bool IsValidProofKernels(const proto::ProofKernels&) const;
+
+				virtual void OnMsg(proto::ProofKernels&&) override;
+				virtual void OnMsg(proto::ProofUtxos&&) override;
 			};
 
 			typedef boost::intrusive::list<Connection> ConnectionList;
@@ -239,6 +253,95 @@ namespace proto {
 			virtual void OnNodeConnected(bool) {}
 			virtual void OnConnectionFailed(const NodeConnection::DisconnectReason&) {}
 		};
+
+		struct NetworkShared;
+	};
+
+	// Node connections and the verified header chain, shared by many clients (i.e. wallets hosted by the same process).
+	// Each client talks to it via its own Endpoint. Requests are routed back by their m_pTrg, the client history is synchronized with the shared one on each tip change.
+	// The connections are not authenticated by the clients' keys, hence no owned-node events for them.
+	struct FlyClient::NetworkShared
+		:public FlyClient
+		,public FlyClient::IBbsReceiver
+	{
+		using Ptr = std::shared_ptr<NetworkShared>;
+
+		NetworkShared() :m_Net(*this) {}
+		virtual ~NetworkShared();
+
+		NetworkStd m_Net; // configure m_Net.m_Cfg, then call m_Net.Connect()
+		Block::SystemState::HistoryMap m_Hist; // shrunk to the max rollback window
+
+		class Endpoint
+			:public INetwork
+			,public boost::intrusive::list_base_hook<>
+		{
+			friend struct NetworkShared;
+			bool m_Attached = false;
+
+		public:
+			NetworkShared::Ptr m_pThis;
+			FlyClient& m_Client;
+
+			Endpoint(const NetworkShared::Ptr&, FlyClient&);
+			virtual ~Endpoint();
+
+			// INetwork
+			virtual void Connect() override; // attach, the client history is synchronized immediately if the shared one is ready
+			virtual void Disconnect() override;
+			virtual void PostRequestInternal(Request&) override;
+			virtual void BbsSubscribe(BbsChannel, Timestamp, FlyClient::IBbsReceiver*) override;
+		};
+
+	private:
+
+		typedef boost::intrusive::list<Endpoint> EndpointList;
+		EndpointList m_Endpoints; // attached
+
+		struct BbsSubscriber
+		{
+			Endpoint* m_pEndpoint;
+			FlyClient::IBbsReceiver* m_pRcv;
+			Timestamp m_Time; // msgs posted before are not delivered
+			uint64_t m_nJoined; // msgs delivered on the channel before this subscriber joined
+		};
+
+		typedef std::multimap<BbsChannel, BbsSubscriber> BbsSubscribers;
+		BbsSubscribers m_BbsSubscribers;
+
+		// Subscribed by m_Net, from the lowest time requested. Each new subscriber resubscribes it, so that the node replays the stored msgs. Hence the recently delivered ones are remembered.
+		// Msg times are not monotonic (the node accepts them within MaxAhead), so subscribers are filtered by their start time and the msg key only.
+		struct BbsChannelState
+		{
+			struct Delivered
+			{
+				Timestamp m_Time;
+				ECC::Hash::Value m_Key;
+				uint64_t m_nSeq;
+			};
+
+			Timestamp m_Time;
+			Timestamp m_TimeMax = 0; // the highest posted so far
+			uint64_t m_nDelivered = 0;
+			std::map<ECC::Hash::Value, uint64_t> m_mapDelivered; // key -> the seq of the last delivery
+			std::deque<Delivered> m_queDelivered; // in delivery order, to forget those beyond the window
+
+			static const uint32_t s_Window_s = 3600 * 24; // the nodes don't keep msgs for longer
+
+			void OnDelivered(const ECC::Hash::Value&, Timestamp);
+		};
+
+		std::map<BbsChannel, BbsChannelState> m_BbsChannels;
+
+		void Sync(Endpoint&);
+		void BbsSubscribe(Endpoint&, BbsChannel, Timestamp, FlyClient::IBbsReceiver*);
+
+		// FlyClient
+		virtual void OnNewTip() override;
+		virtual void OnTipUnchanged() override;
+		virtual Block::SystemState::IHistory& get_History() override { return m_Hist; }
+		// IBbsReceiver
+		virtual void OnMsg(proto::BbsMsg&&) override;
 	};
 
 } // namespace proto
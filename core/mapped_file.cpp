@@ -299,6 +299,16 @@ namespace beam
 		}
 	}
 
+	void MappedFile::EnsureSize(Offset n)
+	{
+		if (m_nMapping >= n)
+			return;
+
+		CloseMapping();
+		Resize(n);
+		OpenMapping();
+	}
+
 	void* MappedFile::Allocate(uint32_t iBank, uint32_t nSize)
 	{
 		assert(nSize >= sizeof(Offset));
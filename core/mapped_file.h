@@ -87,6 +87,10 @@ namespace beam
 		void Free(uint32_t iBank, void*);
 
 		void EnsureReserve(uint32_t iBank, uint32_t nSize, uint32_t nMinFree);
+
+		// for raw data beyond the banks and the fixed header (when no banks are used)
+		Offset get_Size() const { return m_nMapping; }
+		void EnsureSize(Offset); // remaps if grows, all the pointers are invalidated
 	};
 
 } // namespace beam
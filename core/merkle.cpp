@@ -476,9 +476,11 @@ struct FlyMmr::Inner
 		m_Count = m_This.m_Count;
 	}
 
+	static const uint8_t s_BatchH = 10; // up to 1K elements are reduced at once
+
 	void Calculate(Hash& hv, const Position& pos) const
 	{
-		if (pos.H)
+		if (pos.H > s_BatchH)
 		{
 			Position pos2;
 			pos2.X = pos.X << 1;
@@ -491,6 +493,36 @@ struct FlyMmr::Inner
 
 			Interpret(hv, hv2, true);
 		}
+		else if (pos.H)
+		{
+			// load all the elements, and reduce them level by level, each level is hashed in a batch
+			uint64_t n = 1ULL << pos.H;
+			uint64_t n0 = pos.X << pos.H;
+			assert(n0 + n <= m_Count);
+
+			std::vector<Hash> vSrc(n), vDst(n >> 1);
+			for (uint64_t i = 0; i < n; i++)
+				m_This.LoadElement(vSrc[i], n0 + i);
+
+			std::vector<ECC::Hash::Processor::Pair> vPairs(n >> 1);
+
+			for (; n > 1; n >>= 1)
+			{
+				uint64_t nPairs = n >> 1;
+				for (uint64_t i = 0; i < nPairs; i++)
+				{
+					ECC::Hash::Processor::Pair& p = vPairs[i];
+					p.m_pL = &vSrc[i << 1];
+					p.m_pR = &vSrc[(i << 1) + 1];
+					p.m_pRes = &vDst[i];
+				}
+
+				ECC::Hash::Processor::HashPairs(&vPairs.front(), static_cast<uint32_t>(nPairs));
+				vSrc.swap(vDst);
+			}
+
+			hv = vSrc.front();
+		}
 		else
 		{
 			assert(pos.X < m_Count);
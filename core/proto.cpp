@@ -17,6 +17,7 @@
 #include "core/ecc_native.h"
 #include "proto.h"
 #include "../utility/logger.h"
+#include "../utility/executor.h"
 
 namespace beam {
 namespace proto {
@@ -88,55 +89,65 @@ void ProtocolPlus::Encrypt(SerializedMsg& sm, MsgSerializer& ser)
     ser.finalize(sm);
 
     if (Mode::Plaintext != m_Mode)
-    {
-        // 2. get size
-        size_t n = 0;
+        EncryptFinalized(sm);
+}
 
-        for (size_t i = 0; i < sm.size(); i++)
-            n += sm[i].size;
+void ProtocolPlus::EncryptFinalized(SerializedMsg& sm)
+{
+    assert(Mode::Plaintext != m_Mode);
 
-        // 3. Calculate
-        ECC::Hash::Mac hm = m_HMac;
-        size_t n2 = n - MacValue::nBytes;
+    // 2. get size
+    size_t n = 0;
 
-        for (size_t i = 0; ; i++)
-        {
-            assert(i < sm.size());
-            io::IOVec& iov = sm[i];
-            if (iov.size >= n2)
-            {
-                hm.Write(iov.data, (uint32_t) n2);
-                break;
-            }
+    for (size_t i = 0; i < sm.size(); i++)
+        n += sm[i].size;
 
-            hm.Write(iov.data, (uint32_t)iov.size);
-            n2 -= iov.size;
-        }
+    assert(n >= MacValue::nBytes);
+    size_t n2 = n - MacValue::nBytes;
 
-        get_HMac(hm, hmac);
+    // 3. Calculate the hmac and encrypt in a single pass. Each portion is encrypted right after it's hashed, while it's still in cache
+    const size_t nPortionMax = 0x1000; // multiple of the hash block size
 
-        // 4. Overwrite the hmac, encrypt
-        n2 = n;
+    ECC::Hash::Mac hm = m_HMac;
+    size_t i = 0, nOffs = 0;
 
-        for (size_t i = 0; i < sm.size(); i++)
-        {
-            io::IOVec& iov = sm[i];
-            uint8_t* dst = (uint8_t*) iov.data;
+    while (n2)
+    {
+        assert(i < sm.size());
+        io::IOVec& iov = sm[i];
+        uint8_t* dst = (uint8_t*) iov.data + nOffs;
 
-            if (n2 <= hmac.nBytes)
-                memcpy(dst, hmac.m_pData + hmac.nBytes - n2, iov.size);
-            else
-            {
-                size_t offs = n2 - hmac.nBytes;
-                if (offs < iov.size)
-                    memcpy(dst + offs, hmac.m_pData, iov.size - offs);
-            }
+        size_t nPortion = std::min(std::min(iov.size - nOffs, n2), nPortionMax);
+
+        hm.Write(dst, (uint32_t) nPortion);
+        m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) nPortion);
 
-            n2 -= iov.size;
+        n2 -= nPortion;
+        nOffs += nPortion;
 
-            m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) iov.size);
+        if (nOffs == iov.size)
+        {
+            i++;
+            nOffs = 0;
         }
     }
+
+    MacValue hmac;
+    get_HMac(hm, hmac);
+
+    // 4. Overwrite the hmac (may be split across fragments), encrypt
+    for (n2 = 0; n2 < hmac.nBytes; i++, nOffs = 0)
+    {
+        assert(i < sm.size());
+        io::IOVec& iov = sm[i];
+        uint8_t* dst = (uint8_t*) iov.data + nOffs;
+
+        size_t nPortion = std::min(iov.size - nOffs, hmac.nBytes - n2);
+        memcpy(dst, hmac.m_pData + n2, nPortion);
+        m_CipherOut.XCrypt(m_Enc, dst, (uint32_t) nPortion);
+
+        n2 += nPortion;
+    }
 }
 
 void InitCipherIV(AES::StreamCipher& c, const ECC::Hash::Value& hvSecret, const ECC::Hash::Value& hvParam)
@@ -245,6 +256,146 @@ bool Bbs::Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAd
     return (hvMac == hvMac2);
 }
 
+struct BbsDecryptBatch
+    :public Executor::TaskSync
+{
+    static const uint32_t N = 64;
+
+    const ECC::MultiMac::Casual* m_pCasual; // remote public
+    const Bbs::KeyRef* m_pKeys;
+    uint32_t m_nCount;
+
+    ECC::Point::Native m_pPts[N];
+    secp256k1_fe m_pFes[N];
+    ECC::NoLeak<ECC::Hash::Value> m_pSecrets[N];
+    bool m_pValid[N];
+
+    void Calculate(uint32_t i0, uint32_t nCount)
+    {
+        ECC::Mode::Scope scope(ECC::Mode::Secure);
+
+        ECC::Point::Native::BatchNormalizer_Arr nrm;
+        nrm.m_pPts = m_pPts + i0;
+        nrm.m_pFes = m_pFes + i0;
+        nrm.m_Size = 0;
+
+        for (uint32_t i = 0; i < nCount; i++)
+        {
+            const ECC::Scalar::Native& sk = *m_pKeys[i0 + i].m_pSk;
+
+            // zero would break the batch normalization
+            m_pValid[i0 + i] = !(sk == Zero);
+            if (!m_pValid[i0 + i])
+                continue;
+
+            ECC::MultiMac mm;
+            mm.m_pCasual = Cast::NotConst(m_pCasual); // not modified in the secure mode
+            mm.m_Casual = 1;
+            mm.m_pKCasual = Cast::NotConst(&sk);
+            mm.Calculate(m_pPts[i0 + nrm.m_Size]);
+
+            nrm.m_Size++;
+        }
+
+        nrm.Normalize(); // single inversion
+
+        for (uint32_t i = 0, iPt = 0; i < nCount; i++)
+        {
+            if (!m_pValid[i0 + i])
+                continue;
+
+            ECC::Point pt;
+            ECC::Point::Native::BatchNormalizer::get_As(pt, m_pPts[i0 + iPt++]);
+
+            ECC::Hash::Processor() << pt >> m_pSecrets[i0 + i].V;
+        }
+    }
+
+    virtual void Exec(Executor::Context& ctx) override
+    {
+        uint32_t i0, nCount;
+        ctx.get_Portion(i0, nCount, m_nCount);
+        Calculate(i0, nCount);
+    }
+};
+
+uint32_t Bbs::DecryptMulti(uint8_t*& p, uint32_t& n, const KeyRef* pKeys, uint32_t nKeys)
+{
+    PeerID remotePublic;
+    ECC::Hash::Value hvMac, hvMac2;
+
+    if (n < remotePublic.nBytes + hvMac.nBytes)
+        return nKeys;
+
+    memcpy(remotePublic.m_pData, p, remotePublic.nBytes);
+
+    ECC::Point::Native ptRemote;
+    if (!remotePublic.ExportNnz(ptRemote))
+        return nKeys; // bad address
+
+    ECC::MultiMac::Casual mc;
+    {
+        ECC::Mode::Scope scope(ECC::Mode::Secure);
+        mc.Init(ptRemote);
+    }
+
+    // all the attempts are decrypted in the same scratch buffer
+    uint32_t nData = n - remotePublic.nBytes;
+    ByteBuffer buf(nData);
+
+    std::unique_ptr<BbsDecryptBatch> pBatch = std::make_unique<BbsDecryptBatch>();
+    BbsDecryptBatch& b = *pBatch;
+    b.m_pCasual = &mc;
+
+    for (uint32_t i0 = 0; i0 < nKeys; i0 += b.m_nCount)
+    {
+        b.m_pKeys = pKeys + i0;
+        b.m_nCount = std::min(nKeys - i0, BbsDecryptBatch::N);
+
+        if (Executor::s_pInstance && (b.m_nCount > 1))
+            Executor::s_pInstance->ExecAll(b);
+        else
+            b.Calculate(0, b.m_nCount);
+
+        for (uint32_t i = 0; i < b.m_nCount; i++)
+        {
+            if (!b.m_pValid[i])
+                continue;
+
+            const ECC::Hash::Value& hvSecret = b.m_pSecrets[i].V;
+
+            AES::Encoder enc;
+            enc.Init(hvSecret.m_pData);
+
+            ECC::Hash::Mac hmac;
+            hmac.Reset(hvSecret.m_pData, hvSecret.nBytes);
+
+            AES::StreamCipher cIn;
+            InitCipherIV(cIn, hvSecret, *pKeys[i0 + i].m_pPk);
+
+            memcpy(&buf.front(), p + remotePublic.nBytes, nData);
+            cIn.XCrypt(enc, &buf.front(), nData);
+
+            memcpy(hvMac.m_pData, &buf.front(), hvMac.nBytes);
+
+            hmac.Write(&buf.front() + hvMac.nBytes, nData - hvMac.nBytes);
+            hmac >> hvMac2;
+
+            if (hvMac == hvMac2)
+            {
+                memcpy(p + remotePublic.nBytes, &buf.front(), nData);
+
+                p += remotePublic.nBytes + hvMac.nBytes;
+                n -= remotePublic.nBytes + hvMac.nBytes;
+
+                return i0 + i;
+            }
+        }
+    }
+
+    return nKeys;
+}
+
 void Bbs::get_HashPartial(ECC::Hash::Processor& hp, const BbsMsg& msg)
 {
 	hp
@@ -422,6 +573,11 @@ size_t NodeConnection::get_Unsent() const
 	return m_Connection ? m_Connection->get_Unsent() : 0;
 }
 
+io::TcpStream::State NodeConnection::get_Traffic() const
+{
+	return m_Connection ? m_Connection->get_State() : io::TcpStream::State();
+}
+
 void NodeConnection::on_protocol_error(uint64_t, ProtocolError error)
 {
     Reset();
@@ -551,6 +707,41 @@ bool NodeConnection::OnMsgInternal(uint64_t, msg##_NoInit&& v) \
 BeamNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
 
+void NodeConnection::Send(IBroadcast& b)
+{
+    if (!IsLive())
+        return;
+
+    m_SerializeCache.clear();
+
+    if (ProtocolPlus::Mode::Plaintext == m_Protocol.m_Mode)
+        m_Protocol.Encrypt(m_SerializeCache, b.SerializeNoFinalize(m_SerializeCache, m_Protocol)); // no mac, can't share the image
+    else
+    {
+        if (b.m_Buf.empty())
+        {
+            MsgSerializer& ser = b.SerializeNoFinalize(m_SerializeCache, m_Protocol);
+
+            ProtocolPlus::MacValue hmac = Zero;
+            ser & hmac;
+            ser.finalize(m_SerializeCache);
+
+            b.m_Buf = io::normalize(m_SerializeCache, true);
+            m_SerializeCache.clear();
+        }
+
+        // encryption is in-place, each connection needs its own copy
+        m_SerializeCache.emplace_back(b.m_Buf.data, b.m_Buf.size);
+        m_Protocol.EncryptFinalized(m_SerializeCache);
+    }
+
+    io::Result res = m_Connection->write_msg(m_SerializeCache);
+    m_SerializeCache.clear();
+
+    TestIoResultAsync(res);
+    TestNotDrown();
+}
+
 void NodeConnection::TestInputMsgContext(uint8_t code)
 {
     if (!IsSecureIn())
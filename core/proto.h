@@ -84,6 +84,13 @@ namespace proto {
     macro(ECC::Point, Utxo) \
     macro(Height, MaturityMin) /* set to non-zero in case the result is too big, and should be retrieved within multiple queries */
 
+#define BeamNodeMsg_GetProofKernels(macro) \
+    macro(std::vector<Merkle::Hash>, IDs) /* up to g_ProofsBatchMax */ \
+    macro(bool, Fetch)
+
+#define BeamNodeMsg_GetProofUtxos(macro) \
+    macro(std::vector<ECC::Point>, Utxos) /* up to g_ProofsBatchMax */
+
 #define BeamNodeMsg_GetProofShieldedOutp(macro) \
     macro(ECC::Point, SerialPub)
 
@@ -112,6 +119,15 @@ namespace proto {
 #define BeamNodeMsg_ProofUtxo(macro) \
     macro(std::vector<Input::Proof>, Proofs)
 
+#define BeamNodeMsg_ProofKernels(macro) \
+    macro(std::vector<Height>, Heights) /* per requested ID, zero if not found */ \
+    macro(std::vector<uint32_t>, Indices) /* per requested ID, within its block */ \
+    macro(std::vector<TxKernel::Ptr>, Kernels) /* per requested ID, if fetched */ \
+    macro(std::vector<BlockKernelsProof>, Proofs) /* per block, in ascending height order */
+
+#define BeamNodeMsg_ProofUtxos(macro) \
+    macro(std::vector<std::vector<Input::Proof> >, Proofs) /* per requested utxo */
+
 #define BeamNodeMsg_ProofShieldedOutp(macro) \
     macro(ECC::Point, Commitment) \
     macro(TxoID, ID) \
@@ -279,6 +295,10 @@ namespace proto {
     macro(0x23, ProofCommonState) \
     macro(0x24, GetProofKernel2) \
     macro(0x25, ProofKernel2) \
+    macro(0x47, GetProofKernels) \
+    macro(0x48, ProofKernels) \
+    macro(0x49, GetProofUtxos) \
+    macro(0x4a, ProofUtxos) \
     macro(0x26, GetBodyPack) \
     macro(0x27, BodyPack) \
     macro(0x28, GetProofShieldedOutp) \
@@ -321,7 +341,8 @@ namespace proto {
         static const uint32_t Extension2             = 0x20; // Supports large HdrPack, BlockPack with parameters
         static const uint32_t Extension3             = 0x40; // Supports Login1, Status (former Boolean) for NewTransaction result, compatible with Fork H1
         static const uint32_t Extension4             = 0x80; // Supports proto::Events (replaces proto::EventsLegacy)
-	    static const uint32_t Recognized             = 0xff;
+        static const uint32_t Extension5             = 0x100; // Supports batched proofs (GetProofKernels, GetProofUtxos)
+	    static const uint32_t Recognized             = 0x1ff;
 
 
 		static const uint32_t ExtensionsBeforeHF1 =
@@ -331,7 +352,8 @@ namespace proto {
 
 		static const uint32_t ExtensionsAll =
 			ExtensionsBeforeHF1 |
-            Extension4;
+            Extension4 |
+            Extension5;
 	};
 
     struct IDType
@@ -342,6 +364,7 @@ namespace proto {
     };
 
 	static const uint32_t g_HdrPackMaxSize = 2048; // about 400K
+	static const uint32_t g_ProofsBatchMax = 256; // items per GetProofKernels/GetProofUtxos
 
     struct Event
     {
@@ -489,6 +512,23 @@ namespace proto {
 
 	};
 
+	// Proof for several kernels of the same block. Common path hashes are included once
+	struct BlockKernelsProof
+	{
+		Height m_Height;
+		uint32_t m_Count; // kernels in the block
+		Merkle::MultiProof m_Proof; // for the requested kernels, in ascending index order
+
+	    template <typename Archive>
+	    void serialize(Archive& ar)
+	    {
+	        ar
+	            & m_Height
+	            & m_Count
+	            & m_Proof;
+	    }
+	};
+
     enum Unused_ { Unused };
     enum Uninitialized_ { Uninitialized };
 
@@ -526,6 +566,11 @@ namespace proto {
         static void Set(std::unique_ptr<T>& var, TArg arg) { var = std::move(arg); }
     };
 
+    template <typename T> struct InitArg<std::vector<std::unique_ptr<T> > > {
+        typedef std::vector<std::unique_ptr<T> >& TArg;
+        static void Set(std::vector<std::unique_ptr<T> >& var, TArg arg) { var = std::move(arg); }
+    };
+
 	namespace Bbs
 	{
 		static const size_t s_MaxMsgSize = 1024 * 1024;
@@ -545,6 +590,17 @@ namespace proto {
 
 		bool Encrypt(ByteBuffer& res, const PeerID& publicAddr, ECC::Scalar::Native& nonce, const void*, uint32_t); // will fail iff addr is invalid
 		bool Decrypt(uint8_t*& p, uint32_t& n, const ECC::Scalar::Native& privateAddr);
+
+		struct KeyRef
+		{
+			const ECC::Scalar::Native* m_pSk; // private addr
+			const PeerID* m_pPk; // its public addr
+		};
+
+		// Trial decryption against many addresses. The remote public is imported and tabulated once, the shared secrets are computed
+		// in batches (normalized at once, in parallel if there's an Executor). Returns the index of the matching key, or nKeys if none.
+		// On success the message is decrypted in-place, p and n are adjusted as by Decrypt. Otherwise it's left intact.
+		uint32_t DecryptMulti(uint8_t*& p, uint32_t& n, const KeyRef*, uint32_t nKeys);
 	};
 
 	struct TxStatus
@@ -634,6 +690,7 @@ namespace proto {
         virtual bool VerifyMsg(const uint8_t*, uint32_t nSize) override;
 
         void Encrypt(SerializedMsg&, MsgSerializer&);
+        void EncryptFinalized(SerializedMsg&); // the msg must already be finalized, with the dummy mac appended
     };
 
     struct INodeMsgHandler
@@ -789,6 +846,7 @@ namespace proto {
         virtual void OnDisconnect(const DisconnectReason&) {}
 
 		size_t get_Unsent() const;
+		io::TcpStream::State get_Traffic() const; // zero if not connected
 		size_t m_UnsentHiMark = 0;
 		void TestNotDrown();
 
@@ -800,6 +858,28 @@ namespace proto {
         BeamNodeMsgsAll(THE_MACRO)
 #undef THE_MACRO
 
+        // The same msg sent to many peers. Serialized once (on the first Send), only the mac and encryption are per-connection
+        struct IBroadcast
+        {
+            io::SharedBuffer m_Buf; // finalized image, with the dummy mac
+            virtual MsgSerializer& SerializeNoFinalize(SerializedMsg&, ProtocolPlus&) = 0;
+        };
+
+        template <typename TMsg>
+        struct Broadcast
+            :public IBroadcast
+        {
+            const TMsg& m_Msg;
+            Broadcast(const TMsg& msg) :m_Msg(msg) {}
+
+            virtual MsgSerializer& SerializeNoFinalize(SerializedMsg& sm, ProtocolPlus& p) override
+            {
+                return p.serializeNoFinalize(sm, TMsg::s_Code, m_Msg);
+            }
+        };
+
+        void Send(IBroadcast&);
+
         struct Server
         {
             io::TcpServer::Ptr m_pServer; // just delete it to stop listening
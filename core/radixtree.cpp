@@ -14,6 +14,8 @@
 
 #include "radixtree.h"
 #include "ecc_native.h"
+#include <thread>
+#include <deque>
 
 namespace beam {
 
@@ -474,37 +476,160 @@ void RadixHashTree::get_Hash(Merkle::Hash& hv)
 
 const Merkle::Hash& RadixHashTree::get_Hash(Node& n, Merkle::Hash& hv)
 {
-	if (Node::s_Leaf & n.m_Bits)
+	if (!(Node::s_Clean & n.m_Bits))
+		OnDirty(); // all the dirty nodes are below
+
+	return get_HashRaw(n, hv);
+}
+
+struct RadixHashTree::HashLevels
+{
+	std::vector<std::vector<ECC::Hash::Processor::Pair> > m_vLevels;
+	std::deque<Merkle::Hash> m_LeafHashes; // for leafs that don't keep their hashes. Addresses are stable
+
+	uint32_t Collect(RadixHashTree& t, MyJoint& x)
 	{
-		const Merkle::Hash& ret = get_LeafHash(n, hv);
+		ECC::Hash::Processor::Pair p;
+		p.m_pRes = &x.m_Hash;
 
-		if (!(Node::s_Clean & n.m_Bits))
+		uint32_t nLevel = 0;
+		for (size_t i = 0; i < _countof(x.m_ppC); i++)
 		{
-			OnDirty();
-			n.m_Bits |= Node::s_Clean;
+			Node& c = *x.m_ppC[i].get_Strict();
+			const Merkle::Hash* phv;
+
+			if (Node::s_Leaf & c.m_Bits)
+			{
+				m_LeafHashes.emplace_back();
+				phv = &t.get_LeafHash(c, m_LeafHashes.back());
+				c.m_Bits |= Node::s_Clean;
+			}
+			else
+			{
+				MyJoint& y = Cast::Up<MyJoint>(c);
+				if (!(Node::s_Clean & y.m_Bits))
+					nLevel = std::max(nLevel, Collect(t, y) + 1);
+
+				phv = &y.m_Hash;
+			}
+
+			(i ? p.m_pR : p.m_pL) = phv;
 		}
 
+		if (m_vLevels.size() <= nLevel)
+			m_vLevels.resize(nLevel + 1);
+
+		m_vLevels[nLevel].push_back(p);
+		x.m_Bits |= Node::s_Clean; // will be hashed before get_HashRaw() returns
+
+		return nLevel;
+	}
+};
+
+const Merkle::Hash& RadixHashTree::get_HashRaw(Node& n, Merkle::Hash& hv)
+{
+	if (Node::s_Leaf & n.m_Bits)
+	{
+		const Merkle::Hash& ret = get_LeafHash(n, hv);
+		n.m_Bits |= Node::s_Clean;
 		return ret;
 	}
 
 	MyJoint& x = Cast::Up<MyJoint>(n);
 	if (!(Node::s_Clean & x.m_Bits))
 	{
-		ECC::Hash::Processor hp;
+		// collect all the dirty joints, grouped by their height above the clean part, and hash level by level in batches
+		HashLevels hl;
+		hl.Collect(*this, x);
 
-		for (size_t i = 0; i < _countof(x.m_ppC); i++)
+		for (size_t i = 0; i < hl.m_vLevels.size(); i++)
 		{
-			ECC::Hash::Value hvPlaceholder;
-			hp << get_Hash(*x.m_ppC[i].get_Strict(), hvPlaceholder);
+			const std::vector<ECC::Hash::Processor::Pair>& v = hl.m_vLevels[i];
+			ECC::Hash::Processor::HashPairs(&v.front(), static_cast<uint32_t>(v.size()));
 		}
+	}
 
+	return x.m_Hash;
+}
+
+struct RadixHashTree::HashJob
+{
+	// Shared with the executor tasks, which may start after the job is over. Nodes are touched only if claimed.
+	typedef std::shared_ptr<HashJob> Ptr;
+
+	RadixHashTree* m_pTree;
+	std::vector<Node*> m_vRoots;
+	std::atomic<uint32_t> m_iNext { 0 };
+	std::atomic<uint32_t> m_nDone { 0 };
+
+	void Run()
+	{
+		const uint32_t nCount = static_cast<uint32_t>(m_vRoots.size());
+		for (uint32_t i; (i = m_iNext++) < nCount; m_nDone++)
+		{
+			Merkle::Hash hv;
+			m_pTree->get_HashRaw(*m_vRoots[i], hv);
+		}
+	}
+
+	struct Task
+		:public Executor::TaskAsync
+	{
+		HashJob::Ptr m_pJob;
+		virtual void Exec(Executor::Context&) override { m_pJob->Run(); }
+	};
+};
+
+void RadixHashTree::get_Hash(Merkle::Hash& hv, Executor& ex)
+{
+	Node* pRoot = get_Root();
+	uint32_t nThreads = ex.get_Threads();
+
+	if (pRoot && (nThreads > 1) && !((Node::s_Clean | Node::s_Leaf) & pRoot->m_Bits))
+	{
 		OnDirty();
 
-		hp >> x.m_Hash;
-		x.m_Bits |= Node::s_Clean;
+		// Descend the dirty part level by level, till there are enough independent dirty subtrees.
+		// Each subtree is rehashed by a single thread. What remains above is small.
+		const size_t nSubtreesMin = nThreads * 4;
+
+		std::vector<Node*> vNodes;
+		vNodes.push_back(pRoot);
+
+		size_t iPos = 0;
+		for ( ; (iPos < vNodes.size()) && (vNodes.size() - iPos < nSubtreesMin); iPos++)
+		{
+			Joint& x = Cast::Up<Joint>(*vNodes[iPos]);
+			for (size_t i = 0; i < _countof(x.m_ppC); i++)
+			{
+				Node* pC = x.m_ppC[i].get_Strict();
+				if (!((Node::s_Clean | Node::s_Leaf) & pC->m_Bits))
+					vNodes.push_back(pC); // dirty leaves are left for the final pass
+			}
+		}
+
+		if (vNodes.size() - iPos >= nSubtreesMin)
+		{
+			HashJob::Ptr pJob = std::make_shared<HashJob>();
+			pJob->m_pTree = this;
+			pJob->m_vRoots.assign(vNodes.begin() + iPos, vNodes.end());
+
+			// the current thread participates too, so that it's not stalled by other pending tasks
+			for (uint32_t i = 1; i < nThreads; i++)
+			{
+				std::unique_ptr<HashJob::Task> pTask(new HashJob::Task);
+				pTask->m_pJob = pJob;
+				ex.Push(std::move(pTask));
+			}
+
+			pJob->Run();
+
+			while (pJob->m_nDone < pJob->m_vRoots.size())
+				std::this_thread::yield(); // some subtrees are still being hashed by others
+		}
 	}
 
-	return x.m_Hash;
+	get_Hash(hv);
 }
 
 void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
@@ -532,6 +657,48 @@ void RadixHashTree::get_Proof(Merkle::Proof& proof, const CursorBase& cu)
 	assert(proof.size() == nOut);
 }
 
+uint64_t RadixHashTree::Publish()
+{
+	if (!IsPublished())
+	{
+		Merkle::Hash hv;
+		get_Hash(hv); // make sure all the nodes are clean
+
+		m_Epoch++;
+	}
+
+	return m_Epoch;
+}
+
+void RadixHashTree::Unpublish()
+{
+	if (!IsPublished())
+		return;
+
+	m_Epoch++; // new readers won't enter
+
+	// Both the epoch and readers count are seq_cst. Either the reader sees the new epoch, or we see it's inside.
+	while (m_Readers)
+		std::this_thread::yield();
+}
+
+RadixHashTree::Reader::Reader(RadixHashTree& t, uint64_t nEpoch)
+	:m_Tree(t)
+	,m_Epoch(nEpoch)
+{
+	m_Tree.m_Readers++;
+	m_bEntered = IsValid();
+
+	if (!m_bEntered)
+		m_Tree.m_Readers--;
+}
+
+RadixHashTree::Reader::~Reader()
+{
+	if (m_bEntered)
+		m_Tree.m_Readers--;
+}
+
 /////////////////////////////
 // UtxoTree
 void UtxoTree::MyLeaf::get_Hash(Merkle::Hash& hv, const Key& key, Input::Count nCount)
@@ -879,6 +1046,7 @@ bool UtxoTreeMapped::Open(const char* sz, const Stamp& s)
 
 void UtxoTreeMapped::Close()
 {
+	Unpublish();
 	m_RootOffset = 0; // prevent cleanup
 	m_Mapping.Close();
 }
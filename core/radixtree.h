@@ -16,6 +16,8 @@
 
 #include "block_crypt.h"
 #include "mapped_file.h"
+#include "../utility/executor.h"
+#include <atomic>
 
 namespace beam
 {
@@ -188,16 +190,43 @@ public:
 	};
 
 	void get_Hash(Merkle::Hash&);
+	void get_Hash(Merkle::Hash&, Executor&); // dirty subtrees are rehashed in parallel
 	void get_Proof(Merkle::Proof&, const CursorBase&);
 
+	// Snapshot mode. While published the tree is fully hashed (so that hash/proof evaluation doesn't write anything),
+	// and may be read (traverse, proofs) from other threads. The owner must unpublish it before any modification.
+	// Readers never block, they just fail to enter (or should abort) once the snapshot is gone.
+	uint64_t Publish(); // returns the snapshot epoch
+	void Unpublish(); // waits for the active readers to leave
+	bool IsPublished() const { return !(1 & m_Epoch); }
+
+	struct Reader
+	{
+		RadixHashTree& m_Tree;
+		const uint64_t m_Epoch;
+		bool m_bEntered;
+
+		Reader(RadixHashTree&, uint64_t nEpoch);
+		~Reader();
+
+		bool IsValid() const { return m_Tree.m_Epoch == m_Epoch; } // if false - the owner waits for us to leave
+	};
+
 protected:
 	// RadixTree
 	virtual Joint* CreateJoint() override { return new MyJoint; }
 	virtual void DeleteJoint(Joint* p) override { delete Cast::Up<MyJoint>(p); }
 
 	const Merkle::Hash& get_Hash(Node&, Merkle::Hash&);
+	const Merkle::Hash& get_HashRaw(Node&, Merkle::Hash&); // doesn't call OnDirty(), may be used from other threads on distinct subtrees
 
 	virtual const Merkle::Hash& get_LeafHash(Node&, Merkle::Hash&) = 0;
+
+private:
+	struct HashJob;
+	struct HashLevels;
+	std::atomic<uint64_t> m_Epoch { 1 }; // odd - not published
+	std::atomic<uint32_t> m_Readers { 0 };
 };
 
 class RadixHashOnlyTree
@@ -413,6 +442,7 @@ public:
 
 	bool Open(const char* sz, const Stamp&);
 	bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+	MappedFile::Offset get_MappedSize() const { return m_Mapping.get_Size(); }
 
 	void Close();
 	void FlushStrict(const Stamp&);
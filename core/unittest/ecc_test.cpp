@@ -264,6 +264,59 @@ void TestHash()
 		// hash values must change, even if no explicit input was fed.
 		verify_test(!(hv == hv2));
 	}
+
+	// batched pairs, all the supported implementations vs standard
+	const uint32_t nPairs = 37; // not a multiple of lanes
+	Hash::Value pL[nPairs], pR[nPairs], pRes[nPairs], pRef[nPairs];
+	Hash::Processor::Pair pP[nPairs];
+
+	for (uint32_t i = 0; i < nPairs; i++)
+	{
+		SetRandom(pL[i]);
+		SetRandom(pR[i]);
+		Hash::Processor() << pL[i] << pR[i] >> pRef[i];
+
+		pP[i].m_pL = pL + i;
+		pP[i].m_pR = pR + i;
+		pP[i].m_pRes = pRes + i;
+	}
+
+	const Hash::Processor::PairsImpl::Enum eImpl = Hash::Processor::s_PairsImpl;
+	for (uint32_t iImpl = 0; iImpl <= Hash::Processor::PairsImpl::ShaNi; iImpl++)
+	{
+		if (!Hash::Processor::IsPairsImplSupported((Hash::Processor::PairsImpl::Enum) iImpl))
+			continue;
+
+		Hash::Processor::s_PairsImpl = (Hash::Processor::PairsImpl::Enum) iImpl;
+
+		for (uint32_t n = 0; n <= nPairs; n += 9)
+		{
+			memset0(pRes, sizeof(pRes));
+			Hash::Processor::HashPairs(pP, n);
+
+			for (uint32_t i = 0; i < n; i++)
+				verify_test(pRes[i] == pRef[i]);
+		}
+
+		// result in-place of the left input
+		Hash::Value pL2[nPairs];
+		memcpy(pL2, pL, sizeof(pL));
+		for (uint32_t i = 0; i < nPairs; i++)
+		{
+			pP[i].m_pL = pL2 + i;
+			pP[i].m_pRes = pL2 + i;
+		}
+
+		Hash::Processor::HashPairs(pP, nPairs);
+		for (uint32_t i = 0; i < nPairs; i++)
+		{
+			verify_test(pL2[i] == pRef[i]);
+			pP[i].m_pL = pL + i;
+			pP[i].m_pRes = pRes + i;
+		}
+	}
+
+	Hash::Processor::s_PairsImpl = eImpl;
 }
 
 void TestScalars()
@@ -1455,6 +1508,43 @@ void TestAES()
 
 	sd.dec.Proceed(pBuf, pBuf); // inplace decode
 	verify_test(!memcmp(pBuf, pPlaintext, sizeof(pPlaintext)));
+
+	// stream cipher: all the implementations must produce the same stream, regardless to how it's split
+	uint8_t pSrc[0x1000];
+	GenRandom(pSrc, sizeof(pSrc));
+
+	uint8_t pRef[sizeof(pSrc)];
+
+	const AES::Impl::Enum eImpl = AES::s_Impl;
+
+	for (uint32_t iImpl = 0; iImpl <= eImpl; iImpl++)
+	{
+		AES::s_Impl = (AES::Impl::Enum) iImpl;
+
+		AES::StreamCipher asc;
+		asc.Reset();
+		asc.m_Counter.m_pData[asc.m_Counter.nBytes - 1] = 0xfa; // make sure carry is handled
+
+		uint8_t pOut[sizeof(pSrc)];
+		memcpy(pOut, pSrc, sizeof(pOut));
+
+		for (uint32_t nPos = 0, nStep = 0; nPos < sizeof(pOut); nStep++)
+		{
+			uint32_t nSize = std::min<uint32_t>(nStep * 7 % 300, sizeof(pOut) - nPos);
+			asc.XCrypt(se.enc, pOut + nPos, nSize);
+			nPos += nSize;
+		}
+
+		if (iImpl)
+			verify_test(!memcmp(pOut, pRef, sizeof(pOut)));
+		else
+		{
+			verify_test(memcmp(pOut, pSrc, sizeof(pOut)));
+			memcpy(pRef, pOut, sizeof(pOut));
+		}
+	}
+
+	AES::s_Impl = eImpl;
 }
 
 void TestKdfPair(Key::IKdf& skdf, Key::IPKdf& pkdf)
@@ -2136,6 +2226,158 @@ void TestAssetEmission()
 	verify_test(bIsValid);
 }
 
+struct MyExecutorMT
+	:public beam::ExecutorMT
+{
+	uint32_t m_Threads = 4;
+
+	virtual uint32_t get_Threads() override { return m_Threads; }
+
+	virtual void RunThread(uint32_t iThread) override
+	{
+		ExecutorMT::Context ctx;
+		ctx.m_iThread = iThread;
+		RunThreadCtx(ctx);
+	}
+
+	~MyExecutorMT() { Stop(); }
+};
+
+struct MyExecutorTask
+	:public beam::Executor::TaskAsync
+{
+	std::atomic<uint32_t>* m_pDone;
+	uint32_t m_Work = 0;
+
+	virtual void Exec(beam::Executor::Context&) override
+	{
+		Hash::Value hv = Zero;
+		for (uint32_t i = 0; i < m_Work; i++)
+			Hash::Processor() << hv >> hv;
+
+		(*m_pDone)++;
+	}
+
+	static void Push(beam::Executor& ex, std::atomic<uint32_t>& nDone, uint32_t nWork)
+	{
+		std::unique_ptr<MyExecutorTask> pTask(new MyExecutorTask);
+		pTask->m_pDone = &nDone;
+		pTask->m_Work = nWork;
+		ex.Push(std::move(pTask));
+	}
+};
+
+void TestExecutor()
+{
+	MyExecutorMT ex;
+
+	struct MyCtl
+		:public beam::Executor::TaskSync
+	{
+		std::atomic<uint32_t> m_pCount[4];
+		std::atomic<uint32_t>* m_pDone;
+		uint32_t m_DoneExpected;
+
+		virtual void Exec(beam::Executor::Context& ctx) override
+		{
+			verify_test(ctx.m_iThread < _countof(m_pCount));
+			verify_test(*m_pDone == m_DoneExpected); // all async tasks must be complete
+			m_pCount[ctx.m_iThread]++;
+		}
+	};
+
+	for (uint32_t iCycle = 0; iCycle < 2; iCycle++)
+	{
+		std::atomic<uint32_t> nDone(0);
+
+		for (uint32_t i = 0; i < 1000; i++)
+			MyExecutorTask::Push(ex, nDone, i % 7);
+
+		verify_test(!ex.Flush(0));
+		verify_test(nDone == 1000);
+
+		for (uint32_t i = 0; i < 100; i++)
+			MyExecutorTask::Push(ex, nDone, 1000);
+
+		verify_test(ex.Flush(10) <= 10);
+		verify_test(nDone >= 1090);
+
+		// ExecAll waits for pending tasks, and runs the control task once on each thread
+		for (uint32_t i = 0; i < 50; i++)
+			MyExecutorTask::Push(ex, nDone, 100);
+
+		MyCtl t;
+		for (uint32_t i = 0; i < _countof(t.m_pCount); i++)
+			t.m_pCount[i] = 0;
+		t.m_pDone = &nDone;
+		t.m_DoneExpected = 1150;
+
+		for (uint32_t iExec = 1; iExec <= 3; iExec++)
+		{
+			ex.ExecAll(t);
+			for (uint32_t i = 0; i < _countof(t.m_pCount); i++)
+				verify_test(t.m_pCount[i] == iExec);
+		}
+
+		// pending tasks are discarded on stop, the executor restarts on demand
+		for (uint32_t i = 0; i < 100; i++)
+			MyExecutorTask::Push(ex, nDone, 100);
+
+		ex.Stop();
+	}
+}
+
+void TestBbsMulti()
+{
+	const uint32_t nKeys = 150; // several batches
+	const uint32_t iTrg = 130;
+
+	std::vector<Scalar::Native> vSk(nKeys);
+	std::vector<beam::PeerID> vPk(nKeys);
+	std::vector<beam::proto::Bbs::KeyRef> vKeys(nKeys);
+
+	for (uint32_t i = 0; i < nKeys; i++)
+	{
+		SetRandom(vSk[i]);
+		vPk[i].FromSk(vSk[i]);
+
+		vKeys[i].m_pSk = &vSk[i];
+		vKeys[i].m_pPk = &vPk[i];
+	}
+
+	const char szMsg[] = "Hello, World!";
+
+	Scalar::Native nonce;
+	SetRandom(nonce);
+	beam::ByteBuffer buf0;
+	verify_test(beam::proto::Bbs::Encrypt(buf0, vPk[iTrg], nonce, szMsg, sizeof(szMsg)));
+
+	MyExecutorMT ex;
+
+	for (uint32_t iCycle = 0; iCycle < 2; iCycle++)
+	{
+		std::unique_ptr<beam::Executor::Scope> pScope;
+		if (iCycle)
+			pScope = std::make_unique<beam::Executor::Scope>(ex);
+
+		beam::ByteBuffer buf = buf0;
+		uint8_t* p = &buf.at(0);
+		uint32_t n = (uint32_t) buf.size();
+
+		verify_test(beam::proto::Bbs::DecryptMulti(p, n, &vKeys.front(), nKeys) == iTrg);
+		verify_test(n == sizeof(szMsg));
+		verify_test(!memcmp(p, szMsg, n));
+
+		// no match, the message must be left intact
+		buf = buf0;
+		p = &buf.at(0);
+		n = (uint32_t) buf.size();
+
+		verify_test(beam::proto::Bbs::DecryptMulti(p, n, &vKeys.front(), iTrg) == iTrg);
+		verify_test((p == &buf.at(0)) && (n == buf.size()) && (buf == buf0));
+	}
+}
+
 void TestAll()
 {
 	TestUintBig();
@@ -2161,6 +2403,8 @@ void TestAll()
 	TestLelantus(false);
 	TestLelantus(true);
 	TestLelantusKeys();
+	TestExecutor();
+	TestBbsMulti();
 }
 
 
@@ -2471,6 +2715,66 @@ void RunBenchmark()
 		} while (bm.ShouldContinue());
 	}
 
+	{
+		const uint32_t nPairs = 1024;
+		std::vector<Hash::Value> vHashes(nPairs * 3);
+		std::vector<Hash::Processor::Pair> vPairs(nPairs);
+		for (uint32_t i = 0; i < nPairs; i++)
+		{
+			Hash::Processor::Pair& p = vPairs[i];
+			p.m_pL = &vHashes[i * 3];
+			p.m_pR = &vHashes[i * 3 + 1];
+			p.m_pRes = &vHashes[i * 3 + 2];
+		}
+
+		const Hash::Processor::PairsImpl::Enum eImpl = Hash::Processor::s_PairsImpl;
+		const char* szImpl[] = { "Hash.Pairs.Scalar x1K", "Hash.Pairs.Avx2 x1K", "Hash.Pairs.ShaNi x1K" };
+
+		for (uint32_t iImpl = 0; iImpl <= Hash::Processor::PairsImpl::ShaNi; iImpl++)
+		{
+			if (!Hash::Processor::IsPairsImplSupported((Hash::Processor::PairsImpl::Enum) iImpl))
+				continue;
+
+			Hash::Processor::s_PairsImpl = (Hash::Processor::PairsImpl::Enum) iImpl;
+
+			BenchmarkMeter bm(szImpl[iImpl]);
+			bm.N = 10;
+			do
+			{
+				for (uint32_t i = 0; i < bm.N; i++)
+					Hash::Processor::HashPairs(&vPairs.front(), nPairs);
+
+			} while (bm.ShouldContinue());
+		}
+
+		Hash::Processor::s_PairsImpl = eImpl;
+	}
+
+	for (uint32_t nThreads = 1; nThreads <= 64; nThreads <<= 1)
+	{
+		MyExecutorMT ex;
+		ex.m_Threads = nThreads;
+
+		char sz[0x40];
+		snprintf(sz, sizeof(sz), "Executor.Tasks x1K T=%u", nThreads);
+
+		std::atomic<uint32_t> nDone(0);
+
+		BenchmarkMeter bm(sz);
+		bm.N = 1;
+		do
+		{
+			for (uint32_t i = 0; i < bm.N; i++)
+			{
+				for (uint32_t j = 0; j < 1000; j++)
+					MyExecutorTask::Push(ex, nDone, 20);
+
+				ex.Flush(0);
+			}
+
+		} while (bm.ShouldContinue());
+	}
+
 	Hash::Processor() << "abcd" >> hv;
 
 	Signature sig;
@@ -2602,17 +2906,27 @@ void RunBenchmark()
 
 		uint8_t pBuf[0x400];
 
-		BenchmarkMeter bm("AES.XCrypt-1MB");
-		bm.N = 10;
-		do
+		const AES::Impl::Enum eImpl = AES::s_Impl;
+		const char* szImpl[] = { "AES.XCrypt-1MB", "AES.XCrypt.AesNi-1MB" };
+
+		for (uint32_t iImpl = 0; iImpl <= eImpl; iImpl++)
 		{
-			for (uint32_t i = 0; i < bm.N; i++)
+			AES::s_Impl = (AES::Impl::Enum) iImpl;
+
+			BenchmarkMeter bm(szImpl[iImpl]);
+			bm.N = 10;
+			do
 			{
-				for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
-					asc.XCrypt(enc, pBuf, sizeof(pBuf));
-			}
+				for (uint32_t i = 0; i < bm.N; i++)
+				{
+					for (size_t nSize = 0; nSize < 0x100000; nSize += sizeof(pBuf))
+						asc.XCrypt(enc, pBuf, sizeof(pBuf));
+				}
 
-		} while (bm.ShouldContinue());
+			} while (bm.ShouldContinue());
+		}
+
+		AES::s_Impl = eImpl;
 	}
 
 	{
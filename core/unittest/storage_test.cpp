@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <iostream>
+#include <thread>
 #include "../radixtree.h"
 #include "../navigator.h"
 #include "../../utility/serialize.h"
@@ -354,9 +355,70 @@ namespace beam
 
 		t.load(der);
 
+		{
+			// the whole tree is dirty now, rehash it in parallel
+			struct MyExec
+				:public ExecutorMT
+			{
+				virtual uint32_t get_Threads() override { return 4; }
+
+				virtual void RunThread(uint32_t iThread) override
+				{
+					ExecutorMT::Context ctx;
+					ctx.m_iThread = iThread;
+					RunThreadCtx(ctx);
+				}
+			} ex;
+
+			t.get_Hash(hv2, ex);
+			verify_test(hv2 == hv1);
+		}
+
 		t.get_Hash(hv2);
 		verify_test(hv2 == hv1);
 
+		// snapshot, read from another thread
+		uint64_t nEpoch = t.Publish();
+		verify_test(t.IsPublished() && (t.Publish() == nEpoch));
+
+		std::atomic<bool> bEntered(false);
+		std::thread thr([&]() {
+
+			RadixHashTree::Reader r(t, nEpoch);
+			verify_test(r.m_bEntered);
+			bEntered = true;
+
+			for (uint32_t i = 0; r.IsValid(); i = (i + 1) % vKeys.size())
+			{
+				UtxoTree::Cursor cu;
+				bool bCreate = false;
+				UtxoTree::MyLeaf* p = t.Find(cu, vKeys[i], bCreate);
+				verify_test(p);
+
+				Merkle::Proof proof;
+				t.get_Proof(proof, cu);
+
+				Merkle::Hash hvElement;
+				p->get_Hash(hvElement);
+
+				Merkle::Interpret(hvElement, proof);
+				verify_test(hvElement == hv1);
+			}
+		});
+
+		while (!bEntered)
+			std::this_thread::yield();
+
+		t.Unpublish(); // waits for the reader
+		thr.join();
+
+		{
+			RadixHashTree::Reader r(t, nEpoch);
+			verify_test(!r.m_bEntered);
+		}
+		verify_test(t.Publish() != nEpoch);
+		t.Unpublish();
+
 		// narrow traverse
 		struct Traveler
 			:public RadixTree::ITraveler
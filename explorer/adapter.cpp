@@ -424,6 +424,17 @@ private:
         return true;
     }
 
+    bool get_metrics(io::SerializedMsg& out) override
+    {
+        std::ostringstream os;
+        _node.WriteMetrics(os);
+
+        std::string s = os.str();
+        out.push_back({ s.data(), s.size() });
+
+        return true;
+    }
+
     HttpMsgCreator _packer;
 
     // node db interface
@@ -39,6 +39,9 @@ struct IAdapter {
     virtual bool get_blocks(io::SerializedMsg& out, uint64_t startHeight, uint64_t n) = 0;
 
     virtual bool get_peers(io::SerializedMsg& out) = 0;
+
+    /// Returns body for /metrics request, in Prometheus text format
+    virtual bool get_metrics(io::SerializedMsg& out) = 0;
 };
 
 IAdapter::Ptr create_adapter(Node& node);
@@ -31,7 +31,7 @@ static const unsigned SERVER_RESTART_INTERVAL = 1000;
 static const unsigned ACL_REFRESH_INTERVAL = 5555;
 
 enum Dirs {
-    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS, DIR_PEERS
+    DIR_STATUS, DIR_BLOCK, DIR_BLOCKS, DIR_PEERS, DIR_METRICS
     // etc
 };
 
@@ -112,7 +112,7 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
     const std::string& path = msg.msg->get_path();
 
     static const std::map<std::string_view, int> dirs {
-        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }, { "peers", DIR_PEERS}
+        { "status", DIR_STATUS }, { "block", DIR_BLOCK }, { "blocks", DIR_BLOCKS }, { "peers", DIR_PEERS}, { "metrics", DIR_METRICS }
     };
 
     const HttpConnection::Ptr& conn = it->second;
@@ -133,6 +133,9 @@ bool Server::on_request(uint64_t id, const HttpMsgReader::Message& msg) {
             case DIR_PEERS:
                 func = &Server::send_peers;
                 break;
+            case DIR_METRICS:
+                func = &Server::send_metrics;
+                break;
             default:
                 break;
         }
@@ -215,7 +218,14 @@ bool Server::send_peers(const HttpConnection::Ptr& conn) {
     return send(conn, 200, "OK");
 }
 
-bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message) {
+bool Server::send_metrics(const HttpConnection::Ptr& conn) {
+    if (!_backend.get_metrics(_body)) {
+        return send(conn, 500, "Internal error #3");
+    }
+    return send(conn, 200, "OK", "text/plain; version=0.0.4");
+}
+
+bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message, const char* contentType) {
     assert(conn);
 
     size_t bodySize = 0;
@@ -228,7 +238,7 @@ bool Server::send(const HttpConnection::Ptr& conn, int code, const char* message
         0, //headers,
         0, //sizeof(headers) / sizeof(HeaderPair),
         1,
-        "application/json",
+        contentType,
         bodySize
     );
 
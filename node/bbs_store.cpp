@@ -0,0 +1,674 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bbs_store.h"
+#include "../core/proto.h"
+#include "../utility/logger.h"
+
+namespace beam {
+
+#pragma pack (push, 1)
+struct BbsStore::RecordHdr
+{
+	uintBigFor<uint64_t>::Type m_ID;
+	BbsStore::Key m_Key;
+	uintBigFor<BbsChannel>::Type m_Channel;
+	uintBigFor<Timestamp>::Type m_Time;
+	uintBigFor<uint32_t>::Type m_Nonce;
+	uintBigFor<uint32_t>::Type m_Size;
+};
+#pragma pack (pop)
+
+static_assert(BbsStore::s_SegmentDuration_s <= 0x10000, "the posting time within the segment must fit 16 bits");
+
+namespace
+{
+	void FileSeek(FILE* pF, uint64_t nPos)
+	{
+#ifdef WIN32
+		int nRet = _fseeki64(pF, nPos, SEEK_SET);
+#else // WIN32
+		int nRet = fseeko(pF, nPos, SEEK_SET);
+#endif // WIN32
+		if (nRet)
+			std::ThrowLastError();
+	}
+
+	bool FileRead(FILE* pF, void* p, size_t n)
+	{
+		return fread(p, 1, n, pF) == n;
+	}
+
+	void FileWrite(FILE* pF, const void* p, size_t n)
+	{
+		if (fwrite(p, 1, n, pF) != n)
+			std::ThrowLastError();
+	}
+
+	FILE* FileOpen(const boost::filesystem::path& path)
+	{
+		// append mode: all the writes go to the end, reads are allowed anywhere.
+		// Still the stream must be positioned (fseek) when switching from reading to writing
+#ifdef WIN32
+		FILE* pF = _wfopen(path.c_str(), L"a+b");
+#else // WIN32
+		FILE* pF = fopen(path.c_str(), "a+b");
+#endif // WIN32
+
+		if (!pF)
+			std::ThrowLastError();
+		return pF;
+	}
+
+	boost::filesystem::path MakePath(const std::string& s)
+	{
+#ifdef WIN32
+		return boost::filesystem::path(Utf8toUtf16(s));
+#else // WIN32
+		return boost::filesystem::path(s);
+#endif // WIN32
+	}
+
+	const char s_szExt[] = ".bbs";
+}
+
+void BbsStore::Open(const std::string& sDir)
+{
+	Close();
+
+	boost::filesystem::path dir = MakePath(sDir);
+	boost::filesystem::create_directories(dir);
+
+	std::vector<uint32_t> vBuckets;
+	for (boost::filesystem::directory_iterator it(dir), itEnd; itEnd != it; it++)
+	{
+		const boost::filesystem::path& path = it->path();
+		if (path.extension() != s_szExt)
+			continue;
+
+		std::string sName = path.stem().string();
+		char* szEnd = nullptr;
+		unsigned long iBucket = strtoul(sName.c_str(), &szEnd, 16);
+
+		if (!sName.empty() && !*szEnd && (iBucket < Entry::s_Deleted))
+			vBuckets.push_back(static_cast<uint32_t>(iBucket));
+	}
+
+	m_Dir = std::move(dir);
+	ZeroObject(m_Totals);
+	ECC::GenRandom(&m_KeySalt, sizeof(m_KeySalt));
+
+	try
+	{
+		for (uint32_t iBucket : vBuckets)
+			LoadSegment(iBucket);
+
+		// the segments are interleaved
+		for (auto& x : m_mapChannels)
+			std::sort(x.second.begin(), x.second.end());
+	}
+	catch (...)
+	{
+		Close();
+		throw;
+	}
+
+	LOG_INFO() << "Bbs store: " << m_Segments.size() << " segments, " << m_Totals.m_Count << " messages, " << m_Totals.m_Size << " bytes";
+}
+
+void BbsStore::LoadSegment(uint32_t iBucket)
+{
+	boost::filesystem::path path = get_SegmentPath(iBucket);
+	Segment& s = OpenSegment(iBucket);
+
+	uint64_t nFileSize = boost::filesystem::file_size(path);
+	FileSeek(s.m_pF, 0);
+
+	while (true)
+	{
+		RecordHdr hdr;
+		if (s.m_Size + sizeof(hdr) > nFileSize)
+			break;
+		if (!FileRead(s.m_pF, &hdr, sizeof(hdr)))
+			break;
+
+		uint64_t id;
+		BbsChannel ch;
+		Timestamp t;
+		uint32_t nSize;
+		hdr.m_ID.Export(id);
+		hdr.m_Channel.Export(ch);
+		hdr.m_Time.Export(t);
+		hdr.m_Size.Export(nSize);
+
+		if (!id || (nSize > proto::Bbs::s_MaxMsgSize) || (t / s_SegmentDuration_s != iBucket))
+			break; // corrupted
+
+		uint64_t nRecord = sizeof(hdr) + nSize;
+		if (s.m_Size + nRecord > nFileSize)
+			break; // incomplete
+
+		FileSeek(s.m_pF, s.m_Size + nRecord);
+
+		// place the entry
+		if (m_Entries.empty())
+			m_ID0 = id;
+
+		if (id < m_ID0)
+		{
+			Entry eDel;
+			eDel.m_Segment = Entry::s_Deleted;
+			m_Entries.insert(m_Entries.begin(), static_cast<size_t>(m_ID0 - id), eDel);
+			m_ID0 = id;
+		}
+
+		size_t iEntry = static_cast<size_t>(id - m_ID0);
+		if (iEntry >= m_Entries.size())
+		{
+			Entry eDel;
+			eDel.m_Segment = Entry::s_Deleted;
+			m_Entries.resize(iEntry + 1, eDel);
+		}
+		else
+		{
+			if (m_Entries[iEntry].IsLive())
+				break; // duplicate ID, corrupted
+		}
+
+		Entry e;
+		e.m_Offset = s.m_Size;
+		e.m_dt = t % s_SegmentDuration_s;
+		e.m_Segment = iBucket;
+		e.m_KeyTag = get_KeyTag(hdr.m_Key);
+
+		m_Entries[iEntry] = e;
+		Index(id, e, ch);
+
+		if (!s.m_Count || (s.m_IDMin > id))
+			s.m_IDMin = id;
+		s.m_Count++;
+		s.m_MsgSize += nSize;
+		std::setmax(s.m_MaxTime, t);
+		std::setmax(m_LastID, id);
+
+		m_Totals.m_Count++;
+		m_Totals.m_Size += nSize;
+
+		s.m_Size += nRecord;
+	}
+
+	if (s.m_Size < nFileSize)
+	{
+		LOG_WARNING() << "Bbs segment " << path << " truncated at " << s.m_Size << " of " << nFileSize;
+		TruncateSegment(iBucket, s, nFileSize);
+	}
+
+	if (!s.m_Count)
+		DeleteSegment(m_Segments.find(iBucket));
+}
+
+void BbsStore::TruncateSegment(uint32_t iBucket, Segment& s, uint64_t nFileSize)
+{
+	if (s.m_pF)
+	{
+		fclose(s.m_pF); // flushes what's buffered, it's cut off below
+		s.m_pF = nullptr;
+	}
+
+	boost::filesystem::path path = get_SegmentPath(iBucket);
+	if (nFileSize > s.m_Size)
+	{
+		boost::system::error_code ec;
+		boost::filesystem::resize_file(path, s.m_Size, ec);
+		if (ec)
+			LOG_WARNING() << "Bbs segment " << path << " truncate error: " << ec.message();
+	}
+
+	s.m_pF = FileOpen(path);
+}
+
+void BbsStore::Close()
+{
+	for (auto& x : m_Segments)
+		if (x.second.m_pF)
+			fclose(x.second.m_pF);
+
+	m_Segments.clear();
+	m_Entries.clear();
+	m_vKeys.clear();
+	m_mapChannels.clear();
+	m_ID0 = 1;
+	m_LastID = 0;
+	ZeroObject(m_Totals);
+	m_Dir.clear();
+}
+
+void BbsStore::Delete(const std::string& sDir)
+{
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(MakePath(sDir), ec);
+}
+
+uint32_t BbsStore::get_KeyTag(const Key& key)
+{
+	uint32_t val;
+	static_assert(sizeof(val) <= Key::nBytes, "");
+	memcpy(&val, key.m_pData, sizeof(val)); // it's a hash, any byte order will do
+	return val;
+}
+
+size_t BbsStore::get_KeySlot(uint32_t nTag) const
+{
+	// salted, so that the keys ground to share the tag bits can't be piled into one cluster
+	uint64_t h = static_cast<uint64_t>(nTag ^ m_KeySalt) * 0x9e3779b97f4a7c15ULL;
+	return static_cast<size_t>(h >> 32) & (m_vKeys.size() - 1);
+}
+
+void BbsStore::KeyIns(uint64_t id, uint32_t nTag)
+{
+	// keep the load factor below 1/2
+	if ((m_Totals.m_Count + 1) * 2ULL > m_vKeys.size())
+	{
+		std::vector<uint64_t> v(std::max<size_t>(m_vKeys.size() * 2, 0x100));
+		m_vKeys.swap(v);
+
+		for (uint64_t idOld : v)
+			if (idOld)
+				KeyIns(idOld, get_Entry(idOld)->m_KeyTag);
+	}
+
+	size_t nMask = m_vKeys.size() - 1;
+	for (size_t i = get_KeySlot(nTag); ; i = (i + 1) & nMask)
+	{
+		if (!m_vKeys[i])
+		{
+			m_vKeys[i] = id;
+			break;
+		}
+	}
+}
+
+void BbsStore::KeyDel(uint64_t id, uint32_t nTag)
+{
+	size_t nMask = m_vKeys.size() - 1;
+	size_t i = get_KeySlot(nTag);
+	for (; m_vKeys[i] != id; i = (i + 1) & nMask)
+		assert(m_vKeys[i]);
+
+	// shift the rest of the cluster back, no tombstones
+	for (size_t j = i; ; )
+	{
+		j = (j + 1) & nMask;
+		uint64_t idNext = m_vKeys[j];
+		if (!idNext)
+			break;
+
+		size_t k = get_KeySlot(get_Entry(idNext)->m_KeyTag);
+		// move it if its home slot isn't in the cyclic range (i, j]
+		if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+			continue;
+
+		m_vKeys[i] = idNext;
+		i = j;
+	}
+
+	m_vKeys[i] = 0;
+}
+
+boost::filesystem::path BbsStore::get_SegmentPath(uint32_t iBucket) const
+{
+	char szName[0x20];
+	snprintf(szName, sizeof(szName), "%08x%s", iBucket, s_szExt);
+	return m_Dir / szName;
+}
+
+BbsStore::Segment& BbsStore::OpenSegment(uint32_t iBucket)
+{
+	Segment& s = m_Segments[iBucket];
+	if (!s.m_pF)
+		s.m_pF = FileOpen(get_SegmentPath(iBucket));
+
+	return s;
+}
+
+const BbsStore::Entry* BbsStore::get_Entry(uint64_t id) const
+{
+	if (id < m_ID0)
+		return nullptr;
+
+	uint64_t iEntry = id - m_ID0;
+	if (iEntry >= m_Entries.size())
+		return nullptr;
+
+	const Entry& e = m_Entries[static_cast<size_t>(iEntry)];
+	return e.IsLive() ? &e : nullptr;
+}
+
+void BbsStore::Index(uint64_t id, const Entry& e, BbsChannel ch)
+{
+	KeyIns(id, e.m_KeyTag);
+	m_mapChannels[ch].push_back(id);
+}
+
+uint64_t BbsStore::Ins(const Data& d)
+{
+	assert(IsOpen());
+
+	uint64_t id = m_LastID + 1;
+	uint32_t iBucket = static_cast<uint32_t>(d.m_TimePosted / s_SegmentDuration_s);
+	Segment& s = OpenSegment(iBucket);
+
+	RecordHdr hdr;
+	hdr.m_ID = id;
+	hdr.m_Key = d.m_Key;
+	hdr.m_Channel = d.m_Channel;
+	hdr.m_Time = d.m_TimePosted;
+	hdr.m_Nonce = d.m_Nonce;
+	hdr.m_Size = d.m_Message.n;
+
+	try
+	{
+		// the stream could've been read from, it must be positioned before writing
+		FileSeek(s.m_pF, s.m_Size);
+
+		FileWrite(s.m_pF, &hdr, sizeof(hdr));
+		FileWrite(s.m_pF, d.m_Message.p, d.m_Message.n);
+		if (fflush(s.m_pF))
+			std::ThrowLastError();
+	}
+	catch (...)
+	{
+		// don't leave a partial record, the following ones would be misaligned
+		TruncateSegment(iBucket, s, s.m_Size + 1);
+		if (!s.m_Count)
+			DeleteSegment(m_Segments.find(iBucket));
+		throw;
+	}
+
+	if (m_Entries.empty())
+		m_ID0 = id;
+
+	m_Entries.emplace_back();
+	Entry& e = m_Entries.back();
+	e.m_Offset = s.m_Size;
+	e.m_dt = d.m_TimePosted % s_SegmentDuration_s;
+	e.m_Segment = iBucket;
+	e.m_KeyTag = get_KeyTag(d.m_Key);
+
+	Index(id, e, d.m_Channel);
+
+	if (!s.m_Count)
+		s.m_IDMin = id;
+	s.m_Count++;
+	s.m_MsgSize += d.m_Message.n;
+	s.m_Size += sizeof(hdr) + d.m_Message.n;
+	std::setmax(s.m_MaxTime, d.m_TimePosted);
+
+	m_LastID = id;
+	m_Totals.m_Count++;
+	m_Totals.m_Size += d.m_Message.n;
+
+	return id;
+}
+
+uint64_t BbsStore::Find(const Key& key) const
+{
+	if (m_vKeys.empty())
+		return 0;
+
+	uint32_t nTag = get_KeyTag(key);
+	size_t nMask = m_vKeys.size() - 1;
+
+	for (size_t i = get_KeySlot(nTag); ; i = (i + 1) & nMask)
+	{
+		uint64_t id = m_vKeys[i];
+		if (!id)
+			break;
+
+		const Entry* pE = get_Entry(id);
+		assert(pE);
+		if (pE->m_KeyTag != nTag)
+			continue;
+
+		RecordHdr hdr;
+		ReadHdr(*pE, id, hdr);
+		if (hdr.m_Key == key)
+			return id;
+	}
+
+	return 0;
+}
+
+bool BbsStore::Find(uint64_t id, Data& d, ByteBuffer& buf)
+{
+	const Entry* pE = get_Entry(id);
+	if (!pE)
+		return false;
+
+	ReadMsg(*pE, id, d, buf);
+	return true;
+}
+
+void BbsStore::ReadHdr(const Entry& e, uint64_t id, RecordHdr& hdr) const
+{
+	auto it = m_Segments.find(e.m_Segment);
+	assert(m_Segments.end() != it);
+	FILE* pF = it->second.m_pF;
+
+	FileSeek(pF, e.m_Offset);
+
+	if (!FileRead(pF, &hdr, sizeof(hdr)) ||
+		(hdr.m_ID != uintBigFrom(id)))
+	{
+		CorruptionException exc;
+		exc.m_sErr = "Bbs segment";
+		throw exc;
+	}
+}
+
+void BbsStore::ReadMsg(const Entry& e, uint64_t id, Data& d, ByteBuffer& buf)
+{
+	RecordHdr hdr;
+	ReadHdr(e, id, hdr); // leaves the stream at the msg
+
+	uint32_t nSize;
+	hdr.m_Size.Export(nSize);
+	buf.resize(nSize);
+
+	if (nSize && !FileRead(m_Segments.find(e.m_Segment)->second.m_pF, &buf.front(), nSize))
+	{
+		CorruptionException exc;
+		exc.m_sErr = "Bbs segment";
+		throw exc;
+	}
+
+	d.m_Key = hdr.m_Key;
+	hdr.m_Channel.Export(d.m_Channel);
+	hdr.m_Time.Export(d.m_TimePosted);
+	hdr.m_Nonce.Export(d.m_Nonce);
+	d.m_Message = Blob(buf);
+}
+
+uint64_t BbsStore::FindCursor(Timestamp t) const
+{
+	uint64_t ret = m_LastID + 1;
+	uint32_t iBucket = static_cast<uint32_t>(t / s_SegmentDuration_s);
+
+	auto it = m_Segments.lower_bound(iBucket);
+	if (m_Segments.end() == it)
+		return ret;
+
+	// all the msgs of the following segments are newer
+	for (auto it2 = (it->first == iBucket) ? std::next(it) : it; m_Segments.end() != it2; it2++)
+		std::setmin(ret, it2->second.m_IDMin);
+
+	if (it->first == iBucket)
+	{
+		const Segment& s = it->second;
+		Timestamp dt = t % s_SegmentDuration_s;
+
+		uint32_t nLeft = s.m_Count;
+		for (uint64_t id = s.m_IDMin; nLeft && (id < ret); id++)
+		{
+			const Entry* pE = get_Entry(id);
+			if (!pE || (pE->m_Segment != iBucket))
+				continue;
+
+			if (pE->m_dt >= dt)
+			{
+				ret = id;
+				break;
+			}
+
+			nLeft--;
+		}
+	}
+
+	return ret;
+}
+
+Timestamp BbsStore::get_MaxTime() const
+{
+	return m_Segments.empty() ? 0 : m_Segments.rbegin()->second.m_MaxTime;
+}
+
+void BbsStore::DeleteOlder(Timestamp t)
+{
+	while (!m_Segments.empty())
+	{
+		auto it = m_Segments.begin();
+		if ((it->first + 1ULL) * s_SegmentDuration_s > t)
+			break;
+
+		DeleteSegment(it);
+	}
+}
+
+bool BbsStore::DeleteOldest()
+{
+	if (m_Segments.empty())
+		return false;
+
+	DeleteSegment(m_Segments.begin());
+	return true;
+}
+
+void BbsStore::DeleteSegment(std::map<uint32_t, Segment>::iterator itS)
+{
+	Segment& s = itS->second;
+
+	// the msgs of the segment are not below m_IDMin. The oldest segments, that are usually deleted, are near the front
+	uint32_t nLeft = s.m_Count;
+	for (uint64_t id = s.m_IDMin; nLeft; id++)
+	{
+		assert(id >= m_ID0);
+		Entry& e = m_Entries[static_cast<size_t>(id - m_ID0)];
+		if (e.m_Segment != itS->first)
+			continue;
+
+		KeyDel(id, e.m_KeyTag);
+		e.m_Segment = Entry::s_Deleted;
+		nLeft--;
+	}
+
+	m_Totals.m_Count -= s.m_Count;
+	m_Totals.m_Size -= s.m_MsgSize;
+
+	// trim the deleted IDs from the front. Those in the middle are skipped during the enumeration, and trimmed later
+	for (auto itC = m_mapChannels.begin(); m_mapChannels.end() != itC; )
+	{
+		std::deque<uint64_t>& q = itC->second;
+
+		while (!q.empty() && !get_Entry(q.front()))
+			q.pop_front();
+
+		if (q.empty())
+			m_mapChannels.erase(itC++);
+		else
+			itC++;
+	}
+
+	while (!m_Entries.empty() && !m_Entries.front().IsLive())
+	{
+		m_Entries.pop_front();
+		m_ID0++;
+	}
+
+	boost::filesystem::path path = get_SegmentPath(itS->first);
+
+	if (s.m_pF)
+		fclose(s.m_pF);
+	m_Segments.erase(itS);
+
+	boost::system::error_code ec;
+	boost::filesystem::remove(path, ec);
+	if (ec)
+		LOG_WARNING() << "Bbs segment " << path << " delete error: " << ec.message();
+}
+
+void BbsStore::EnumChannel(WalkerChannel& x)
+{
+	x.m_pStore = this;
+}
+
+bool BbsStore::WalkerChannel::MoveNext()
+{
+	auto itC = m_pStore->m_mapChannels.find(m_Data.m_Channel);
+	if (m_pStore->m_mapChannels.end() == itC)
+		return false;
+
+	const std::deque<uint64_t>& q = itC->second;
+	for (auto it = std::upper_bound(q.begin(), q.end(), m_ID); q.end() != it; it++)
+	{
+		m_ID = *it;
+
+		const Entry* pE = m_pStore->get_Entry(m_ID);
+		if (pE)
+		{
+			m_pStore->ReadMsg(*pE, m_ID, m_Data, m_Buf);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void BbsStore::EnumAll(WalkerLite& x) const
+{
+	x.m_pStore = this;
+}
+
+bool BbsStore::WalkerLite::MoveNext()
+{
+	std::setmax(m_ID, m_pStore->m_ID0 - 1);
+
+	while (++m_ID <= m_pStore->m_LastID)
+	{
+		const Entry* pE = m_pStore->get_Entry(m_ID);
+		if (pE)
+		{
+			RecordHdr hdr;
+			m_pStore->ReadHdr(*pE, m_ID, hdr);
+
+			m_Key = hdr.m_Key;
+			hdr.m_Size.Export(m_Size);
+			return true;
+		}
+	}
+
+	m_ID = m_pStore->m_LastID; // so that it can be resumed
+	return false;
+}
+
+} // namespace beam
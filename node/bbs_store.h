@@ -0,0 +1,140 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include "db.h"
+#include <boost/filesystem.hpp>
+#include <map>
+#include <deque>
+
+namespace beam {
+
+// Append-only BBS message log, split into segment files by the posting time.
+// Expired messages are deleted together with their whole segment, there are no per-message deletes.
+// The key and channel indexes are in memory only, they are rebuilt from the segments on open.
+// Per message only the record position and a short key tag are kept in memory, the full key is verified on disk.
+class BbsStore
+{
+public:
+	typedef NodeDB::WalkerBbs::Key Key;
+	typedef NodeDB::WalkerBbs::Data Data;
+
+	static const Timestamp s_SegmentDuration_s = 3600;
+
+	~BbsStore() { Close(); }
+
+	void Open(const std::string& sDir); // created if doesn't exist. Throws on error
+	void Close();
+	bool IsOpen() const { return !m_Dir.empty(); }
+
+	static void Delete(const std::string& sDir); // all the segments and the directory itself
+
+	uint64_t Ins(const Data&); // must be unique (if not sure - first try to find it). Returns the ID
+	uint64_t Find(const Key&) const; // returns the ID, or 0 if not found
+	bool Find(uint64_t id, Data&, ByteBuffer&); // m_Message will point to the buffer
+
+	uint64_t FindCursor(Timestamp) const; // lowest ID of a msg posted not before the given time, or LastID + 1
+	uint64_t get_LastID() const { return m_LastID; }
+	Timestamp get_MaxTime() const;
+	const NodeDB::BbsTotals& get_Totals() const { return m_Totals; }
+
+	void DeleteOlder(Timestamp); // drops the segments in which all the msgs are older
+	bool DeleteOldest(); // drops the oldest segment. Returns false if there's none
+
+	struct WalkerChannel // msgs of the channel, ordered by ID. Set m_Data.m_Channel and m_ID (exclusive lower bound) before invocation
+	{
+		uint64_t m_ID;
+		Data m_Data;
+
+		bool MoveNext();
+
+	private:
+		friend class BbsStore;
+		BbsStore* m_pStore;
+		ByteBuffer m_Buf;
+	};
+
+	void EnumChannel(WalkerChannel&);
+
+	struct WalkerLite // all msgs ordered by ID, without reading them. Set m_ID (exclusive lower bound) before invocation
+	{
+		uint64_t m_ID;
+		Key m_Key;
+		uint32_t m_Size;
+
+		bool MoveNext();
+
+	private:
+		friend class BbsStore;
+		const BbsStore* m_pStore;
+	};
+
+	void EnumAll(WalkerLite&) const;
+
+private:
+
+	struct Entry
+	{
+		uint64_t m_Offset : 48; // of the record within the segment
+		uint64_t m_dt : 16; // posting time within the segment
+		uint32_t m_Segment;
+		uint32_t m_KeyTag; // 1st key bytes
+
+		static const uint32_t s_Deleted = static_cast<uint32_t>(-1);
+		bool IsLive() const { return s_Deleted != m_Segment; }
+	};
+
+	struct Segment
+	{
+		FILE* m_pF = nullptr;
+		uint64_t m_Size = 0; // the end of the last complete record
+		uint64_t m_IDMin = 0;
+		uint32_t m_Count = 0;
+		uint64_t m_MsgSize = 0;
+		Timestamp m_MaxTime = 0;
+	};
+
+	struct RecordHdr;
+
+	boost::filesystem::path m_Dir;
+	std::map<uint32_t, Segment> m_Segments; // by the time bucket
+	std::deque<Entry> m_Entries; // indexed by (ID - m_ID0), with gaps
+	uint64_t m_ID0 = 1;
+	uint64_t m_LastID = 0;
+	NodeDB::BbsTotals m_Totals;
+
+	// key tag -> ID, open addressing with linear probing. 0 for a free slot
+	std::vector<uint64_t> m_vKeys;
+	uint32_t m_KeySalt = 0;
+
+	std::map<BbsChannel, std::deque<uint64_t> > m_mapChannels; // ascending IDs, may contain deleted ones
+
+	static uint32_t get_KeyTag(const Key&);
+	size_t get_KeySlot(uint32_t nTag) const;
+	void KeyIns(uint64_t id, uint32_t nTag);
+	void KeyDel(uint64_t id, uint32_t nTag);
+
+	boost::filesystem::path get_SegmentPath(uint32_t iBucket) const;
+	Segment& OpenSegment(uint32_t iBucket);
+	void LoadSegment(uint32_t iBucket);
+	void TruncateSegment(uint32_t iBucket, Segment&, uint64_t nFileSize);
+	void Index(uint64_t id, const Entry&, BbsChannel);
+	const Entry* get_Entry(uint64_t id) const;
+	void DeleteSegment(std::map<uint32_t, Segment>::iterator);
+	void ReadHdr(const Entry&, uint64_t id, RecordHdr&) const;
+	void ReadMsg(const Entry&, uint64_t id, Data&, ByteBuffer&);
+};
+
+} // namespace beam
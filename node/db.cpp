@@ -99,6 +99,16 @@ namespace beam {
 #define TblAssets_Data			"MetaData"
 #define TblAssets_LockHeight	"LockHeight"
 
+#define TblBodyCache			"BodyCache"
+#define TblBodyCache_Row		"Row"
+#define TblBodyCache_Height		"Height"
+#define TblBodyCache_Height0	"Height0"
+#define TblBodyCache_LoMin		"LoMin"
+#define TblBodyCache_LoMax		"LoMax"
+#define TblBodyCache_HiMin		"HiMin"
+#define TblBodyCache_HiMax		"HiMax"
+#define TblBodyCache_Body		"Body"
+
 NodeDB::NodeDB()
 	:m_pDb(NULL)
 {
@@ -334,7 +344,7 @@ void NodeDB::Open(const char* szPath)
 		bCreate = !rs.Step();
 	}
 
-	const uint64_t nVersionTop = 21;
+	const uint64_t nVersionTop = 22;
 
 	Transaction t(*this);
 
@@ -366,6 +376,10 @@ void NodeDB::Open(const char* szPath)
 
 			LOG_INFO() << "DB migrate from" << 20;
 			MigrateFrom20();
+			// no break;
+
+		case 21: // before body cache
+			CreateTables22();
 
 			ParamIntSet(ParamID::DbVer, nVersionTop);
 			// no break;
@@ -487,6 +501,7 @@ void NodeDB::Create()
 		"[" TblTxo_SpendHeight		"] INTEGER)");
 
 	CreateTables20();
+	CreateTables22();
 }
 
 void NodeDB::CreateTables20()
@@ -509,6 +524,21 @@ void NodeDB::CreateTables20()
 	ExecQuick("CREATE INDEX [Idx" TblAssets "Own] ON [" TblAssets "] ([" TblAssets_Owner "])");
 }
 
+void NodeDB::CreateTables22()
+{
+	ExecQuick("CREATE TABLE [" TblBodyCache "] ("
+		"[" TblBodyCache_Row		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_Height		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_Height0	"] INTEGER NOT NULL,"
+		"[" TblBodyCache_LoMin		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_LoMax		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_HiMin		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_HiMax		"] INTEGER NOT NULL,"
+		"[" TblBodyCache_Body		"] BLOB NOT NULL)");
+
+	ExecQuick("CREATE INDEX [Idx" TblBodyCache "] ON [" TblBodyCache "] ([" TblBodyCache_Row "],[" TblBodyCache_Height0 "]);");
+}
+
 void NodeDB::Vacuum()
 {
 	ExecQuick("VACUUM");
@@ -926,6 +956,10 @@ bool NodeDB::DeleteState(uint64_t rowid, uint64_t& rowPrev)
 	if (StateFlags::Reachable & nFlags)
 		TipReachableDel(rowid);
 
+	rs.Reset(*this, Query::BodyCacheDelRow, "DELETE FROM " TblBodyCache " WHERE " TblBodyCache_Row "=?");
+	rs.put(0, rowid);
+	rs.Step();
+
 	rs.Reset(*this, Query::StateDel, "DELETE FROM " TblStates " WHERE rowid=?");
 	rs.put(0, rowid);
 
@@ -1741,6 +1775,64 @@ void NodeDB::DeleteEventsFrom(Height h)
 	rs.Step();
 }
 
+void NodeDB::BodyCacheIns(const CachedBody& x, const Blob& body)
+{
+	Recordset rs(*this, Query::BodyCacheIns, "INSERT INTO " TblBodyCache "(" TblBodyCache_Row "," TblBodyCache_Height "," TblBodyCache_Height0 "," TblBodyCache_LoMin "," TblBodyCache_LoMax "," TblBodyCache_HiMin "," TblBodyCache_HiMax "," TblBodyCache_Body ") VALUES (?,?,?,?,?,?,?,?)");
+	rs.put(0, x.m_Row);
+	rs.put(1, x.m_Height);
+	rs.put(2, x.m_h0);
+	rs.put(3, x.m_Lo.m_Min);
+	rs.put(4, x.m_Lo.m_Max);
+	rs.put(5, x.m_Hi.m_Min);
+	rs.put(6, x.m_Hi.m_Max);
+	rs.put(7, body);
+	rs.Step();
+	TestChanged1Row();
+}
+
+bool NodeDB::BodyCacheFind(uint64_t rowid, Height h0, Height hLo1, Height hHi1, ByteBuffer& body)
+{
+	Recordset rs(*this, Query::BodyCacheFind, "SELECT " TblBodyCache_Body " FROM " TblBodyCache " WHERE " TblBodyCache_Row "=? AND " TblBodyCache_Height0 "=? AND "
+		TblBodyCache_LoMin "<=? AND " TblBodyCache_LoMax ">=? AND " TblBodyCache_HiMin "<=? AND " TblBodyCache_HiMax ">=? LIMIT 1");
+	rs.put(0, rowid);
+	rs.put(1, h0);
+	rs.put(2, hLo1);
+	rs.put(3, hLo1);
+	rs.put(4, hHi1);
+	rs.put(5, hHi1);
+
+	if (!rs.Step())
+		return false;
+
+	rs.get(0, body);
+	return true;
+}
+
+void NodeDB::BodyCacheCut(Height hMax)
+{
+	Recordset rs(*this, Query::BodyCacheCut, "UPDATE " TblBodyCache " SET " TblBodyCache_LoMax "=MIN(" TblBodyCache_LoMax ",?)," TblBodyCache_HiMax "=MIN(" TblBodyCache_HiMax ",?) WHERE "
+		TblBodyCache_LoMax ">? OR " TblBodyCache_HiMax ">?");
+	rs.put(0, hMax);
+	rs.put(1, hMax);
+	rs.put(2, hMax);
+	rs.put(3, hMax);
+	rs.Step();
+
+	rs.Reset(*this, Query::BodyCacheDelEmpty, "DELETE FROM " TblBodyCache " WHERE " TblBodyCache_LoMin ">" TblBodyCache_LoMax " OR " TblBodyCache_HiMin ">" TblBodyCache_HiMax);
+	rs.Step();
+}
+
+void NodeDB::BodyCacheDelOutdated(Height hTxoLo, Height hTxoHi)
+{
+	// horizons below ours can't be served anymore.
+	// In addition inputs of the blocks below TxoLo are cut, bodies that depend on them (i.e. with non-zero h0) are outdated
+	Recordset rs(*this, Query::BodyCacheDelOutdated, "DELETE FROM " TblBodyCache " WHERE " TblBodyCache_LoMax "<? OR " TblBodyCache_HiMax "<? OR (" TblBodyCache_Height0 ">0 AND " TblBodyCache_Height "<=?)");
+	rs.put(0, hTxoLo);
+	rs.put(1, hTxoHi);
+	rs.put(2, hTxoLo);
+	rs.Step();
+}
+
 void NodeDB::EnumEvents(WalkerEvent& x, Height hMin)
 {
 	x.m_Rs.Reset(*this, Query::EventEnum, "SELECT " TblEvents_Height "," TblEvents_Body "," TblEvents_Key " FROM " TblEvents " WHERE " TblEvents_Height ">=? ORDER BY "  TblEvents_Height " ASC," TblEvents_Body " ASC");
@@ -1817,22 +1909,6 @@ bool NodeDB::EnumBbs(IBbsHistogram& x)
 	return true;
 }
 
-void NodeDB::EnumAllBbsSeq(WalkerBbsLite& x)
-{
-	x.m_Rs.Reset(*this, Query::BbsEnumAllSeq, "SELECT " TblBbs_ID "," TblBbs_Key ",LENGTH(" TblBbs_Msg ") FROM " TblBbs " WHERE " TblBbs_ID ">? ORDER BY " TblBbs_ID);
-	x.m_Rs.put(0, x.m_ID);
-}
-
-bool NodeDB::WalkerBbsLite::MoveNext()
-{
-	if (!m_Rs.Step())
-		return false;
-	m_Rs.get(0, m_ID);
-	m_Rs.get(1, m_Key);
-	m_Rs.get(2, m_Size);
-	return true;
-}
-
 void NodeDB::EnumAllBbs(WalkerBbsTimeLen& x)
 {
 	x.m_Rs.Reset(*this, Query::BbsEnumAll, "SELECT " TblBbs_ID "," TblBbs_Time ",LENGTH(" TblBbs_Msg ") FROM " TblBbs " ORDER BY " TblBbs_ID);
@@ -1883,11 +1959,6 @@ uint64_t NodeDB::get_AutoincrementID(const char* szTable)
 	return id;
 }
 
-uint64_t NodeDB::get_BbsLastID()
-{
-	return get_AutoincrementID(TblBbs);
-}
-
 bool NodeDB::WalkerBbs::MoveNext()
 {
 	if (!m_Rs.Step())
@@ -1902,26 +1973,6 @@ bool NodeDB::WalkerBbs::MoveNext()
 	return true;
 }
 
-bool NodeDB::BbsFind(WalkerBbs& x)
-{
-	x.m_Rs.Reset(*this, Query::BbsFind, "SELECT " TblBbs_AllFieldsListed " FROM " TblBbs " WHERE " TblBbs_Key "=?");
-
-	x.m_Rs.put(0, x.m_Data.m_Key);
-	return x.MoveNext();
-}
-
-uint64_t NodeDB::BbsFind(const WalkerBbs::Key& key)
-{
-	Recordset rs(*this,Query::BbsFindRaw, "SELECT rowid FROM " TblBbs " WHERE " TblBbs_Key "=?");
-	rs.put(0, key);
-	if (!rs.Step())
-		return 0;
-
-	uint64_t id;
-	rs.get(0, id);
-	return id;
-}
-
 void NodeDB::BbsDel(uint64_t id)
 {
 	Recordset rs(*this, Query::BbsDel, "DELETE FROM " TblBbs " WHERE " TblBbs_ID "=?");
@@ -1945,33 +1996,6 @@ uint64_t NodeDB::BbsIns(const WalkerBbs::Data& d)
 	return sqlite3_last_insert_rowid(m_pDb);
 }
 
-uint64_t NodeDB::BbsFindCursor(Timestamp t)
-{
-	Recordset rs(*this, Query::BbsFindCursor, "SELECT " TblBbs_ID " FROM " TblBbs " WHERE " TblBbs_Time ">=? ORDER BY " TblBbs_ID " ASC LIMIT 1");
-	rs.put(0, t);
-
-	if (!rs.Step())
-		return get_BbsLastID() + 1;
-
-	if (rs.IsNull(0))
-		return 0;
-
-	uint64_t id;
-	rs.get(0, id);
-	return id;
-}
-
-Timestamp NodeDB::get_BbsMaxTime()
-{
-	Recordset rs(*this, Query::BbsMaxTime, "SELECT MAX(" TblBbs_Time ") FROM " TblBbs);
-	if (!rs.Step())
-		return 0;
-
-	Timestamp ret;
-	rs.get(0, ret);
-	return ret;
-}
-
 uint64_t NodeDB::FindStateWorkGreater(const Difficulty::Raw& d)
 {
 	Recordset rs(*this, Query::StateFindWorkGreater, "SELECT rowid FROM " TblStates " WHERE " TblStates_ChainWork ">? AND " TblStates_Flags "& ? != 0 ORDER BY " TblStates_ChainWork " ASC LIMIT 1");
@@ -2083,6 +2107,20 @@ Height NodeDB::FindKernel(const Blob& key)
 	return h;
 }
 
+void NodeDB::EnumKernels(WalkerKernel& x)
+{
+	x.m_Rs.Reset(*this, Query::KernelEnum, "SELECT " TblKernels_Key "," TblKernels_Height " FROM " TblKernels);
+}
+
+bool NodeDB::WalkerKernel::MoveNext()
+{
+	if (!m_Rs.Step())
+		return false;
+	m_Rs.get(0, m_ID);
+	m_Rs.get(1, m_Height);
+	return true;
+}
+
 Height NodeDB::FindBlock(const Blob& hash)
 {
     Recordset rs(*this, Query::BlockFind, "SELECT " TblStates_Height " FROM " TblStates" WHERE " TblStates_Hash "=? ORDER BY " TblStates_Height " DESC LIMIT 1");
@@ -2295,6 +2333,408 @@ void NodeDB::StatesMmr::SaveElement(const Merkle::Hash& hv, const Merkle::Positi
 		CacheAdd(hv, pos);
 }
 
+NodeDB::MappedMmr::MappedMmr(NodeDB& db, ParamID::Enum eJournal, StreamType::Enum eLegacy, bool bStoreH0)
+	:m_StoreH0(bStoreH0)
+	,m_eJournal(eJournal)
+	,m_eLegacy(eLegacy)
+	,m_nData0(0)
+	,m_iTail0(0)
+	,m_bDirty(false)
+	,m_DB(db)
+{
+}
+
+NodeDB::MappedMmr::Hdr& NodeDB::MappedMmr::get_Hdr()
+{
+	return *static_cast<Hdr*>(m_Mapping.get_FixedHdr());
+}
+
+Merkle::Hash* NodeDB::MappedMmr::get_Data() const
+{
+	return (Merkle::Hash*) (m_Mapping.get_Base() + m_nData0);
+}
+
+Merkle::Hash* NodeDB::MappedMmr::Reserve(uint64_t nHashes)
+{
+	MappedFile::Offset nSize = m_nData0 + nHashes * sizeof(Merkle::Hash);
+	if (m_Mapping.get_Size() < nSize)
+	{
+		// grow with some reserve, to avoid remapping on every commit
+		const MappedFile::Offset nChunk = 1024 * 1024;
+		m_Mapping.EnsureSize((nSize + nChunk - 1) / nChunk * nChunk);
+	}
+
+	return get_Data();
+}
+
+void NodeDB::MappedMmr::Open(const char* sz)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x3B, 0x7E, 0x90, 0x12,
+		0xC4, 0x58, 0x6A, 0xE1,
+		0x0D, 0xF2, 0x97, 0x4C,
+		0x21, 0xB6, 0x85, 0x5F
+	};
+
+	MappedFile::Defs d;
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 0;
+	d.m_nFixedHdr = sizeof(Hdr);
+
+	m_nData0 = d.get_SizeMin();
+
+	ByteBuffer buf;
+	bool bJournal = m_DB.ParamGet(m_eJournal, nullptr, nullptr, &buf);
+	if (bJournal && (buf.size() < sizeof(JournalHdr)))
+		ThrowInconsistent();
+
+	m_Mapping.Open(sz, d, !bJournal); // w/o journal the file is irrelevant
+
+	m_iTail0 = get_TotalHashes();
+	m_vTail.clear();
+	m_bDirty = false;
+
+	if (bJournal)
+	{
+		const JournalHdr& jh = reinterpret_cast<const JournalHdr&>(buf.front());
+
+		Hdr& h = get_Hdr();
+		if (h.m_Stamp != jh.m_Stamp)
+		{
+			// the last journal wasn't applied
+			if (h.m_Stamp != jh.m_StampPrev)
+				ThrowError("mmr image mismatch");
+
+			uint64_t nTail = (buf.size() - sizeof(JournalHdr)) / sizeof(Merkle::Hash);
+			if (jh.m_iTail0 + nTail != jh.m_Hashes)
+				ThrowInconsistent();
+
+			ApplyTail(reinterpret_cast<const Merkle::Hash*>(&buf.front() + sizeof(JournalHdr)), jh.m_iTail0, jh.m_Hashes, jh.m_Stamp);
+		}
+	}
+	else
+	{
+		if (m_Count)
+		{
+			LOG_INFO() << "Migrating MMR to " << sz;
+			Migrate();
+		}
+	}
+
+	if (get_Hdr().m_Hashes != get_TotalHashes())
+		ThrowInconsistent();
+}
+
+void NodeDB::MappedMmr::Migrate()
+{
+	// move the data from the DB stream into the file
+	uint64_t nHashes = get_TotalHashes();
+	uint64_t nSize = nHashes * sizeof(Merkle::Hash);
+
+	m_DB.StreamIO(m_eLegacy, 0, Reserve(nHashes)->m_pData, nSize, false);
+	m_DB.StreamResize(m_eLegacy, 0, nSize);
+
+	Hdr& h = get_Hdr();
+	h.m_Hashes = nHashes;
+	ECC::GenRandom(h.m_Stamp);
+
+	// empty journal, just binds the file to the DB. If the DB is not committed - the migration will be repeated
+	JournalHdr jh;
+	jh.m_Stamp = h.m_Stamp;
+	jh.m_StampPrev = h.m_Stamp; // can't be re-applied to an empty file
+	jh.m_iTail0 = nHashes;
+	jh.m_Hashes = nHashes;
+
+	Blob blob(&jh, sizeof(jh));
+	m_DB.ParamSet(m_eJournal, nullptr, &blob);
+}
+
+void NodeDB::MappedMmr::Close()
+{
+	m_Mapping.Close();
+	m_vTail.clear();
+	m_bDirty = false;
+}
+
+void NodeDB::MappedMmr::ApplyTail(const Merkle::Hash* p, uint64_t iTail0, uint64_t nHashes, const Merkle::Hash& stamp)
+{
+	assert(iTail0 <= nHashes);
+	Merkle::Hash* pData = Reserve(nHashes);
+
+	if (nHashes > iTail0)
+		memcpy(pData + iTail0, p, (nHashes - iTail0) * sizeof(Merkle::Hash));
+
+	Hdr& h = get_Hdr();
+	h.m_Hashes = nHashes;
+	h.m_Stamp = stamp;
+}
+
+void NodeDB::MappedMmr::SaveJournal()
+{
+	if (!m_bDirty)
+		return;
+
+	const Hdr& h = get_Hdr();
+	if (h.m_Stamp == Zero)
+		ECC::GenRandom(m_StampPending);
+	else
+		ECC::Hash::Processor() << h.m_Stamp >> m_StampPending;
+
+	uint64_t nHashes = get_TotalHashes();
+	assert(m_iTail0 + m_vTail.size() == nHashes);
+
+	ByteBuffer buf(sizeof(JournalHdr) + m_vTail.size() * sizeof(Merkle::Hash));
+
+	JournalHdr& jh = reinterpret_cast<JournalHdr&>(buf.front());
+	jh.m_Stamp = m_StampPending;
+	jh.m_StampPrev = h.m_Stamp;
+	jh.m_iTail0 = m_iTail0;
+	jh.m_Hashes = nHashes;
+
+	if (!m_vTail.empty())
+		memcpy(&buf.front() + sizeof(JournalHdr), &m_vTail.front(), m_vTail.size() * sizeof(Merkle::Hash));
+
+	Blob blob(buf);
+	m_DB.ParamSet(m_eJournal, nullptr, &blob);
+}
+
+void NodeDB::MappedMmr::FlushJournal()
+{
+	if (!m_bDirty)
+		return;
+
+	uint64_t nHashes = get_TotalHashes();
+	ApplyTail(m_vTail.empty() ? nullptr : &m_vTail.front(), m_iTail0, nHashes, m_StampPending);
+
+	m_iTail0 = nHashes;
+	m_vTail.clear();
+	m_bDirty = false;
+}
+
+void NodeDB::MappedMmr::Append(const Merkle::Hash& hv)
+{
+	uint64_t n = m_Count;
+	ResizeTo(n + 1);
+	Mmr::Replace(n, hv);
+}
+
+void NodeDB::MappedMmr::ShrinkTo(uint64_t nCount)
+{
+	assert(m_Count >= nCount);
+	ResizeTo(nCount);
+}
+
+void NodeDB::MappedMmr::ResizeTo(uint64_t nCount)
+{
+	m_Count = nCount;
+
+	uint64_t nHashes = get_TotalHashes();
+	if (m_iTail0 > nHashes)
+		m_iTail0 = nHashes; // the committed data above is discarded, but must not be overwritten in-place
+
+	m_vTail.resize(nHashes - m_iTail0);
+	m_bDirty = true;
+}
+
+void NodeDB::MappedMmr::LoadElement(Merkle::Hash& hv, const Merkle::Position& pos) const
+{
+	uint64_t idx = Pos2Idx(pos, m_StoreH0);
+	assert(idx < get_TotalHashes());
+
+	hv = (idx >= m_iTail0) ? m_vTail[idx - m_iTail0] : get_Data()[idx];
+}
+
+void NodeDB::MappedMmr::SaveElement(const Merkle::Hash& hv, const Merkle::Position& pos)
+{
+	uint64_t idx = Pos2Idx(pos, m_StoreH0);
+	assert(idx < get_TotalHashes());
+
+	if (idx < m_iTail0)
+	{
+		// modifying the committed data, extend the tail down
+		const Merkle::Hash* pData = get_Data();
+		m_vTail.insert(m_vTail.begin(), pData + idx, pData + m_iTail0);
+		m_iTail0 = idx;
+	}
+
+	m_vTail[idx - m_iTail0] = hv;
+	m_bDirty = true;
+}
+
+bool NodeDB::KernelIndex::Open(const char* sz, const Stamp& st)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0xC6, 0x2D, 0x71, 0x0E,
+		0x93, 0x4B, 0xF8, 0x25,
+		0x6A, 0xD4, 0x1F, 0xB7,
+		0x38, 0x8E, 0x05, 0xE9
+	};
+
+	MappedFile::Defs d;
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 0;
+	d.m_nFixedHdr = sizeof(Hdr);
+
+	m_nData0 = d.get_SizeMin();
+
+	m_Mapping.Open(sz, d);
+
+	const Hdr& h = get_Hdr();
+	if (!h.m_Dirty && (h.m_Stamp == st) && !(st == Zero) && (m_Mapping.get_Size() >= m_nData0 + h.m_Slots * sizeof(Slot)))
+		return true;
+
+	m_Mapping.Open(sz, d, true);
+
+	ECC::GenRandom(&get_Hdr().m_Salt, sizeof(uint64_t));
+	OnDirty(); // even if nothing is inserted - the stamp should be saved
+	return false;
+}
+
+void NodeDB::KernelIndex::FlushStrict(const Stamp& st)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Stamp = st;
+	h.m_Dirty = 0;
+}
+
+uint64_t NodeDB::KernelIndex::get_Home(const Merkle::Hash& id) const
+{
+	const Hdr& h = get_Hdr();
+	assert(h.m_Slots);
+
+	uint64_t x;
+	memcpy(&x, id.m_pData, sizeof(x));
+
+	x = (x ^ h.m_Salt) * 0x9E3779B97F4A7C15ULL;
+	x ^= x >> 29;
+
+	return x & (h.m_Slots - 1);
+}
+
+void NodeDB::KernelIndex::InsertRaw(const Slot& x)
+{
+	uint64_t nMask = get_Hdr().m_Slots - 1;
+	Slot* pS = get_Slots();
+
+	uint64_t i = get_Home(x.m_ID);
+	while (pS[i].m_Height)
+		i = (i + 1) & nMask;
+
+	pS[i] = x;
+}
+
+void NodeDB::KernelIndex::Grow()
+{
+	const uint64_t nSlots0 = 0x10000;
+
+	Hdr& h0 = get_Hdr();
+	uint64_t nSlots = h0.m_Slots ? (h0.m_Slots << 1) : nSlots0;
+
+	// the table is rebuilt in place
+	std::vector<Slot> v;
+	v.reserve(h0.m_Count);
+
+	const Slot* pS = get_Slots();
+	for (uint64_t i = 0; i < h0.m_Slots; i++)
+		if (pS[i].m_Height)
+			v.push_back(pS[i]);
+
+	assert(v.size() == h0.m_Count);
+
+	m_Mapping.EnsureSize(m_nData0 + nSlots * sizeof(Slot)); // remaps
+	memset(static_cast<void*>(get_Slots()), 0, nSlots * sizeof(Slot)); // Merkle::Hash is not trivial, but all-zero is a valid free slot
+	get_Hdr().m_Slots = nSlots;
+
+	for (size_t i = 0; i < v.size(); i++)
+		InsertRaw(v[i]);
+}
+
+void NodeDB::KernelIndex::Insert(const Merkle::Hash& id, Height h)
+{
+	assert(h >= Rules::HeightGenesis);
+	OnDirty();
+
+	// keep the load factor below 3/4
+	const Hdr& hdr = get_Hdr();
+	if ((hdr.m_Count + 1) * 4 > hdr.m_Slots * 3)
+		Grow();
+
+	Slot x;
+	x.m_ID = id;
+	x.m_Height = h;
+	InsertRaw(x);
+
+	get_Hdr().m_Count++;
+}
+
+void NodeDB::KernelIndex::Delete(const Merkle::Hash& id, Height h)
+{
+	Hdr& hdr = get_Hdr();
+	if (!hdr.m_Slots)
+		ThrowError("no krn");
+
+	uint64_t nMask = hdr.m_Slots - 1;
+	Slot* pS = get_Slots();
+
+	uint64_t i = get_Home(id);
+	for ( ; ; i = (i + 1) & nMask)
+	{
+		if (!pS[i].m_Height)
+			ThrowError("no krn");
+
+		if ((pS[i].m_Height == h) && (pS[i].m_ID == id))
+			break;
+	}
+
+	OnDirty();
+
+	// shift back the rest of the cluster, so that no tombstones are needed
+	for (uint64_t j = i; ; )
+	{
+		j = (j + 1) & nMask;
+		if (!pS[j].m_Height)
+			break;
+
+		// the element may move to the hole only if its home is not within (i, j] (cyclically)
+		uint64_t k = get_Home(pS[j].m_ID);
+		bool bStay = (i <= j) ?
+			((i < k) && (k <= j)) :
+			((i < k) || (k <= j));
+
+		if (!bStay)
+		{
+			pS[i] = pS[j];
+			i = j;
+		}
+	}
+
+	pS[i].m_Height = 0;
+	hdr.m_Count--;
+}
+
+Height NodeDB::KernelIndex::Find(const Merkle::Hash& id) const
+{
+	const Hdr& hdr = get_Hdr();
+	if (!hdr.m_Slots)
+		return 0;
+
+	uint64_t nMask = hdr.m_Slots - 1;
+	const Slot* pS = get_Slots();
+
+	Height hRes = 0;
+	for (uint64_t i = get_Home(id); pS[i].m_Height; i = (i + 1) & nMask)
+		if ((pS[i].m_Height > hRes) && (pS[i].m_ID == id))
+			hRes = pS[i].m_Height;
+
+	return hRes;
+}
+
 const uint32_t NodeDB::s_StreamBlob = 1024*1024; // arbitrary, but should not be changed after DB is created
 
 uint64_t NodeDB::StreamType::Key(uint64_t idx, Enum eType)
@@ -16,6 +16,7 @@
 
 #include "core/common.h"
 #include "core/block_crypt.h"
+#include "core/mapped_file.h"
 #include "sqlite/sqlite3.h"
 
 namespace beam {
@@ -59,6 +60,10 @@ public:
 			ShieldedInputs,
 			AssetsCount, // Including unused. The last element is guaranteed to be used.
 			AssetsCountUsed, // num of 'live' assets
+			ShieldedMmrJournal,
+			AssetsMmrJournal,
+			ShieldedImageStamp,
+			KernelIndexStamp,
 		};
 	};
 
@@ -127,14 +132,9 @@ public:
 			PeerEnum,
 			BbsEnumCSeq,
 			BbsHistogram,
-			BbsEnumAllSeq,
 			BbsEnumAll,
-			BbsFindRaw,
-			BbsFind,
-			BbsFindCursor,
 			BbsDel,
 			BbsIns,
-			BbsMaxTime,
 			BbsTotals,
 			DummyIns,
 			DummyFindLowest,
@@ -144,6 +144,7 @@ public:
 			KernelIns,
 			KernelFind,
 			KernelDel,
+			KernelEnum,
 			TxoAdd,
 			TxoDel,
 			TxoDelFrom,
@@ -168,6 +169,13 @@ public:
 			AssetGet,
 			AssetSetVal,
 
+			BodyCacheIns,
+			BodyCacheFind,
+			BodyCacheCut,
+			BodyCacheDelEmpty,
+			BodyCacheDelOutdated,
+			BodyCacheDelRow,
+
 			Dbg0,
 			Dbg1,
 			Dbg2,
@@ -369,6 +377,22 @@ public:
 	void InsertEvent(Height, const Blob&, const Blob& key);
 	void DeleteEventsFrom(Height);
 
+	// Horizon-cut block bodies, served to fast-syncing peers.
+	// Each body is stored with the horizon ranges (inclusive) within which it's the same
+	struct CachedBody
+	{
+		uint64_t m_Row;
+		Height m_Height;
+		Height m_h0;
+		HeightRange m_Lo;
+		HeightRange m_Hi;
+	};
+
+	void BodyCacheIns(const CachedBody&, const Blob&);
+	bool BodyCacheFind(uint64_t rowid, Height h0, Height hLo1, Height hHi1, ByteBuffer&);
+	void BodyCacheCut(Height hMax); // after rollback, horizons above are no more relevant
+	void BodyCacheDelOutdated(Height hTxoLo, Height hTxoHi);
+
 	struct WalkerEvent {
 		Recordset m_Rs;
 		Height m_Height;
@@ -419,12 +443,7 @@ public:
 
 	void EnumBbsCSeq(WalkerBbs&); // set channel and ID before invocation
 	uint64_t BbsIns(const WalkerBbs::Data&); // must be unique (if not sure - first try to find it). Returns the ID
-	bool BbsFind(WalkerBbs&); // set Key
-	uint64_t BbsFind(const WalkerBbs::Key&);
 	void BbsDel(uint64_t id);
-	uint64_t BbsFindCursor(Timestamp);
-	Timestamp get_BbsMaxTime();
-	uint64_t get_BbsLastID();
 
 	struct BbsTotals {
 		uint32_t m_Count;
@@ -433,20 +452,6 @@ public:
 
 	void get_BbsTotals(BbsTotals&);
 
-	struct WalkerBbsLite
-	{
-		typedef WalkerBbs::Key Key;
-
-		Recordset m_Rs;
-		uint64_t m_ID;
-		Key m_Key;
-		uint32_t m_Size;
-
-		bool MoveNext();
-	};
-
-	void EnumAllBbsSeq(WalkerBbsLite&); // ordered by m_ID. Must be initialized to specify the lower bound
-
 	struct WalkerBbsTimeLen
 	{
 		Recordset m_Rs;
@@ -474,6 +479,16 @@ public:
 	void InsertKernel(const Blob&, Height h);
 	void DeleteKernel(const Blob&, Height h);
 	Height FindKernel(const Blob&); // in case of duplicates - returning the one with the largest Height
+
+	struct WalkerKernel {
+		Recordset m_Rs;
+		Blob m_ID;
+		Height m_Height;
+
+		bool MoveNext();
+	};
+
+	void EnumKernels(WalkerKernel&); // unordered
     Height FindBlock(const Blob&);
 
 	uint64_t FindStateWorkGreater(const Difficulty::Raw&);
@@ -552,6 +567,123 @@ public:
 		void CacheAdd(const Merkle::Hash& hv, const Merkle::Position& pos);
 	};
 
+	// Flat MMR in a memory-mapped file, so that element loads are just pointer dereferences.
+	// Modifications are kept in memory until the DB commit. Then they're saved in the DB as a journal (atomically with the rest of the data),
+	// and applied to the file. On open the journal is re-applied if necessary, so that the file is consistent with the DB after a crash at any point.
+	class MappedMmr
+		:public Merkle::FlatMmr
+	{
+		const bool m_StoreH0;
+		const ParamID::Enum m_eJournal;
+		const StreamType::Enum m_eLegacy; // older format, migrated on open
+
+		MappedFile m_Mapping;
+		MappedFile::Offset m_nData0;
+
+		// pending modifications: all the hashes starting from m_iTail0
+		uint64_t m_iTail0;
+		std::vector<Merkle::Hash> m_vTail;
+		bool m_bDirty;
+		Merkle::Hash m_StampPending;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			Merkle::Hash m_Stamp; // of the last applied journal
+			uint64_t m_Hashes;
+		};
+
+		struct JournalHdr
+		{
+			Merkle::Hash m_Stamp;
+			Merkle::Hash m_StampPrev;
+			uint64_t m_iTail0;
+			uint64_t m_Hashes;
+			// followed by the tail hashes
+		};
+#pragma pack(pop)
+
+		Hdr& get_Hdr();
+		Merkle::Hash* get_Data() const;
+		Merkle::Hash* Reserve(uint64_t nHashes);
+		uint64_t get_TotalHashes() const { return FlatMmr::get_TotalHashes(m_Count, m_StoreH0); }
+		void ApplyTail(const Merkle::Hash*, uint64_t iTail0, uint64_t nHashes, const Merkle::Hash& stamp);
+		void Migrate();
+
+	public:
+		NodeDB& m_DB;
+
+		MappedMmr(NodeDB&, ParamID::Enum eJournal, StreamType::Enum eLegacy, bool bStoreH0);
+
+		void Open(const char* sz); // m_Count must already be set
+		void Close();
+
+		void Append(const Merkle::Hash&);
+		void ShrinkTo(uint64_t nCount);
+		void ResizeTo(uint64_t nCount);
+
+		bool IsDirty() const { return m_bDirty; }
+		void SaveJournal(); // before the DB commit
+		void FlushJournal(); // after the DB commit
+
+	protected:
+		// Mmr
+		virtual void LoadElement(Merkle::Hash& hv, const Merkle::Position& pos) const override;
+		virtual void SaveElement(const Merkle::Hash& hv, const Merkle::Position& pos) override;
+	};
+
+	// Resident hash index of the kernel IDs (the Kernels table is authoritative), keeps the kernel lookups out of SQL.
+	// Open addressing with linear probing in a memory-mapped file. Maintained and flushed the same way as the UTXO image,
+	// if Open() returns false - should be rebuilt from the table.
+	class KernelIndex
+	{
+		MappedFile m_Mapping;
+		MappedFile::Offset m_nData0 = 0;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			Merkle::Hash m_Stamp;
+			uint64_t m_Count;
+			uint64_t m_Slots; // power of 2, or 0
+			uint64_t m_Salt; // kernel IDs can be ground to collide on a few bits, the slot shouldn't be predictable
+			uint8_t m_Dirty;
+		};
+
+		struct Slot
+		{
+			Merkle::Hash m_ID;
+			Height m_Height; // 0 for a free slot
+		};
+#pragma pack(pop)
+
+		Hdr& get_Hdr() const { return *static_cast<Hdr*>(m_Mapping.get_FixedHdr()); }
+		Slot* get_Slots() const { return (Slot*) (m_Mapping.get_Base() + m_nData0); }
+		void OnDirty() { get_Hdr().m_Dirty = 1; }
+
+		uint64_t get_Home(const Merkle::Hash&) const;
+		void InsertRaw(const Slot&);
+		void Grow(); // may remap
+
+	public:
+		typedef Merkle::Hash Stamp;
+
+		~KernelIndex() { Close(); }
+
+		bool Open(const char* sz, const Stamp&); // returns false if was reset
+		bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+		void Close() { m_Mapping.Close(); }
+
+		bool IsDirty() const { return IsOpen() && get_Hdr().m_Dirty; }
+		void FlushStrict(const Stamp&);
+
+		uint64_t get_Count() const { return get_Hdr().m_Count; }
+
+		void Insert(const Merkle::Hash&, Height); // duplicates are allowed
+		void Delete(const Merkle::Hash&, Height); // must exist
+		Height Find(const Merkle::Hash&) const; // in case of duplicates - the largest Height. 0 if not found
+	};
+
 	class StatesMmr
 		:public StreamMmr
 	{
@@ -603,6 +735,7 @@ private:
 
 	void Create();
 	void CreateTables20();
+	void CreateTables22();
 	void ExecQuick(const char*);
 	std::string ExecTextOut(const char*);
 	bool ExecStep(sqlite3_stmt*);
@@ -546,6 +546,492 @@ void Node::Processor::FlushInsanePeers()
     }
 }
 
+struct Node::Processor::ProofUtxoTask
+	:public Executor::TaskAsync
+{
+	Processor* m_pThis;
+	ProofUtxoRequest::Ptr m_pReq;
+
+	virtual void Exec(Executor::Context&) override
+	{
+		m_pReq->m_bOk = m_pReq->Build(*m_pThis, *m_pReq->m_pSnapshot);
+
+		std::unique_lock<std::mutex> scope(m_pThis->m_MutexProofs);
+		m_pThis->m_vProofsDone.push_back(std::move(m_pReq));
+		m_pThis->m_pAsyncProofs->get_trigger()();
+	}
+};
+
+void Node::Processor::PushProofUtxo(const ProofUtxoRequest::Ptr& pReq)
+{
+	if (!m_pAsyncProofs)
+	{
+		io::AsyncEvent::Callback cb = [this]() { FlushProofs(); };
+		m_pAsyncProofs = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	std::unique_ptr<ProofUtxoTask> pTask(new ProofUtxoTask);
+	pTask->m_pThis = this;
+	pTask->m_pReq = pReq;
+	m_ExecutorMT.Push(std::move(pTask));
+}
+
+void Node::Processor::FlushProofs()
+{
+	std::vector<ProofUtxoRequest::Ptr> v;
+	{
+		std::unique_lock<std::mutex> scope(m_MutexProofs);
+		v.swap(m_vProofsDone);
+	}
+
+	for (size_t i = 0; i < v.size(); i++)
+		v[i]->m_bDone = true;
+
+	// peers may be deleted during the processing, their requests are detached then
+	for (size_t i = 0; i < v.size(); i++)
+		if (v[i]->m_pPeer)
+			v[i]->m_pPeer->FlushDeferred();
+}
+
+struct Node::Processor::TxVerifyTask
+	:public Executor::TaskAsync
+{
+	Processor* m_pThis;
+	std::vector<TxVerifyRequest::Ptr> m_vReqs;
+
+	// the thread batch context may hold the pending block verification, use a separate one
+	ECC::InnerProduct::BatchContextEx<4> m_Bc;
+
+	virtual void Exec(Executor::Context&) override
+	{
+		ECC::InnerProduct::BatchContext::Scope scope(m_Bc);
+
+		std::vector<TxVerifyRequest*> v;
+		v.reserve(m_vReqs.size());
+		for (size_t i = 0; i < m_vReqs.size(); i++)
+			v.push_back(m_vReqs[i].get());
+
+		Verify(v);
+
+		std::unique_lock<std::mutex> scopeTxs(m_pThis->m_MutexTxs);
+		for (size_t i = 0; i < m_vReqs.size(); i++)
+			m_pThis->m_vTxsDone.push_back(std::move(m_vReqs[i]));
+
+		m_pThis->m_pAsyncTxs->get_trigger()();
+	}
+
+	void Verify(std::vector<TxVerifyRequest*>& v)
+	{
+		// Signatures and range proofs of all the txs are accumulated into a single multi-exponentiation
+		bool bPolluted = false; // a tx failed in the middle, its equation is incomplete
+
+		for (size_t i = 0; i < v.size(); i++)
+		{
+			TxVerifyRequest& r = *v[i];
+			r.m_Ctx.Reset();
+			r.m_Ctx.m_Height.m_Min = r.m_hVerify;
+
+			r.m_bOk =
+				r.m_Ctx.ValidateAndSummarize(*r.m_pTx, r.m_pTx->get_Reader()) &&
+				r.m_Ctx.IsValidTransaction();
+
+			if (!r.m_bOk)
+				bPolluted = true;
+		}
+
+		if (m_Bc.Flush())
+			return; // all the remaining are ok
+
+		std::vector<TxVerifyRequest*> vOk;
+		for (size_t i = 0; i < v.size(); i++)
+			if (v[i]->m_bOk)
+				vOk.push_back(v[i]);
+
+		if (vOk.empty())
+			return;
+
+		if ((vOk.size() == 1) && !bPolluted)
+		{
+			vOk.front()->m_bOk = false; // the culprit
+			return;
+		}
+
+		if (vOk.size() == 1)
+		{
+			Verify(vOk); // alone
+			return;
+		}
+
+		// bisect
+		size_t nHalf = vOk.size() / 2;
+		std::vector<TxVerifyRequest*> v2(vOk.begin() + nHalf, vOk.end());
+		vOk.resize(nHalf);
+
+		Verify(vOk);
+		Verify(v2);
+	}
+};
+
+bool Node::Processor::CanVerifyTxAsync()
+{
+	// Back-pressure: the verification backlog is bounded wrt the pool capacity. Beyond it the txs are verified in-place,
+	// which stalls the reactor, and eventually the incoming data flow.
+	uint32_t nMaxPending = std::max(get_ParentObj().m_Cfg.m_MaxPoolTransactions / 64, 1U);
+	return m_TxsPending < nMaxPending;
+}
+
+void Node::Processor::PushTxVerify(const TxVerifyRequest::Ptr& pReq)
+{
+	if (m_vTxsQueued.empty())
+	{
+		if (!m_pTxsQueuedTimer)
+			m_pTxsQueuedTimer = io::Timer::create(io::Reactor::get_Current());
+
+		m_pTxsQueuedTimer->start(0, false, [this]() { FlushTxsQueued(); });
+	}
+
+	m_vTxsQueued.push_back(pReq);
+	m_TxsPending++;
+}
+
+void Node::Processor::FlushTxsQueued()
+{
+	if (m_vTxsQueued.empty())
+		return;
+
+	if (!m_pAsyncTxs)
+	{
+		io::AsyncEvent::Callback cb = [this]() { FlushTxs(); };
+		m_pAsyncTxs = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	// batches of limited size, but use all the threads
+	const uint32_t nBatchMax = 32;
+
+	uint32_t nTotal = static_cast<uint32_t>(m_vTxsQueued.size());
+	uint32_t nTasks = std::max((nTotal + nBatchMax - 1) / nBatchMax, std::min(nTotal, m_ExecutorMT.get_Threads()));
+
+	for (uint32_t iTask = 0; iTask < nTasks; iTask++)
+	{
+		uint32_t i0 = static_cast<uint32_t>(uint64_t(nTotal) * iTask / nTasks);
+		uint32_t i1 = static_cast<uint32_t>(uint64_t(nTotal) * (iTask + 1) / nTasks);
+
+		std::unique_ptr<TxVerifyTask> pTask(new TxVerifyTask);
+		pTask->m_pThis = this;
+		pTask->m_vReqs.assign(m_vTxsQueued.begin() + i0, m_vTxsQueued.begin() + i1);
+		m_ExecutorMT.Push(std::move(pTask));
+	}
+
+	m_vTxsQueued.clear();
+}
+
+void Node::Processor::FlushTxs()
+{
+	std::vector<TxVerifyRequest::Ptr> v;
+	{
+		std::unique_lock<std::mutex> scope(m_MutexTxs);
+		v.swap(m_vTxsDone);
+	}
+
+	assert(m_TxsPending >= v.size());
+	m_TxsPending -= static_cast<uint32_t>(v.size());
+
+	for (size_t i = 0; i < v.size(); i++)
+		v[i]->m_bDone = true;
+
+	for (size_t i = 0; i < v.size(); i++)
+		if (v[i]->m_pPeer)
+			v[i]->m_pPeer->FlushDeferred();
+}
+
+struct Node::Processor::BodyPackTask
+	:public Executor::TaskAsync
+{
+	Processor* m_pThis;
+	BodyPackRequest::Ptr m_pReq;
+
+	virtual void Exec(Executor::Context&) override
+	{
+		BodyPackRequest& r = *m_pReq;
+		for (size_t i = 0; i < r.m_vConvert.size(); i++)
+			if (r.m_vConvert[i])
+				ConvertRecovery1(r.m_Res.m_Bodies[r.m_iChunk0 + i].m_Perishable);
+
+		std::unique_lock<std::mutex> scope(m_pThis->m_MutexBodies);
+		m_pThis->m_vBodiesDone.push_back(std::move(m_pReq));
+		m_pThis->m_pAsyncBodies->get_trigger()();
+	}
+};
+
+void Node::Processor::PushBodyPack(const BodyPackRequest::Ptr& pReq)
+{
+	if (!m_pAsyncBodies)
+	{
+		io::AsyncEvent::Callback cb = [this]() { FlushBodyPacks(); };
+		m_pAsyncBodies = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	std::unique_ptr<BodyPackTask> pTask(new BodyPackTask);
+	pTask->m_pThis = this;
+	pTask->m_pReq = pReq;
+	m_ExecutorMT.Push(std::move(pTask));
+}
+
+void Node::Processor::FlushBodyPacks()
+{
+	std::vector<BodyPackRequest::Ptr> v;
+	{
+		std::unique_lock<std::mutex> scope(m_MutexBodies);
+		v.swap(m_vBodiesDone);
+	}
+
+	for (size_t i = 0; i < v.size(); i++)
+	{
+		BodyPackRequest& r = *v[i];
+		if (!r.m_pPeer)
+			continue; // peer is deleted, the request is abandoned
+
+		if (r.m_Generation == m_BodyCache.m_Generation)
+		{
+			NodeDB::StateID sid;
+			sid.m_Height = r.m_hNext - r.m_vConvert.size();
+
+			for (size_t j = 0; j < r.m_vConvert.size(); j++, sid.m_Height++)
+			{
+				if (!r.m_vConvert[j])
+					continue;
+
+				sid.m_Row = FindActiveAtStrict(sid.m_Height);
+				OnBodyConverted(sid, r.m_Msg, r.m_Res.m_Bodies[r.m_iChunk0 + j].m_Perishable);
+			}
+		}
+
+		if (ReadBodyPackChunk(r))
+			PushBodyPack(v[i]);
+		else
+		{
+			r.m_bDone = true;
+			r.m_pPeer->FlushDeferred();
+		}
+	}
+}
+
+bool Node::Processor::ReadBodyPackChunk(BodyPackRequest& r)
+{
+	// returns false if the pack is complete
+	const Config::BandwidthCtl& bwc = get_ParentObj().m_Cfg.m_BandwidthCtl;
+
+	r.m_iChunk0 = r.m_Res.m_Bodies.size();
+	r.m_vConvert.clear();
+	r.m_Generation = m_BodyCache.m_Generation;
+
+	if ((r.m_nSize >= bwc.m_MaxBodyPackSize) || !(NodeDB::StateFlags::Active & get_DB().GetStateFlags(r.m_RowTop)))
+		return false; // the requested branch isn't active anymore, send what's collected
+
+	bool bConvertAny = false;
+
+	for (uint32_t n = 0; (r.m_hNext <= r.m_hMax) && (n < bwc.m_BodyPackChunk); n++)
+	{
+		NodeDB::StateID sid;
+		sid.m_Height = r.m_hNext;
+		sid.m_Row = FindActiveAtStrict(sid.m_Height);
+
+		proto::BodyBuffers bb;
+		bool bConvert;
+		if (!GetBody(bb, sid, r.m_Msg, true, bConvert))
+		{
+			r.m_hMax = 0; // stop
+			break;
+		}
+
+		r.m_hNext++;
+		r.m_nSize += bb.m_Eternal.size() + bb.m_Perishable.size();
+		r.m_Res.m_Bodies.push_back(std::move(bb));
+
+		r.m_vConvert.push_back(bConvert);
+		if (bConvert)
+			bConvertAny = true;
+
+		if (r.m_nSize >= bwc.m_MaxBodyPackSize)
+			break;
+	}
+
+	return bConvertAny || ((r.m_hNext <= r.m_hMax) && (r.m_nSize < bwc.m_MaxBodyPackSize));
+}
+
+void Node::Processor::BodyCache::Entry::Key::Set(uint64_t row, const proto::GetBodyPack& msg)
+{
+	m_Row = row;
+	m_h0 = msg.m_Height0;
+	m_hLo1 = msg.m_HorizonLo1;
+	m_hHi1 = msg.m_HorizonHi1;
+	m_FlagP = msg.m_FlagP;
+}
+
+bool Node::Processor::BodyCache::Entry::Key::operator < (const Key& x) const
+{
+	if (m_Row != x.m_Row)
+		return m_Row < x.m_Row;
+	if (m_h0 != x.m_h0)
+		return m_h0 < x.m_h0;
+	if (m_hLo1 != x.m_hLo1)
+		return m_hLo1 < x.m_hLo1;
+	if (m_hHi1 != x.m_hHi1)
+		return m_hHi1 < x.m_hHi1;
+	return m_FlagP < x.m_FlagP;
+}
+
+const ByteBuffer* Node::Processor::BodyCache::Find(const Entry::Key& key)
+{
+	KeySet::iterator it = m_setKeys.find(key);
+	if (m_setKeys.end() == it)
+		return nullptr;
+
+	Entry& x = it->get_ParentObj();
+	m_lstMru.erase(MruList::s_iterator_to(x.m_Mru));
+	m_lstMru.push_front(x.m_Mru);
+
+	return &x.m_Perishable;
+}
+
+void Node::Processor::BodyCache::Insert(const Entry::Key& key, const ByteBuffer& buf, size_t nSizeMax)
+{
+	if ((buf.size() > nSizeMax) || (m_setKeys.end() != m_setKeys.find(key)))
+		return;
+
+	while (m_Size + buf.size() > nSizeMax)
+		Delete(m_lstMru.back().get_ParentObj());
+
+	Entry* pE = new Entry;
+	pE->m_Key.m_Row = key.m_Row;
+	pE->m_Key.m_h0 = key.m_h0;
+	pE->m_Key.m_hLo1 = key.m_hLo1;
+	pE->m_Key.m_hHi1 = key.m_hHi1;
+	pE->m_Key.m_FlagP = key.m_FlagP;
+	pE->m_Perishable = buf;
+
+	m_setKeys.insert(pE->m_Key);
+	m_lstMru.push_front(pE->m_Mru);
+	m_Size += buf.size();
+}
+
+void Node::Processor::BodyCache::Delete(Entry& x)
+{
+	assert(m_Size >= x.m_Perishable.size());
+	m_Size -= x.m_Perishable.size();
+
+	m_setKeys.erase(KeySet::s_iterator_to(x.m_Key));
+	m_lstMru.erase(MruList::s_iterator_to(x.m_Mru));
+	delete &x;
+}
+
+void Node::Processor::BodyCache::Clear()
+{
+	while (!m_lstMru.empty())
+		Delete(m_lstMru.front().get_ParentObj());
+
+	m_Generation++;
+}
+
+bool Node::Processor::IsBodyCacheable(const NodeDB::StateID& sid, const proto::GetBodyPack& msg)
+{
+	// Only bodies that need processing are cached: the horizon-cut ones (re-created from Txos), and the converted for recovery.
+	// The horizon-cut depends on the spend heights of the outputs, which are final only below the current tip (until rollback)
+	if (msg.m_HorizonHi1 > m_Cursor.m_ID.m_Height)
+		return false;
+
+	if (proto::BodyBuffers::Recovery1 == msg.m_FlagP)
+		return true;
+
+	bool bFullBlock = (sid.m_Height >= msg.m_HorizonHi1) && (sid.m_Height > msg.m_HorizonLo1);
+	return !bFullBlock;
+}
+
+bool Node::Processor::GetBody(proto::BodyBuffers& out, const NodeDB::StateID& sid, const proto::GetBodyPack& msg, bool bActive, bool& bConvert)
+{
+	bConvert = false;
+
+	ByteBuffer* pP = nullptr;
+	ByteBuffer* pE = nullptr;
+
+	switch (msg.m_FlagE)
+	{
+	case proto::BodyBuffers::Full:
+		pE = &out.m_Eternal;
+		// no break;
+	case proto::BodyBuffers::None:
+		break;
+	default:
+		proto::NodeConnection::ThrowUnexpected();
+	}
+
+	switch (msg.m_FlagP)
+	{
+	case proto::BodyBuffers::Recovery1:
+	case proto::BodyBuffers::Full:
+		pP = &out.m_Perishable;
+		// no break;
+	case proto::BodyBuffers::None:
+		break;
+	default:
+		proto::NodeConnection::ThrowUnexpected();
+	}
+
+	const ByteBuffer* pCached = nullptr;
+	if (pP && IsBodyCacheable(sid, msg))
+	{
+		BodyCache::Entry::Key key;
+		key.Set(sid.m_Row, msg);
+		pCached = m_BodyCache.Find(key);
+	}
+
+	// if cached - still fetch w/o the perishable part, to make sure the block is available for this peer
+	if (!GetBlock(sid, pE, pCached ? nullptr : pP, msg.m_Height0, msg.m_HorizonLo1, msg.m_HorizonHi1, bActive))
+		return false;
+
+	if (pCached)
+		*pP = *pCached;
+	else
+	{
+		if (proto::BodyBuffers::Recovery1 == msg.m_FlagP)
+			bConvert = true;
+		else
+			if (pP)
+				OnBodyConverted(sid, msg, *pP);
+	}
+
+	return true;
+}
+
+void Node::Processor::OnBodyConverted(const NodeDB::StateID& sid, const proto::GetBodyPack& msg, const ByteBuffer& buf)
+{
+	if (!IsBodyCacheable(sid, msg))
+		return;
+
+	BodyCache::Entry::Key key;
+	key.Set(sid.m_Row, msg);
+	m_BodyCache.Insert(key, buf, get_ParentObj().m_Cfg.m_BandwidthCtl.m_BodyCacheSize);
+}
+
+void Node::Processor::ConvertRecovery1(ByteBuffer& buf)
+{
+	Block::Body block;
+
+	Deserializer der;
+	der.reset(buf);
+	der & Cast::Down<Block::BodyBase>(block);
+	der & Cast::Down<TxVectors::Perishable>(block);
+
+	for (size_t i = 0; i < block.m_vOutputs.size(); i++)
+		block.m_vOutputs[i]->m_RecoveryOnly = true;
+
+	Serializer ser;
+	ser & Cast::Down<Block::BodyBase>(block);
+	ser & Cast::Down<TxVectors::Perishable>(block);
+
+	ser.swap_buf(buf);
+}
+
 void Node::Processor::DeleteOutdated()
 {
 	TxPool::Fluff& txp = get_ParentObj().m_TxPool;
@@ -556,63 +1042,404 @@ void Node::Processor::DeleteOutdated()
 			continue;
 		Transaction& tx = *x.m_pValue;
 
-		if (proto::TxStatus::Ok != ValidateTxContextEx(tx, x.m_Threshold.m_Height, true))
-			txp.Delete(x);
-	}
-}
+		if (proto::TxStatus::Ok != ValidateTxContextEx(tx, x.m_Threshold.m_Height, true))
+			txp.Delete(x);
+	}
+}
+
+
+void Node::Processor::OnNewState()
+{
+    m_Cwp.Reset();
+
+	if (!IsTreasuryHandled())
+        return;
+
+    LOG_INFO() << "My Tip: " << m_Cursor.m_ID << ", Work = " << Difficulty::ToFloat(m_Cursor.m_Full.m_ChainWork);
+
+	if (IsFastSync())
+		return;
+
+    DeleteOutdated(); // Better to delete all irrelevant txs explicitly, even if the node is supposed to mine
+    // because in practice mining could be OFF (for instance, if miner key isn't defined, and owner wallet is offline).
+
+    if (get_ParentObj().m_Miner.IsEnabled())
+    {
+        get_ParentObj().m_Miner.HardAbortSafe();
+        get_ParentObj().m_Miner.SetTimer(0, true); // async start mining
+    }
+
+    proto::NewTip msg;
+    msg.m_Description = m_Cursor.m_Full;
+    proto::NodeConnection::Broadcast<proto::NewTip> bc(msg);
+
+    for (PeerList::iterator it = get_ParentObj().m_lstPeers.begin(); get_ParentObj().m_lstPeers.end() != it; it++)
+    {
+        Peer& peer = *it;
+        if (!(Peer::Flags::Connected & peer.m_Flags))
+            continue;
+
+		if (msg.m_Description.m_Height >= Rules::HeightGenesis)
+		{
+			if (!NodeProcessor::IsRemoteTipNeeded(msg.m_Description, peer.m_Tip))
+				continue;
+		}
+		else
+		{
+			if (Peer::Flags::HasTreasury & peer.m_Flags)
+				continue;
+		}
+
+        peer.Send(bc);
+    }
+
+    get_ParentObj().RefreshCongestions();
+
+	IObserver* pObserver = get_ParentObj().m_Cfg.m_Observer;
+	if (pObserver)
+		pObserver->OnStateChanged();
+
+	get_ParentObj().MaybeGenerateRecovery();
+}
+
+struct Node::RecoveryGen
+{
+	typedef std::shared_ptr<RecoveryGen> Ptr;
+
+	Node& m_This;
+	RecoveryGen(Node& n) :m_This(n) {}
+	~RecoveryGen();
+
+	RecoveryInfo::Writer m_Writer;
+	std::string m_sPath; // the final path, the data is written to the tmp file first (async mode only)
+	bool m_bAsync = false;
+
+	std::string get_PathTmp() const { return m_sPath + ".tmp"; }
+
+	// snapshot
+	uint64_t m_RowTip;
+	Height m_hTip;
+
+	struct Utxo
+	{
+		UtxoTree::Key::Data m_Key;
+		TxoID m_ID;
+	};
+
+	std::vector<Utxo> m_vUtxos;
+	ByteBuffer m_bufAssets;
+
+	// progress
+	size_t m_iUtxo = 0;
+	bool m_bUtxosDone = false;
+	Height m_hShielded; // next height for the shielded kernels
+	bool m_bLast = false;
+	uint32_t m_Percents = 0;
+
+	// the current chunk, read by the reactor thread, then serialized and written by the executor
+	struct Chunk
+	{
+		size_t m_iUtxo0;
+		std::vector<ByteBuffer> m_vTxos; // raw values of the utxos, starting from m_iUtxo0
+		ByteBuffer m_Tail; // already serialized, appended after the utxos
+	} m_Chunk;
+
+	std::mutex m_Mutex;
+	bool m_bWritten = false;
+	bool m_bWriteOk = true;
+
+	// metrics
+	uint32_t m_T0_ms;
+	uint64_t m_nBytes = 0;
+
+	static const size_t s_UtxosPerChunk = 4096;
+	static const Height s_KrnHeightsPerChunk = 1440;
+
+	struct Task;
+
+	bool Init(const char*);
+	bool ReadChunk(); // returns false if the snapshot is no longer valid
+	void WriteChunk();
+	void Push();
+	void LogDone() const;
+};
+
+Node::RecoveryGen::~RecoveryGen()
+{
+	if (m_bAsync)
+	{
+		// interrupted
+		m_Writer.m_Stream.Close();
+		beam::DeleteFile(get_PathTmp().c_str());
+	}
+}
+
+bool Node::RecoveryGen::Init(const char* szPath)
+{
+	Processor& p = m_This.m_Processor;
+	if (!p.BuildCwp())
+		return false; // no info yet
+
+	m_T0_ms = GetTime_ms();
+	m_RowTip = p.m_Cursor.m_Sid.m_Row;
+	m_hTip = p.m_Cursor.m_ID.m_Height;
+	m_hShielded = Rules::get().pForks[2].m_Height;
+
+	try
+	{
+		m_Writer.Open(szPath, p.m_Cwp);
+
+		if (m_hTip >= m_hShielded)
+		{
+			Serializer ser;
+
+			Asset::Full ai;
+			ai.m_ID = 0;
+
+			while (p.get_DB().AssetGetNext(ai))
+				ser & ai;
+
+			ser & (Asset::s_MaxCount + 1); // terminator
+			ser.swap_buf(m_bufAssets);
+		}
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERROR() << ex.what();
+		return false;
+	}
+
+	// utxo set snapshot. Only the keys and IDs, the values are read later
+	struct MyTraveler
+		:public RadixTree::ITraveler
+	{
+		std::vector<Utxo>* m_pV;
+
+		virtual bool OnLeaf(const RadixTree::Leaf& x) override
+		{
+			const UtxoTree::MyLeaf& n = Cast::Up<UtxoTree::MyLeaf>(x);
+			UtxoTree::Key::Data d;
+			d = n.m_Key;
+
+			if (n.IsExt())
+			{
+				for (auto p = n.m_pIDs.get_Strict()->m_pTop.get_Strict(); p; p = p->m_pNext.get())
+					OnUtxo(d, p->m_ID);
+			}
+			else
+				OnUtxo(d, n.m_ID);
+
+			return true;
+		}
 
+		void OnUtxo(const UtxoTree::Key::Data& d, TxoID id)
+		{
+			Utxo& x = m_pV->emplace_back();
+			x.m_Key = d;
+			x.m_ID = id;
+		}
+	};
 
-void Node::Processor::OnNewState()
+	MyTraveler ctx;
+	ctx.m_pV = &m_vUtxos;
+	p.get_Utxos().Traverse(ctx);
+
+	return true;
+}
+
+bool Node::RecoveryGen::ReadChunk()
 {
-    m_Cwp.Reset();
+	Processor& p = m_This.m_Processor;
 
-	if (!IsTreasuryHandled())
-        return;
+	m_Chunk.m_iUtxo0 = m_iUtxo;
+	m_Chunk.m_vTxos.clear();
+	m_Chunk.m_Tail.clear();
 
-    LOG_INFO() << "My Tip: " << m_Cursor.m_ID << ", Work = " << Difficulty::ToFloat(m_Cursor.m_Full.m_ChainWork);
+	try
+	{
+		if (!(NodeDB::StateFlags::Active & p.get_DB().GetStateFlags(m_RowTip)))
+		{
+			LOG_INFO() << "Recovery snapshot reverted";
+			return false;
+		}
 
-	if (IsFastSync())
-		return;
+		Serializer ser;
 
-    DeleteOutdated(); // Better to delete all irrelevant txs explicitly, even if the node is supposed to mine
-    // because in practice mining could be OFF (for instance, if miner key isn't defined, and owner wallet is offline).
+		if (!m_bUtxosDone)
+		{
+			size_t n = std::min(m_vUtxos.size() - m_iUtxo, s_UtxosPerChunk);
+			m_Chunk.m_vTxos.resize(n);
 
-    if (get_ParentObj().m_Miner.IsEnabled())
-    {
-        get_ParentObj().m_Miner.HardAbortSafe();
-        get_ParentObj().m_Miner.SetTimer(0, true); // async start mining
-    }
+			NodeDB::WalkerTxo wlk;
+			for (size_t i = 0; i < n; i++)
+			{
+				p.get_DB().TxoGetValue(wlk, m_vUtxos[m_iUtxo + i].m_ID);
+				if (NodeProcessor::TxoIsNaked(wlk.m_Value))
+				{
+					LOG_INFO() << "Recovery snapshot is cut-through";
+					return false;
+				}
 
-    proto::NewTip msg;
-    msg.m_Description = m_Cursor.m_Full;
+				const uint8_t* pSrc = reinterpret_cast<const uint8_t*>(wlk.m_Value.p);
+				m_Chunk.m_vTxos[i].assign(pSrc, pSrc + wlk.m_Value.n);
+			}
 
-    for (PeerList::iterator it = get_ParentObj().m_lstPeers.begin(); get_ParentObj().m_lstPeers.end() != it; it++)
-    {
-        Peer& peer = *it;
-        if (!(Peer::Flags::Connected & peer.m_Flags))
-            continue;
+			m_iUtxo += n;
 
-		if (msg.m_Description.m_Height >= Rules::HeightGenesis)
-		{
-			if (!NodeProcessor::IsRemoteTipNeeded(msg.m_Description, peer.m_Tip))
-				continue;
+			if (m_vUtxos.size())
+			{
+				uint32_t nPercents = static_cast<uint32_t>(m_iUtxo * 100 / m_vUtxos.size());
+				if (nPercents / 10 != m_Percents / 10)
+					LOG_INFO() << "Recovery generation: " << nPercents << "% of utxos";
+				m_Percents = nPercents;
+			}
+
+			if (m_iUtxo < m_vUtxos.size())
+				return true;
+
+			m_bUtxosDone = true;
+
+			if (m_hTip < m_hShielded)
+			{
+				m_bLast = true;
+				return true;
+			}
+
+			ser & MaxHeight; // terminator
 		}
 		else
 		{
-			if (Peer::Flags::HasTreasury & peer.m_Flags)
-				continue;
+			// shielded in/outs
+			struct MyKrnWalker
+				:public NodeProcessor::KrnWalkerShielded
+			{
+				Serializer& m_Ser;
+				MyKrnWalker(Serializer& ser) :m_Ser(ser) {}
+
+				virtual bool OnKrnEx(const TxKernelShieldedInput& krn) override
+				{
+					m_Ser & m_Height;
+					m_Ser & false;
+					m_Ser & krn.m_SpendProof.m_SpendPk;
+					return true;
+				}
+
+				virtual bool OnKrnEx(const TxKernelShieldedOutput& krn) override
+				{
+					Cast::NotConst(krn).m_Txo.m_pAsset.reset(); // not needed for recovery atm
+
+					m_Ser & m_Height;
+					m_Ser & true;
+					m_Ser & krn.m_Txo;
+					m_Ser & krn.m_Msg;
+					return true;
+				}
+
+			} wlk(ser);
+
+			Height h1 = std::min(m_hTip, m_hShielded + s_KrnHeightsPerChunk - 1);
+			p.EnumKernels(wlk, HeightRange(m_hShielded, h1));
+			m_hShielded = h1 + 1;
+
+			if (m_hShielded > m_hTip)
+			{
+				ser & MaxHeight; // terminator
+				ser.WriteRaw(m_bufAssets.empty() ? nullptr : &m_bufAssets.front(), m_bufAssets.size());
+				m_bLast = true;
+			}
 		}
 
-        peer.Send(msg);
-    }
+		ser.swap_buf(m_Chunk.m_Tail);
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERROR() << ex.what();
+		return false;
+	}
 
-    get_ParentObj().RefreshCongestions();
+	return true;
+}
 
-	IObserver* pObserver = get_ParentObj().m_Cfg.m_Observer;
-	if (pObserver)
-		pObserver->OnStateChanged();
+void Node::RecoveryGen::WriteChunk()
+{
+	try
+	{
+		Serializer ser;
 
-	get_ParentObj().MaybeGenerateRecovery();
+		for (size_t i = 0; i < m_Chunk.m_vTxos.size(); i++)
+		{
+			const ByteBuffer& buf = m_Chunk.m_vTxos[i];
+			const UtxoTree::Key::Data& d = m_vUtxos[m_Chunk.m_iUtxo0 + i].m_Key;
+
+			Deserializer der;
+			der.reset(&buf.front(), buf.size());
+
+			Output outp;
+			der & outp;
+
+			assert(outp.m_Commitment == d.m_Commitment);
+			outp.m_RecoveryOnly = true;
+
+			// 2 ways to discover the UTXO create height: either directly by looking its TxoID in States table, or reverse-engineer it from Maturity
+			// Since currently maturity delta is independent of current height (not a function of height, not changed in current forks) - we prefer the 2nd method, which is faster.
+
+			Height hCreateHeight = d.m_Maturity - outp.get_MinMaturity(0);
+
+			ser & hCreateHeight;
+			ser & outp;
+		}
+
+		ByteBuffer bufUtxos;
+		ser.swap_buf(bufUtxos);
+
+		// single write per chunk
+		if (!bufUtxos.empty())
+			m_Writer.m_Stream.write(&bufUtxos.front(), bufUtxos.size());
+		if (!m_Chunk.m_Tail.empty())
+			m_Writer.m_Stream.write(&m_Chunk.m_Tail.front(), m_Chunk.m_Tail.size());
+
+		m_nBytes += bufUtxos.size() + m_Chunk.m_Tail.size();
+	}
+	catch (const std::exception& ex)
+	{
+		LOG_ERROR() << ex.what();
+		m_bWriteOk = false;
+	}
+}
+
+struct Node::RecoveryGen::Task
+	:public Executor::TaskAsync
+{
+	RecoveryGen* m_pGen; // the generator is kept alive by the node until the task is done
+
+	virtual void Exec(Executor::Context&) override
+	{
+		RecoveryGen& g = *m_pGen;
+		g.WriteChunk();
+
+		std::unique_lock<std::mutex> scope(g.m_Mutex);
+		g.m_bWritten = true;
+		g.m_This.m_pAsyncRecovery->get_trigger()();
+	}
+};
+
+void Node::RecoveryGen::Push()
+{
+	if (!m_This.m_pAsyncRecovery)
+	{
+		Node* pThis = &m_This;
+		io::AsyncEvent::Callback cb = [pThis]() { pThis->FlushRecovery(); };
+		m_This.m_pAsyncRecovery = io::AsyncEvent::create(io::Reactor::get_Current(), std::move(cb));
+	}
+
+	std::unique_ptr<Task> pTask(new Task);
+	pTask->m_pGen = this;
+	m_This.m_Processor.m_ExecutorMT.Push(std::move(pTask));
+}
+
+void Node::RecoveryGen::LogDone() const
+{
+	LOG_INFO() << "Recovery generation done, Height=" << m_hTip << ", Utxos=" << m_vUtxos.size() << ", Size=" << m_nBytes << " bytes, Time=" << (GetTime_ms() - m_T0_ms) << " ms";
 }
 
 void Node::MaybeGenerateRecovery()
@@ -620,6 +1447,9 @@ void Node::MaybeGenerateRecovery()
 	if (!m_PostStartSynced || m_Cfg.m_Recovery.m_sPathOutput.empty() || !m_Cfg.m_Recovery.m_Granularity)
 		return;
 
+	if (m_pRecoveryGen)
+		return; // still in progress, the next one will be generated when it's done
+
 	Height h0 = m_Processor.get_DB().ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight);
 	const Height& h1 = m_Processor.m_Cursor.m_ID.m_Height; // alias
 	if (h1 < h0 + m_Cfg.m_Recovery.m_Granularity)
@@ -632,39 +1462,92 @@ void Node::MaybeGenerateRecovery()
 		<< m_Cfg.m_Recovery.m_sPathOutput
 		<< m_Processor.m_Cursor.m_ID;
 
-	std::string sPath = os.str();
+	m_pRecoveryGen = std::make_shared<RecoveryGen>(*this);
+	RecoveryGen& g = *m_pRecoveryGen;
+	g.m_sPath = os.str();
+	g.m_bAsync = true;
+
+	std::string sTmp = g.get_PathTmp();
+
+	if (g.Init(sTmp.c_str()) && g.ReadChunk())
+		g.Push();
+	else
+		OnRecoveryGenerated(false);
+}
+
+void Node::FlushRecovery()
+{
+	if (!m_pRecoveryGen)
+		return;
+	RecoveryGen& g = *m_pRecoveryGen;
+
+	{
+		std::unique_lock<std::mutex> scope(g.m_Mutex);
+		if (!g.m_bWritten)
+			return;
+		g.m_bWritten = false;
+	}
+
+	if (!g.m_bWriteOk)
+		OnRecoveryGenerated(false);
+	else
+	{
+		if (g.m_bLast)
+			OnRecoveryGenerated(true);
+		else
+		{
+			if (g.ReadChunk())
+				g.Push();
+			else
+				OnRecoveryGenerated(false);
+		}
+	}
+}
+
+void Node::OnRecoveryGenerated(bool bOk)
+{
+	RecoveryGen::Ptr pGen = std::move(m_pRecoveryGen);
+	assert(pGen);
+	RecoveryGen& g = *pGen;
+
+	std::string sTmp = g.get_PathTmp();
 
-	std::string sTmp = sPath;
-	sTmp += ".tmp";
+	g.m_Writer.m_Stream.Close();
 
-	bool bOk = GenerateRecoveryInfo(sTmp.c_str());
 	if (bOk)
 	{
 #ifdef WIN32
 		bOk =
-			MoveFileExW(Utf8toUtf16(sTmp.c_str()).c_str(), Utf8toUtf16(sPath.c_str()).c_str(), MOVEFILE_REPLACE_EXISTING) ||
+			MoveFileExW(Utf8toUtf16(sTmp.c_str()).c_str(), Utf8toUtf16(g.m_sPath.c_str()).c_str(), MOVEFILE_REPLACE_EXISTING) ||
 			(GetLastError() == ERROR_FILE_NOT_FOUND);
 #else // WIN32
 		bOk =
-			!rename(sTmp.c_str(), sPath.c_str()) ||
+			!rename(sTmp.c_str(), g.m_sPath.c_str()) ||
 			(ENOENT == errno);
 #endif // WIN32
 	}
 
 	if (bOk) {
-		LOG_INFO() << "Recovery generation done";
-		m_Processor.get_DB().ParamIntSet(NodeDB::ParamID::LastRecoveryHeight, h1);
+		g.LogDone();
+		m_Processor.get_DB().ParamIntSet(NodeDB::ParamID::LastRecoveryHeight, g.m_hTip);
 	} else
 	{
 		LOG_INFO() << "Recovery generation failed";
 		beam::DeleteFile(sTmp.c_str());
 	}
+
+	g.m_bAsync = false;
+
+	// the tip could have advanced meanwhile
+	MaybeGenerateRecovery();
 }
 
 void Node::Processor::OnRolledBack()
 {
     LOG_INFO() << "Rolled back to: " << m_Cursor.m_ID;
 
+	m_BodyCache.Clear(); // spend heights are reverted
+
 	// Delete shielded txs which referenced shielded outputs which were reverted
 	TxPool::Fluff& txp = get_ParentObj().m_TxPool;
 	for (TxPool::Fluff::Queue::iterator it = txp.m_Queue.begin(); txp.m_Queue.end() != it; )
@@ -759,6 +1642,9 @@ void Node::Processor::Stop()
     {
         m_pFlushTimer->cancel();
     }
+
+    if (m_pTxsQueuedTimer)
+        m_pTxsQueuedTimer->cancel();
 }
 
 Key::IPKdf* Node::Processor::get_ViewerKey()
@@ -832,11 +1718,13 @@ Node::Peer* Node::AllocPeer(const beam::io::Address& addr)
     pPeer->m_pInfo = NULL;
     pPeer->m_Flags = 0;
     pPeer->m_Port = 0;
+    pPeer->m_nChockings = 0;
     ZeroObject(pPeer->m_Tip);
     pPeer->m_RemoteAddr = addr;
     pPeer->m_LoginFlags = 0;
 	pPeer->m_CursorBbs = std::numeric_limits<int64_t>::max();
 	pPeer->m_pCursorTx = nullptr;
+	pPeer->m_pbDeleted = nullptr;
 
     LOG_INFO() << "+Peer " << addr;
 
@@ -898,9 +1786,13 @@ void Node::Initialize(IExternalPOW* externalPOW)
 
     m_PeerMan.Initialize();
     m_Miner.Initialize(externalPOW);
-	m_Processor.get_DB().get_BbsTotals(m_Bbs.m_Totals);
-    m_Bbs.Cleanup();
-	m_Bbs.m_HighestPosted_s = m_Processor.get_DB().get_BbsMaxTime();
+
+	if (m_Cfg.m_Bbs.IsEnabled())
+	{
+		m_Bbs.OpenStore();
+		m_Bbs.Cleanup();
+		m_Bbs.m_HighestPosted_s = m_Bbs.m_Store.get_MaxTime();
+	}
 }
 
 uint32_t Node::get_AcessiblePeerCount() const
@@ -1008,29 +1900,72 @@ void Node::RefreshOwnedUtxos()
 bool Node::Bbs::IsInLimits() const
 {
 	const NodeDB::BbsTotals& lims = get_ParentObj().m_Cfg.m_Bbs.m_Limit;
+	const NodeDB::BbsTotals& totals = m_Store.get_Totals();
 
 	return
-		(m_Totals.m_Count <= lims.m_Count) &&
-		(m_Totals.m_Size <= lims.m_Size);
+		(totals.m_Count <= lims.m_Count) &&
+		(totals.m_Size <= lims.m_Size);
 }
 
-void Node::Bbs::Cleanup()
+void Node::Bbs::OpenStore()
 {
+	const Config& cfg = get_ParentObj().m_Cfg;
+	m_Store.Open(cfg.m_Bbs.m_sPath.empty() ? (cfg.m_sPathLocal + ".bbs") : cfg.m_Bbs.m_sPath);
+
+	// move the msgs from the older versions, that kept them in the node db
 	NodeDB& db = get_ParentObj().m_Processor.get_DB();
-	NodeDB::WalkerBbsTimeLen wlk;
 
-	Timestamp ts = getTimestamp() - get_ParentObj().m_Cfg.m_Bbs.m_MessageTimeout_s;
+	NodeDB::BbsTotals totals;
+	db.get_BbsTotals(totals);
+	if (!totals.m_Count)
+		return;
 
-	for (db.EnumAllBbs(wlk); wlk.MoveNext(); )
+	LOG_INFO() << "Moving " << totals.m_Count << " bbs messages from the node db";
+
+	std::vector<BbsChannel> vChannels;
+
+	struct Histogram :public NodeDB::IBbsHistogram
 	{
-		if (IsInLimits() && (wlk.m_Time >= ts))
-			break;
+		std::vector<BbsChannel>* m_pV;
+		virtual bool OnChannel(BbsChannel ch, uint64_t) override
+		{
+			m_pV->push_back(ch);
+			return true;
+		}
+	} hist;
 
-		db.BbsDel(wlk.m_ID);
-		m_Totals.m_Count--;
-		m_Totals.m_Size -= wlk.m_Size;
+	hist.m_pV = &vChannels;
+	db.EnumBbs(hist);
+
+	for (BbsChannel ch : vChannels)
+	{
+		NodeDB::WalkerBbs wlk;
+		wlk.m_Data.m_Channel = ch;
+		wlk.m_ID = 0;
+
+		for (db.EnumBbsCSeq(wlk); wlk.MoveNext(); )
+			if (!m_Store.Find(wlk.m_Data.m_Key))
+				m_Store.Ins(wlk.m_Data);
 	}
 
+	std::vector<uint64_t> vIDs;
+	NodeDB::WalkerBbsTimeLen wlk;
+	for (db.EnumAllBbs(wlk); wlk.MoveNext(); )
+		vIDs.push_back(wlk.m_ID);
+
+	for (uint64_t id : vIDs)
+		db.BbsDel(id);
+}
+
+void Node::Bbs::Cleanup()
+{
+	// the whole segments are dropped, the expired msgs may live up to BbsStore::s_SegmentDuration_s longer
+	Timestamp ts = getTimestamp() - get_ParentObj().m_Cfg.m_Bbs.m_MessageTimeout_s;
+	m_Store.DeleteOlder(ts);
+
+	while (!IsInLimits() && m_Store.DeleteOldest())
+		;
+
 	m_LastCleanup_ms = GetTime_ms();
 }
 
@@ -1076,6 +2011,7 @@ Node::~Node()
     assert(m_setTasks.empty());
 
 	m_Processor.Stop();
+	m_pRecoveryGen.reset(); // no more pending writes
 
 	if (!std::uncaught_exceptions())
 		m_PeerMan.OnFlush();
@@ -1458,6 +2394,13 @@ void Node::Peer::DeleteSelf(bool bIsError, uint8_t nByeReason)
 
 	SetTxCursor(nullptr);
 
+	if (m_pbDeleted)
+		*m_pbDeleted = true;
+
+	io::TcpStream::State st = get_Traffic();
+	m_This.m_Metrics.m_TrafficGone.received += st.received;
+	m_This.m_Metrics.m_TrafficGone.sent += st.sent;
+
     m_This.m_lstPeers.erase(PeerList::s_iterator_to(*this));
     delete this;
 }
@@ -1758,6 +2701,33 @@ void Node::Peer::OnMsg(proto::HdrPack&& msg)
 	m_This.UpdateSyncStatus();
 }
 
+struct Node::Peer::DeferredBodyPack
+	:public Deferred
+{
+	BodyPackRequest::Ptr m_pReq;
+
+	virtual ~DeferredBodyPack()
+	{
+		m_pReq->m_pPeer = nullptr;
+	}
+
+	virtual bool IsReady() const override
+	{
+		return m_pReq->m_bDone;
+	}
+
+	virtual void Process(Peer& peer) override
+	{
+		if (m_pReq->m_Res.m_Bodies.empty())
+		{
+			proto::DataMissing msgMiss(Zero);
+			peer.Send(msgMiss);
+		}
+		else
+			peer.Send(m_pReq->m_Res);
+	}
+};
+
 void Node::Peer::OnMsg(proto::GetBody&& msg)
 {
 	proto::GetBodyPack msg2;
@@ -1785,30 +2755,27 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 				if (NodeDB::StateFlags::Active & p.get_DB().GetStateFlags(sid.m_Row))
 				{
 					// functionality only supported for active states
-					proto::BodyPack msgBody;
-					size_t nSize = 0;
-
-					sid.m_Height -= msg.m_CountExtra;
-					Height hMax = std::min(msg.m_Top.m_Height, sid.m_Height + m_This.m_Cfg.m_BandwidthCtl.m_MaxBodyPackCount);
-
-					for (; sid.m_Height <= hMax; sid.m_Height++)
+					BodyPackRequest::Ptr pReq = std::make_shared<BodyPackRequest>();
+					pReq->m_pPeer = this;
+					pReq->m_Msg = std::move(msg);
+					pReq->m_RowTop = sid.m_Row;
+					pReq->m_hNext = sid.m_Height - pReq->m_Msg.m_CountExtra;
+					pReq->m_hMax = std::min(sid.m_Height, pReq->m_hNext + m_This.m_Cfg.m_BandwidthCtl.m_MaxBodyPackCount);
+
+					// the 1st chunk is read immediately
+					if (p.ReadBodyPackChunk(*pReq))
 					{
-						sid.m_Row = p.FindActiveAtStrict(sid.m_Height);
+						p.PushBodyPack(pReq);
 
-						proto::BodyBuffers bb;
-						if (!GetBlock(bb, sid, msg, true))
-							break;
-
-						nSize += bb.m_Eternal.size() + bb.m_Perishable.size();
-						msgBody.m_Bodies.push_back(std::move(bb));
-
-						if (nSize >= m_This.m_Cfg.m_BandwidthCtl.m_MaxBodyPackSize)
-							break;
+						std::unique_ptr<DeferredBodyPack> pItem(new DeferredBodyPack);
+						pItem->m_pReq = std::move(pReq);
+						m_lstDeferred.push_back(std::move(pItem));
+						return;
 					}
 
-					if (msgBody.m_Bodies.size())
+					if (pReq->m_Res.m_Bodies.size())
 					{
-						Send(msgBody);
+						Send(pReq->m_Res);
 						return;
 					}
 				}
@@ -1816,8 +2783,15 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
 			else
 			{
 				proto::Body msgBody;
-				if (GetBlock(msgBody.m_Body, sid, msg, false))
+				bool bConvert;
+				if (p.GetBody(msgBody.m_Body, sid, msg, false, bConvert))
 				{
+					if (bConvert)
+					{
+						Processor::ConvertRecovery1(msgBody.m_Body.m_Perishable);
+						p.OnBodyConverted(sid, msg, msgBody.m_Body.m_Perishable);
+					}
+
 					Send(msgBody);
 					return;
 				}
@@ -1837,61 +2811,8 @@ void Node::Peer::OnMsg(proto::GetBodyPack&& msg)
         }
     }
 
-    proto::DataMissing msgMiss(Zero);
-    Send(msgMiss);
-}
-
-bool Node::Peer::GetBlock(proto::BodyBuffers& out, const NodeDB::StateID& sid, const proto::GetBodyPack& msg, bool bActive)
-{
-	ByteBuffer* pP = nullptr;
-	ByteBuffer* pE = nullptr;
-
-	switch (msg.m_FlagE)
-	{
-	case proto::BodyBuffers::Full:
-		pE = &out.m_Eternal;
-		// no break;
-	case proto::BodyBuffers::None:
-		break;
-	default:
-		ThrowUnexpected();
-	}
-
-	switch (msg.m_FlagP)
-	{
-	case proto::BodyBuffers::Recovery1:
-	case proto::BodyBuffers::Full:
-		pP = &out.m_Perishable;
-		// no break;
-	case proto::BodyBuffers::None:
-		break;
-	default:
-		ThrowUnexpected();
-	}
-
-	if (!m_This.m_Processor.GetBlock(sid, pE, pP, msg.m_Height0, msg.m_HorizonLo1, msg.m_HorizonHi1, bActive))
-		return false;
-
-	if (proto::BodyBuffers::Recovery1 == msg.m_FlagP)
-	{
-		Block::Body block;
-
-		Deserializer der;
-		der.reset(out.m_Perishable);
-		der & Cast::Down<Block::BodyBase>(block);
-		der & Cast::Down<TxVectors::Perishable>(block);
-
-		for (size_t i = 0; i < block.m_vOutputs.size(); i++)
-			block.m_vOutputs[i]->m_RecoveryOnly = true;
-
-		Serializer ser;
-		ser & Cast::Down<Block::BodyBase>(block);
-		ser & Cast::Down<TxVectors::Perishable>(block);
-
-		ser.swap_buf(out.m_Perishable);
-	}
-
-	return true;
+    proto::DataMissing msgMiss(Zero);
+    Send(msgMiss);
 }
 
 void Node::Peer::OnMsg(proto::Body&& msg)
@@ -1982,12 +2903,73 @@ void Node::Peer::OnFirstTaskDone(NodeProcessor::DataStatus::Enum eStatus)
     OnFirstTaskDone();
 }
 
+struct Node::Peer::DeferredTx
+	:public Deferred
+{
+	TxVerifyRequest::Ptr m_pReq;
+
+	virtual ~DeferredTx()
+	{
+		m_pReq->m_pPeer = nullptr;
+	}
+
+	virtual bool IsReady() const override
+	{
+		return m_pReq->m_bDone;
+	}
+
+	virtual void Process(Peer& peer) override
+	{
+		TxVerifyRequest& r = *m_pReq;
+
+		if (r.m_bFluff)
+			peer.m_This.OnTransactionFluff(std::move(r.m_pTx), &peer, nullptr, &r);
+		else
+		{
+			proto::Status msgOut;
+			msgOut.m_Value = peer.m_This.OnTransactionStem(std::move(r.m_pTx), &peer, &r);
+
+			peer.Send(msgOut);
+		}
+	}
+};
+
 void Node::Peer::OnMsg(proto::NewTransaction&& msg)
 {
     if (!msg.m_Transaction)
         ThrowUnexpected(); // our deserialization permits NULL Ptrs.
     // However the transaction body must have already been checked for NULLs
 
+	Processor& p = m_This.m_Processor;
+
+	bool bAsync = p.CanVerifyTxAsync();
+	if (bAsync && msg.m_Fluff)
+	{
+		// don't bother if it's already in the pool
+		TxPool::Fluff::Element::Tx key;
+		msg.m_Transaction->get_Key(key.m_Key);
+
+		bAsync = (m_This.m_TxPool.m_setTxs.end() == m_This.m_TxPool.m_setTxs.find(key));
+	}
+
+	if (bAsync)
+	{
+		TxVerifyRequest::Ptr pReq = std::make_shared<TxVerifyRequest>();
+		pReq->m_pPeer = this;
+		pReq->m_T0_us = GetTime_us();
+		pReq->m_pTx = std::move(msg.m_Transaction);
+		pReq->m_bFluff = msg.m_Fluff;
+		pReq->m_hVerify = p.m_Cursor.m_ID.m_Height + 1;
+		pReq->m_Ctx.m_Height.m_Min = pReq->m_hVerify;
+
+		p.PushTxVerify(pReq);
+
+		std::unique_ptr<DeferredTx> pItem(new DeferredTx);
+		pItem->m_pReq = std::move(pReq);
+		m_lstDeferred.push_back(std::move(pItem));
+		return;
+	}
+
     if (msg.m_Fluff)
         m_This.OnTransactionFluff(std::move(msg.m_Transaction), this, NULL);
     else
@@ -1999,12 +2981,50 @@ void Node::Peer::OnMsg(proto::NewTransaction&& msg)
     }
 }
 
-uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx)
+uint8_t Node::ValidateTx(Transaction::Context& ctx, const Transaction& tx, const TxVerifyRequest* pPre)
+{
+	uint64_t t0_us = pPre ? pPre->m_T0_us : GetTime_us();
+	uint8_t nCode = ValidateTxInternal(ctx, tx, pPre);
+	m_Metrics.OnTx(nCode, GetTime_us() - t0_us);
+	return nCode;
+}
+
+void Node::Metrics::OnTx(uint8_t nStatus, uint64_t dt_us)
+{
+	m_TxAdmission.Add(dt_us);
+
+	switch (nStatus)
+	{
+	case proto::TxStatus::Ok:
+		m_TxAccepted++;
+		break;
+	case proto::TxStatus::Invalid:
+		m_TxInvalid++;
+		break;
+	default:
+		m_TxRejected++;
+	}
+}
+
+uint8_t Node::ValidateTxInternal(Transaction::Context& ctx, const Transaction& tx, const TxVerifyRequest* pPre)
 {
 	ctx.m_Height.m_Min = m_Processor.m_Cursor.m_ID.m_Height + 1;
 
-	if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
-		return proto::TxStatus::Invalid;
+	if (pPre && (pPre->m_hVerify == ctx.m_Height.m_Min))
+	{
+		// context-free part is already done
+		if (!pPre->m_bOk)
+			return proto::TxStatus::Invalid;
+
+		ctx.m_Height = pPre->m_Ctx.m_Height;
+		ctx.m_Stats = pPre->m_Ctx.m_Stats;
+	}
+	else
+	{
+		// the tip has changed meanwhile, the result may depend on the height
+		if (!(m_Processor.ValidateAndSummarize(ctx, tx, tx.get_Reader()) && ctx.IsValidTransaction()))
+			return proto::TxStatus::Invalid;
+	}
 
     uint8_t nCode = m_Processor.ValidateTxContextEx(tx, ctx.m_Height, false);
 	if (proto::TxStatus::Ok != nCode)
@@ -2111,7 +3131,7 @@ uint32_t Node::RandomUInt32(uint32_t threshold)
     return threshold;
 }
 
-uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
+uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer, const TxVerifyRequest* pPre)
 {
 	TxStats s;
 	ptx->get_Reader().AddStats(s);
@@ -2168,7 +3188,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
 
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, pPre);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 
@@ -2183,7 +3203,7 @@ uint8_t Node::OnTransactionStem(Transaction::Ptr&& ptx, const Peer* pPeer)
     {
 		if (!bTested)
 		{
-			uint8_t nCode = ValidateTx(ctx, *ptx);
+			uint8_t nCode = ValidateTx(ctx, *ptx, pPre);
 			if (proto::TxStatus::Ok != nCode)
 				return nCode;
 		}
@@ -2467,7 +3487,7 @@ Height Node::SampleDummySpentHeight()
 	return h;
 }
 
-bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem)
+bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPool::Stem::Element* pElem, const TxVerifyRequest* pPre)
 {
     Transaction::Ptr ptx;
     ptx.swap(ptxArg);
@@ -2511,7 +3531,7 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
     m_Wtx.Delete(key.m_Key);
 
     // new transaction
-    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx);
+    uint8_t nCode = pElem ? proto::TxStatus::Ok : ValidateTx(ctx, tx, pPre);
     LogTx(tx, nCode, key.m_Key);
 
 	if (proto::TxStatus::Ok != nCode) {
@@ -2547,7 +3567,7 @@ bool Node::OnTransactionFluff(Transaction::Ptr&& ptxArg, const Peer* pPeer, TxPo
 		peer.SetTxCursor(pNewTxElem);
     }
 
-    if (m_Miner.IsEnabled() && !m_Miner.m_pTaskToFinalize)
+    if (m_Miner.IsEnabled() && !m_Miner.m_pTaskToFinalize && (m_TxPool.m_Template.m_Version != m_Miner.m_Template.m_PoolVersion))
         m_Miner.SetTimer(m_Cfg.m_Timeout.m_MiningSoftRestart_ms, false);
 
     return true;
@@ -2630,6 +3650,8 @@ void Node::Peer::OnChocking()
 	if (!(Flags::Chocking & m_Flags))
 	{
 		m_Flags |= Flags::Chocking;
+		m_nChockings++;
+		m_This.m_Metrics.m_Chockings++;
 		Send(proto::Ping(Zero));
 	}
 }
@@ -2695,15 +3717,15 @@ void Node::Peer::BroadcastBbs()
 
 	size_t nExtra = 0;
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbsLite wlk;
+	BbsStore::WalkerLite wlk;
 
 	wlk.m_ID = m_CursorBbs;
-	for (db.EnumAllBbsSeq(wlk); wlk.MoveNext(); )
+	for (m_This.m_Bbs.m_Store.EnumAll(wlk); wlk.MoveNext(); )
 	{
 		proto::BbsHaveMsg msgOut;
 		msgOut.m_Key = wlk.m_Key;
 		Send(msgOut);
+		m_This.m_Metrics.m_BbsRelayed++;
 
 		nExtra += wlk.m_Size;
 		if (IsChocking(nExtra))
@@ -2848,66 +3870,217 @@ void Node::Peer::OnMsg(proto::GetProofKernel2&& msg)
     Send(msgOut);
 }
 
-void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
+void Node::Peer::OnMsg(proto::GetProofKernels&& msg)
 {
-    struct Traveler :public UtxoTree::ITraveler
-    {
-        proto::ProofUtxo m_Msg;
-        NodeProcessor& m_Proc;
+	if (msg.m_IDs.size() > proto::g_ProofsBatchMax)
+		ThrowUnexpected();
 
-        virtual bool OnLeaf(const RadixTree::Leaf& x) override {
+	m_This.m_Metrics.m_ProofBatchesKernels++;
 
-            const UtxoTree::MyLeaf& v = Cast::Up<UtxoTree::MyLeaf>(x);
-            UtxoTree::Key::Data d;
-            d = v.m_Key;
+	proto::ProofKernels msgOut;
+	msgOut.m_Heights.resize(msg.m_IDs.size());
+	msgOut.m_Indices.resize(msg.m_IDs.size());
+	if (msg.m_Fetch)
+		msgOut.m_Kernels.resize(msg.m_IDs.size());
 
-            Input::Proof& ret = m_Msg.m_Proofs.emplace_back();
+	Processor& p = m_This.m_Processor;
+	if (!p.IsFastSync())
+		p.get_ProofKernels(msgOut, msg.m_IDs, msg.m_Fetch);
+	Send(msgOut);
+}
 
-            ret.m_State.m_Count = v.get_Count();
-            ret.m_State.m_Maturity = d.m_Maturity;
-            m_Proc.get_Utxos().get_Proof(ret.m_Proof, *m_pCu);
+struct Node::Peer::DeferredProofUtxo
+	:public Deferred
+{
+	ProofUtxoRequest::Ptr m_pReq;
 
-            struct MyProofBuilder
-                :public NodeProcessor::ProofBuilder
-            {
-                using ProofBuilder::ProofBuilder;
-                virtual bool get_Utxos(Merkle::Hash&) override { return false; }
-            };
+	virtual ~DeferredProofUtxo()
+	{
+		m_pReq->m_pPeer = nullptr;
+	}
 
-            MyProofBuilder pb(m_Proc, ret.m_Proof);
-            pb.GenerateProof();
+	virtual bool IsReady() const override
+	{
+		return m_pReq->m_bDone;
+	}
 
-            return m_Msg.m_Proofs.size() < Input::Proof::s_EntriesMax;
-        }
+	virtual void Process(Peer& peer) override
+	{
+		ProofUtxoRequest& r = *m_pReq;
+		Processor& p = peer.m_This.m_Processor;
 
-        Traveler(NodeProcessor& np) :m_Proc(np) {}
-    };
+		if (!r.m_bOk || (r.m_pSnapshot != p.PublishUtxos()))
+		{
+			// the tip has changed meanwhile. The proof must correspond to the current one, re-create it in-place
+			if (p.IsFastSync())
+			{
+				r.m_vRes.clear();
+				r.m_vRes.resize(r.m_vUtxos.size());
+			}
+			else
+				r.Build(p, *p.PublishUtxos());
+		}
+
+		r.Send(peer);
+	}
+};
+
+bool Node::ProofUtxoRequest::Build(NodeProcessor& p, const NodeProcessor::UtxoSnapshot& snap)
+{
+	m_vRes.clear();
+	m_vRes.resize(m_vUtxos.size());
+
+	for (size_t i = 0; i < m_vUtxos.size(); i++)
+		if (!p.get_ProofUtxo(m_vRes[i], m_vUtxos[i], m_MaturityMin, snap))
+			return false;
+
+	return true;
+}
+
+void Node::ProofUtxoRequest::Send(Peer& peer)
+{
+	if (m_bBatch)
+	{
+		proto::ProofUtxos msg;
+		msg.m_Proofs.swap(m_vRes);
+		peer.Send(msg);
+	}
+	else
+	{
+		proto::ProofUtxo msg;
+		assert(1 == m_vRes.size());
+		msg.m_Proofs.swap(m_vRes.front());
+		peer.Send(msg);
+	}
+}
 
+void Node::Peer::OnMsg(proto::GetProofUtxo&& msg)
+{
 	Processor& p = m_This.m_Processor;
-    Traveler t(p);
+	if (p.IsFastSync())
+	{
+		proto::ProofUtxo msgOut;
+		Send(msgOut);
+		return;
+	}
 
-	if (!p.IsFastSync())
+	ProofUtxoRequest::Ptr pReq = std::make_shared<ProofUtxoRequest>();
+	pReq->m_vUtxos.push_back(msg.m_Utxo);
+	pReq->m_MaturityMin = msg.m_MaturityMin;
+
+	PushProofUtxo(std::move(pReq));
+}
+
+void Node::Peer::OnMsg(proto::GetProofUtxos&& msg)
+{
+	if (msg.m_Utxos.size() > proto::g_ProofsBatchMax)
+		ThrowUnexpected();
+
+	m_This.m_Metrics.m_ProofBatchesUtxos++;
+
+	Processor& p = m_This.m_Processor;
+	if (p.IsFastSync())
 	{
-		UtxoTree::Cursor cu;
-		t.m_pCu = &cu;
+		proto::ProofUtxos msgOut;
+		msgOut.m_Proofs.resize(msg.m_Utxos.size());
+		Send(msgOut);
+		return;
+	}
+
+	ProofUtxoRequest::Ptr pReq = std::make_shared<ProofUtxoRequest>();
+	pReq->m_vUtxos.swap(msg.m_Utxos);
+	pReq->m_bBatch = true;
+
+	PushProofUtxo(std::move(pReq));
+}
+
+void Node::Peer::PushProofUtxo(ProofUtxoRequest::Ptr&& pReq)
+{
+	Processor& p = m_This.m_Processor;
 
-		// bounds
-		UtxoTree::Key kMin, kMax;
+	pReq->m_pPeer = this;
+	pReq->m_pSnapshot = p.PublishUtxos();
 
-		UtxoTree::Key::Data d;
-		d.m_Commitment = msg.m_Utxo;
-		d.m_Maturity = msg.m_MaturityMin;
-		kMin = d;
-		d.m_Maturity = Height(-1);
-		kMax = d;
+	p.PushProofUtxo(pReq);
 
-		t.m_pBound[0] = kMin.V.m_pData;
-		t.m_pBound[1] = kMax.V.m_pData;
+	std::unique_ptr<DeferredProofUtxo> pItem(new DeferredProofUtxo);
+	pItem->m_pReq = std::move(pReq);
+	m_lstDeferred.push_back(std::move(pItem));
+}
+
+template <typename TMsg>
+struct Node::Peer::DeferredMsg
+	:public Deferred
+{
+	TMsg m_Msg;
+	DeferredMsg(TMsg&& msg) :m_Msg(std::move(msg)) {}
 
-        p.get_Utxos().Traverse(t);
+	virtual void Process(Peer& peer) override
+	{
+		peer.NodeConnection::OnMsg2(std::move(m_Msg)); // skip our override
 	}
+};
+
+#define THE_MACRO(code, msg) \
+bool Node::Peer::OnMsg2(proto::msg&& v) \
+{ \
+	switch (code) \
+	{ \
+	case proto::SChannelInitiate::s_Code: \
+	case proto::SChannelReady::s_Code: \
+		break; /* the channel state can't wait */ \
+\
+	default: \
+		if (!m_lstDeferred.empty()) \
+		{ \
+			m_lstDeferred.push_back(std::make_unique<DeferredMsg<proto::msg> >(std::move(v))); \
+			return true; \
+		} \
+	} \
+\
+	return NodeConnection::OnMsg2(std::move(v)); \
+}
+
+BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+
+void Node::Peer::FlushDeferred()
+{
+	while (!m_lstDeferred.empty() && m_lstDeferred.front()->IsReady())
+	{
+		std::unique_ptr<Deferred> pItem = std::move(m_lstDeferred.front());
+		m_lstDeferred.pop_front();
+
+		// new deferred items that may appear during processing must precede the rest of the queue
+		std::deque<std::unique_ptr<Deferred> > lstTail;
+		lstTail.swap(m_lstDeferred);
+
+		bool bDeleted = false;
+		bool* pbDeleted = m_pbDeleted;
+		m_pbDeleted = &bDeleted;
+
+		try {
+			pItem->Process(*this);
+		} catch (const proto::NodeProcessingException& e) {
+			if (!bDeleted)
+				OnProcessingExc(e);
+		} catch (const std::exception& e) {
+			if (!bDeleted)
+				OnExc(e);
+		}
+
+		if (bDeleted)
+		{
+			if (pbDeleted)
+				*pbDeleted = true;
+			return;
+		}
 
-    Send(t.m_Msg);
+		m_pbDeleted = pbDeleted;
+
+		for (; !lstTail.empty(); lstTail.pop_front())
+			m_lstDeferred.push_back(std::move(lstTail.front()));
+	}
 }
 
 void Node::Processor::GenerateProofShielded(Merkle::Proof& p, const uintBigFor<TxoID>::Type& mmrIdx)
@@ -3030,7 +4203,7 @@ void Node::Peer::OnMsg(proto::GetShieldedList&& msg)
 			msg.m_Count = static_cast<uint32_t>(n);
 
 		msgOut.m_Items.resize(msg.m_Count);
-		p.get_DB().ShieldedRead(msg.m_Id0, &msgOut.m_Items.front(), msg.m_Count);
+		p.ShieldedRead(msg.m_Id0, &msgOut.m_Items.front(), msg.m_Count);
 	}
 
     msgOut.m_ShieldedOuts = p.m_Extra.m_ShieldedOutputs;
@@ -3126,6 +4299,8 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 	if (msg.m_Message.size() > proto::Bbs::s_MaxMsgSize)
 		ThrowUnexpected("Bbs msg too large"); // will also ban this peer
 
+	m_This.m_Metrics.m_BbsReceived++;
+
 	Timestamp t = getTimestamp();
 
     if (msg.m_TimePosted > t + Rules::get().DA.MaxAhead_s)
@@ -3137,7 +4312,7 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
     if (msg.m_TimePosted + Rules::get().DA.MaxAhead_s < m_This.m_Bbs.m_HighestPosted_s)
         return; // don't allow too much out-of-order messages
 
-    NodeDB& db = m_This.m_Processor.get_DB();
+    BbsStore& store = m_This.m_Bbs.m_Store;
     NodeDB::WalkerBbs wlk;
 
     wlk.m_Data.m_Channel = msg.m_Channel;
@@ -3147,22 +4322,24 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
 
     Bbs::CalcMsgKey(wlk.m_Data);
 
-    if (db.BbsFind(wlk.m_Data.m_Key))
+    if (store.Find(wlk.m_Data.m_Key))
         return; // already have it
 
     m_This.m_Bbs.MaybeCleanup();
 
-    uint64_t id = db.BbsIns(wlk.m_Data);
+    uint64_t id = store.Ins(wlk.m_Data);
     m_This.m_Bbs.m_W.Delete(wlk.m_Data.m_Key);
 
+    m_This.m_Metrics.m_BbsStored++;
+    m_This.m_Metrics.m_BbsStoredBytes += msg.m_Message.size();
+
 	std::setmax(m_This.m_Bbs.m_HighestPosted_s, msg.m_TimePosted);
-	m_This.m_Bbs.m_Totals.m_Count++;
-	m_This.m_Bbs.m_Totals.m_Size += wlk.m_Data.m_Message.n;
 
     // 1. Send to other BBS-es
 
     proto::BbsHaveMsg msgOut;
     msgOut.m_Key = wlk.m_Data.m_Key;
+    proto::NodeConnection::Broadcast<proto::BbsHaveMsg> bcHave(msgOut);
 
     for (PeerList::iterator it = m_This.m_lstPeers.begin(); m_This.m_lstPeers.end() != it; it++)
     {
@@ -3173,7 +4350,8 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (!(peer.m_LoginFlags & proto::LoginFlags::Bbs) || peer.IsChocking())
             continue;
 
-        peer.Send(msgOut);
+        peer.Send(bcHave);
+        m_This.m_Metrics.m_BbsRelayed++;
     }
 
     // 2. Send to subscribed
@@ -3182,6 +4360,8 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
     Bbs::Subscription::InBbs key;
     key.m_Channel = msg.m_Channel;
 
+    proto::NodeConnection::Broadcast<proto::BbsMsg> bcMsg(msg); // same content as in wlk.m_Data
+
     for (std::pair<It, It> range = m_This.m_Bbs.m_Subscribed.equal_range(key); range.first != range.second; range.first++)
     {
         Bbs::Subscription& s = range.first->get_ParentObj();
@@ -3190,8 +4370,9 @@ void Node::Peer::OnMsg(proto::BbsMsg&& msg)
         if (s.m_pPeer->IsChocking())
             continue;
 
-        s.m_pPeer->SendBbsMsg(wlk.m_Data);
+        s.m_pPeer->Send(bcMsg);
 		s.m_Cursor = id;
+		m_This.m_Metrics.m_BbsPushed++;
 
 		s.m_pPeer->IsChocking(); // in case it's chocking - for faster recovery recheck it ASAP
     }
@@ -3202,8 +4383,7 @@ void Node::Peer::OnMsg(proto::BbsHaveMsg&& msg)
     if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-    NodeDB& db = m_This.m_Processor.get_DB();
-	if (db.BbsFind(msg.m_Key)) {
+	if (m_This.m_Bbs.m_Store.Find(msg.m_Key)) {
 		// stupid compiler insists on parentheses here!
 		return; // already have it
 	}
@@ -3223,14 +4403,14 @@ void Node::Peer::OnMsg(proto::BbsGetMsg&& msg)
 	if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-    NodeDB::WalkerBbs wlk;
+	BbsStore& store = m_This.m_Bbs.m_Store;
 
-    wlk.m_Data.m_Key = msg.m_Key;
-    if (!db.BbsFind(wlk))
-        return; // don't have it
+	NodeDB::WalkerBbs::Data d;
+	ByteBuffer buf;
+	if (!store.Find(store.Find(msg.m_Key), d, buf))
+		return; // don't have it
 
-    SendBbsMsg(wlk.m_Data);
+	SendBbsMsg(d);
 }
 
 void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
@@ -3241,6 +4421,7 @@ void Node::Peer::SendBbsMsg(const NodeDB::WalkerBbs::Data& d)
 	d.m_Message.Export(msgOut.m_Message);
 	msgOut.m_Nonce = d.m_Nonce;
 	Send(msgOut);
+	m_This.m_Metrics.m_BbsPushed++;
 }
 
 void Node::Peer::OnMsg(proto::BbsSubscribe&& msg)
@@ -3265,7 +4446,7 @@ void Node::Peer::OnMsg(proto::BbsSubscribe&& msg)
         m_This.m_Bbs.m_Subscribed.insert(pS->m_Bbs);
         m_Subscriptions.insert(pS->m_Peer);
 
-		pS->m_Cursor = m_This.m_Processor.get_DB().BbsFindCursor(msg.m_TimeFrom) - 1;
+		pS->m_Cursor = m_This.m_Bbs.m_Store.FindCursor(msg.m_TimeFrom) - 1;
 
 		BroadcastBbs(*pS);
     }
@@ -3278,13 +4459,12 @@ void Node::Peer::BroadcastBbs(Bbs::Subscription& s)
 	if (IsChocking())
 		return;
 
-	NodeDB& db = m_This.m_Processor.get_DB();
-	NodeDB::WalkerBbs wlk;
+	BbsStore::WalkerChannel wlk;
 
 	wlk.m_Data.m_Channel = s.m_Peer.m_Channel;
 	wlk.m_ID = s.m_Cursor;
 
-	for (db.EnumBbsCSeq(wlk); wlk.MoveNext(); )
+	for (m_This.m_Bbs.m_Store.EnumChannel(wlk); wlk.MoveNext(); )
 	{
 		SendBbsMsg(wlk.m_Data);
 		if (IsChocking())
@@ -3299,7 +4479,7 @@ void Node::Peer::OnMsg(proto::BbsResetSync&& msg)
 	if (!m_This.m_Cfg.m_Bbs.IsEnabled())
 		ThrowUnexpected();
 
-	m_CursorBbs = m_This.m_Processor.get_DB().BbsFindCursor(msg.m_TimeFrom) - 1;
+	m_CursorBbs = m_This.m_Bbs.m_Store.FindCursor(msg.m_TimeFrom) - 1;
 	BroadcastBbs();
 }
 
@@ -3691,8 +4871,31 @@ bool Node::Miner::Restart()
         if (!keys.m_pMiner)
             return false; // offline mining is disabled
 
+    Processor& p = get_ParentObj().m_Processor; // alias
+    TxPool::Fluff& txp = get_ParentObj().m_TxPool;
+
+    if (!m_pFinalizer && m_Template.IsActual(p.m_Cursor.m_ID.m_Hash, txp))
+    {
+        // block contents are the same, only the header timestamp is refreshed
+        const Task& t = *m_Template.m_pTask;
+
+        Task::Ptr pTask(std::make_shared<Task>());
+        pTask->m_Hdr = t.m_Hdr;
+        pTask->m_BodyP = t.m_BodyP;
+        pTask->m_BodyE = t.m_BodyE;
+        pTask->m_Fees = t.m_Fees;
+
+        p.UpdateHdrTimestamp(pTask->m_Hdr);
+        get_ParentObj().m_Metrics.m_MinerTemplatesReused++;
+
+        StartMining(std::move(pTask));
+        return true;
+    }
+
+    m_Template.m_pTask.reset();
+
     NodeProcessor::BlockContext bc(
-        get_ParentObj().m_TxPool,
+        txp,
         keys.m_nMinerSubIndex,
         keys.m_pMiner ? *keys.m_pMiner : *keys.m_pGeneric,
         keys.m_pOwner ? *keys.m_pOwner : *keys.m_pGeneric);
@@ -3700,7 +4903,7 @@ bool Node::Miner::Restart()
     if (m_pFinalizer)
         bc.m_Mode = NodeProcessor::BlockContext::Mode::Assemble;
 
-    bool bRes = get_ParentObj().m_Processor.GenerateNewBlock(bc);
+    bool bRes = p.GenerateNewBlock(bc);
 
     if (!bRes)
     {
@@ -3708,9 +4911,24 @@ bool Node::Miner::Restart()
         return false;
     }
 
+    m_Template.m_PoolVersion = txp.m_Template.m_Version;
+    get_ParentObj().m_Metrics.m_MinerTemplates++;
+
     Task::Ptr pTask(std::make_shared<Task>());
     Cast::Down<NodeProcessor::GeneratedBlock>(*pTask) = std::move(bc);
 
+    if (!m_pFinalizer)
+    {
+        m_Template.m_hvTip = p.m_Cursor.m_ID.m_Hash;
+        m_Template.m_pTask = std::make_shared<Task>();
+
+        Task& t = *m_Template.m_pTask;
+        t.m_Hdr = pTask->m_Hdr;
+        t.m_BodyP = pTask->m_BodyP;
+        t.m_BodyE = pTask->m_BodyE;
+        t.m_Fees = pTask->m_Fees;
+    }
+
     if (m_pFinalizer)
     {
         const NodeProcessor::GeneratedBlock& x = *pTask;
@@ -3732,6 +4950,15 @@ bool Node::Miner::Restart()
     return true;
 }
 
+bool Node::Miner::Template::IsActual(const Merkle::Hash& hvTip, const TxPool::Fluff& txp) const
+{
+    return
+        m_pTask &&
+        (m_hvTip == hvTip) &&
+        txp.m_Template.m_Valid &&
+        (txp.m_Template.m_Version == m_PoolVersion);
+}
+
 void Node::Miner::StartMining(Task::Ptr&& pTask)
 {
     assert(pTask && !m_pTaskToFinalize);
@@ -4164,128 +5391,22 @@ void Node::PeerMan::PeerInfoPlus::DetachStrict()
 
 bool Node::GenerateRecoveryInfo(const char* szPath)
 {
-	if (!m_Processor.BuildCwp())
-		return false; // no info yet
-
-    typedef yas::binary_oarchive<std::FStream, SERIALIZE_OPTIONS> MySerializer;
-
-	struct MyTraveler
-		:public RadixTree::ITraveler
-	{
-		RecoveryInfo::Writer m_Writer;
-		NodeDB* m_pDB;
-
-		virtual bool OnLeaf(const RadixTree::Leaf& x) override
-		{
-			const UtxoTree::MyLeaf& n = Cast::Up<UtxoTree::MyLeaf>(x);
-			UtxoTree::Key::Data d;
-			d = n.m_Key;
-
-			if (n.IsExt())
-			{
-				for (auto p = n.m_pIDs.get_Strict()->m_pTop.get_Strict(); p; p = p->m_pNext.get())
-					OnUtxo(d, p->m_ID);
-			}
-			else
-				OnUtxo(d, n.m_ID);
-
-			return true;
-		}
-
-		void OnUtxo(const UtxoTree::Key::Data& d, TxoID id)
-		{
-			NodeDB::WalkerTxo wlk;
-			m_pDB->TxoGetValue(wlk, id);
-
-			Deserializer der;
-			der.reset(wlk.m_Value.p, wlk.m_Value.n);
-
-            Output outp;
-			der & outp;
-
-            assert(outp.m_Commitment == d.m_Commitment);
-            outp.m_RecoveryOnly = true;
-
-			// 2 ways to discover the UTXO create height: either directly by looking its TxoID in States table, or reverse-engineer it from Maturity
-			// Since currently maturity delta is independent of current height (not a function of height, not changed in current forks) - we prefer the 2nd method, which is faster.
-
-			//NodeDB::StateID sid;
-			//m_pDB->FindStateByTxoID(sid, id);
-			//val.m_CreateHeight = sid.m_Height;
-			//assert(val.m_Output.get_MinMaturity(val.m_CreateHeight) == d.m_Maturity);
-
-			Height hCreateHeight = d.m_Maturity - outp.get_MinMaturity(0);
-
-            MySerializer ser(m_Writer.m_Stream);
-            ser & hCreateHeight;
-            ser & outp;
-		}
-	};
-
-	MyTraveler ctx;
-	ctx.m_pDB = &m_Processor.get_DB();
+	RecoveryGen g(*this);
+	if (!g.Init(szPath))
+		return false;
 
-	try
+	do
 	{
-		ctx.m_Writer.Open(szPath, m_Processor.m_Cwp);
-		m_Processor.get_Utxos().Traverse(ctx);
-
-        Height h = Rules::get().pForks[2].m_Height;
-
-        if (m_Processor.m_Cursor.m_ID.m_Height >= h)
-        {
-            MySerializer ser(ctx.m_Writer.m_Stream);
-            ser & MaxHeight; // terminator
-
-            // shielded in/outs
-            struct MyKrnWalker
-                :public NodeProcessor::KrnWalkerShielded
-            {
-                MySerializer& m_Ser;
-                MyKrnWalker(MySerializer& ser) :m_Ser(ser) {}
-
-                virtual bool OnKrnEx(const TxKernelShieldedInput& krn) override
-                {
-                    m_Ser & m_Height;
-                    m_Ser & false;
-                    m_Ser & krn.m_SpendProof.m_SpendPk;
-                    return true;
-                }
-
-                virtual bool OnKrnEx(const TxKernelShieldedOutput& krn) override
-                {
-                    Cast::NotConst(krn).m_Txo.m_pAsset.reset(); // not needed for recovery atm
-
-                    m_Ser & m_Height;
-                    m_Ser & true;
-                    m_Ser & krn.m_Txo;
-                    m_Ser & krn.m_Msg;
-                    return true;
-                }
-
-            } wlk(ser);
-
-            m_Processor.EnumKernels(wlk, HeightRange(h, m_Processor.m_Cursor.m_ID.m_Height));
-
-            ser & MaxHeight; // terminator
-
-            // assets
-            Asset::Full ai;
-            ai.m_ID = 0;
-
-            while (m_Processor.get_DB().AssetGetNext(ai))
-                ser & ai;
+		if (!g.ReadChunk())
+			return false;
 
-            ser & (Asset::s_MaxCount + 1); // terminator
-        }
+		g.WriteChunk();
+		if (!g.m_bWriteOk)
+			return false;
 
-	}
-	catch (const std::exception& ex)
-	{
-		LOG_ERROR() << ex.what();
-		return false;
-	}
+	} while (!g.m_bLast);
 
+	g.LogDone();
 	return true;
 }
 
@@ -4340,4 +5461,109 @@ void Node::PrintTxos()
     LOG_INFO() << os.str();
 }
 
+void Node::WriteMetrics(std::ostream& os)
+{
+	metrics::Writer w(os);
+	m_Processor.WriteMetrics(w);
+
+	const Metrics& m = m_Metrics; // alias
+
+	w.Header("beam_tx_admission_seconds", "histogram", "Time from the tx arrival till the pool admission verdict");
+	w.Write("beam_tx_admission_seconds", nullptr, m.m_TxAdmission);
+
+	w.Header("beam_tx_verdicts_total", "counter", "Tx pool admission verdicts");
+	w.Value("beam_tx_verdicts_total", "result=\"ok\"", m.m_TxAccepted);
+	w.Value("beam_tx_verdicts_total", "result=\"invalid\"", m.m_TxInvalid);
+	w.Value("beam_tx_verdicts_total", "result=\"rejected\"", m.m_TxRejected);
+
+	w.Header("beam_txpool_txs", "gauge", "Transactions in the fluff pool");
+	w.Value("beam_txpool_txs", nullptr, static_cast<uint64_t>(m_TxPool.m_setTxs.size()));
+
+	w.Header("beam_miner_templates_total", "counter", "Block templates the miner started on");
+	w.Value("beam_miner_templates_total", "kind=\"generated\"", m.m_MinerTemplates);
+	w.Value("beam_miner_templates_total", "kind=\"reused\"", m.m_MinerTemplatesReused);
+
+	w.Header("beam_proof_batches_total", "counter", "Batched proof requests received from clients");
+	w.Value("beam_proof_batches_total", "kind=\"kernels\"", m.m_ProofBatchesKernels);
+	w.Value("beam_proof_batches_total", "kind=\"utxos\"", m.m_ProofBatchesUtxos);
+
+	w.Header("beam_bbs_received_total", "counter", "BBS messages received from peers");
+	w.Value("beam_bbs_received_total", nullptr, m.m_BbsReceived);
+	w.Header("beam_bbs_stored_total", "counter", "New BBS messages stored");
+	w.Value("beam_bbs_stored_total", nullptr, m.m_BbsStored);
+	w.Header("beam_bbs_stored_bytes_total", "counter", "Size of the new BBS messages stored");
+	w.Value("beam_bbs_stored_bytes_total", nullptr, m.m_BbsStoredBytes);
+	w.Header("beam_bbs_relayed_total", "counter", "BBS message announcements sent to peers");
+	w.Value("beam_bbs_relayed_total", nullptr, m.m_BbsRelayed);
+	w.Header("beam_bbs_pushed_total", "counter", "BBS messages sent to peers");
+	w.Value("beam_bbs_pushed_total", nullptr, m.m_BbsPushed);
+
+	const NodeDB::BbsTotals& bbs = m_Bbs.m_Store.get_Totals();
+	w.Header("beam_bbs_store_msgs", "gauge", "BBS messages in the store");
+	w.Value("beam_bbs_store_msgs", nullptr, static_cast<uint64_t>(bbs.m_Count));
+	w.Header("beam_bbs_store_bytes", "gauge", "Size of the BBS messages in the store");
+	w.Value("beam_bbs_store_bytes", nullptr, static_cast<uint64_t>(bbs.m_Size));
+
+	w.Header("beam_peers", "gauge", "Peer connections");
+	w.Value("beam_peers", nullptr, static_cast<uint64_t>(m_lstPeers.size()));
+
+	w.Header("beam_chockings_total", "counter", "Times a peer connection started chocking (too much unsent data)");
+	w.Value("beam_chockings_total", nullptr, m.m_Chockings);
+
+	// traffic totals, including the deleted peers
+	io::TcpStream::State st = m.m_TrafficGone;
+	for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+	{
+		io::TcpStream::State stPeer = it->get_Traffic();
+		st.received += stPeer.received;
+		st.sent += stPeer.sent;
+	}
+
+	w.Header("beam_received_bytes_total", "counter", "Bytes received from all the peers");
+	w.Value("beam_received_bytes_total", nullptr, st.received);
+	w.Header("beam_sent_bytes_total", "counter", "Bytes sent to all the peers");
+	w.Value("beam_sent_bytes_total", nullptr, st.sent);
+
+	// per-peer. The series restart on reconnection
+	std::vector<std::string> vLabels;
+	vLabels.reserve(m_lstPeers.size());
+	for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++)
+		vLabels.push_back("peer=\"" + it->m_RemoteAddr.str() + "\"");
+
+	struct Fmt
+	{
+		static uint64_t Received(Peer& p) { return p.get_Traffic().received; }
+		static uint64_t Sent(Peer& p) { return p.get_Traffic().sent; }
+		static uint64_t Unsent(Peer& p) { return p.get_Unsent(); }
+		static uint64_t Chocking(Peer& p) { return (Peer::Flags::Chocking & p.m_Flags) ? 1 : 0; }
+		static uint64_t Chockings(Peer& p) { return p.m_nChockings; }
+	};
+
+	struct Family
+	{
+		const char* m_szName;
+		const char* m_szType;
+		const char* m_szHelp;
+		uint64_t (*m_pfn)(Peer&);
+	};
+
+	static const Family s_pFamilies[] = {
+		{ "beam_peer_received_bytes", "counter", "Bytes received from the peer", Fmt::Received },
+		{ "beam_peer_sent_bytes", "counter", "Bytes sent to the peer", Fmt::Sent },
+		{ "beam_peer_unsent_bytes", "gauge", "Bytes queued for the peer", Fmt::Unsent },
+		{ "beam_peer_chocking", "gauge", "Whether the peer connection is chocking", Fmt::Chocking },
+		{ "beam_peer_chockings", "counter", "Times the peer connection started chocking", Fmt::Chockings },
+	};
+
+	for (size_t iF = 0; iF < _countof(s_pFamilies); iF++)
+	{
+		const Family& f = s_pFamilies[iF];
+		w.Header(f.m_szName, f.m_szType, f.m_szHelp);
+
+		size_t iPeer = 0;
+		for (PeerList::iterator it = m_lstPeers.begin(); m_lstPeers.end() != it; it++, iPeer++)
+			w.Value(f.m_szName, vLabels[iPeer].c_str(), f.m_pfn(*it));
+	}
+}
+
 } // namespace beam
@@ -15,6 +15,7 @@
 #pragma once
 
 #include "processor.h"
+#include "bbs_store.h"
 #include "utility/io/timer.h"
 #include "core/proto.h"
 #include "core/block_crypt.h"
@@ -87,6 +88,8 @@ struct Node
 			uint32_t m_MessageTimeout_s = 3600 * 12; // 1/2 day
 			uint32_t m_CleanupPeriod_ms = 3600 * 1000; // 1 hour
 
+			std::string m_sPath; // message store directory. If empty - next to the node db
+
 			NodeDB::BbsTotals m_Limit;
 
 			Bbs()
@@ -110,6 +113,9 @@ struct Node
 
 			size_t m_MaxBodyPackSize = 1024 * 1024 * 5;
 			uint32_t m_MaxBodyPackCount = 3000;
+			uint32_t m_BodyPackChunk = 100; // max num of blocks read per reactor cycle while assembling a body pack
+
+			size_t m_BodyCacheSize = 1024 * 1024 * 64; // horizon-cut and recovery bodies, reused for the next syncing peers
 
 		} m_BandwidthCtl;
 
@@ -171,6 +177,8 @@ struct Node
 	void Initialize(IExternalPOW* externalPOW=nullptr);
 
 	NodeProcessor& get_Processor() { return m_Processor; } // for tests only!
+	TxPool::Fluff& get_TxPool() { return m_TxPool; } // for tests only!
+	bool RestartMining() { return m_Miner.Restart(); } // for tests only!
 
 	struct SyncStatus
 	{
@@ -198,8 +206,40 @@ struct Node
 
 	bool DecodeAndCheckHdrs(std::vector<Block::SystemState::Full>&, const proto::HdrPack&);
 
+	void WriteMetrics(std::ostream&); // Prometheus text format. Must be called in the node thread
+
 private:
 
+	struct Metrics
+	{
+		metrics::Histogram m_TxAdmission; // since the tx arrival, for async verification includes the time in the queue
+		uint64_t m_TxAccepted = 0;
+		uint64_t m_TxInvalid = 0; // context-free validation failed
+		uint64_t m_TxRejected = 0; // all other reasons
+
+		uint64_t m_BbsReceived = 0;
+		uint64_t m_BbsStored = 0;
+		uint64_t m_BbsStoredBytes = 0;
+		uint64_t m_BbsRelayed = 0; // BbsHaveMsg sent
+		uint64_t m_BbsPushed = 0; // BbsMsg sent
+
+		uint64_t m_MinerTemplates = 0; // block templates generated
+		uint64_t m_MinerTemplatesReused = 0; // soft restarts on the last generated template
+
+		uint64_t m_ProofBatchesKernels = 0; // GetProofKernels received
+		uint64_t m_ProofBatchesUtxos = 0; // GetProofUtxos received
+
+		uint64_t m_Chockings = 0;
+		io::TcpStream::State m_TrafficGone; // of the deleted peers
+
+		void OnTx(uint8_t nStatus, uint64_t dt_us);
+
+	} m_Metrics;
+
+	struct ProofUtxoRequest;
+	struct TxVerifyRequest;
+	struct BodyPackRequest;
+
 	struct Processor
 		:public NodeProcessor
 	{
@@ -250,6 +290,86 @@ private:
 		io::AsyncEvent::Ptr m_pAsyncPeerInsane;
 		void FlushInsanePeers();
 
+		// utxo proofs are built by the executor threads
+		struct ProofUtxoTask;
+		std::mutex m_MutexProofs;
+		std::vector<std::shared_ptr<ProofUtxoRequest> > m_vProofsDone;
+		io::AsyncEvent::Ptr m_pAsyncProofs;
+		void PushProofUtxo(const std::shared_ptr<ProofUtxoRequest>&);
+		void FlushProofs();
+
+		// context-free verification of the incoming transactions is done by the executor threads.
+		// Txs received during the same reactor cycle are verified in batches
+		struct TxVerifyTask;
+		std::vector<std::shared_ptr<TxVerifyRequest> > m_vTxsQueued;
+		io::Timer::Ptr m_pTxsQueuedTimer;
+		std::mutex m_MutexTxs;
+		std::vector<std::shared_ptr<TxVerifyRequest> > m_vTxsDone;
+		io::AsyncEvent::Ptr m_pAsyncTxs;
+		uint32_t m_TxsPending = 0;
+		bool CanVerifyTxAsync();
+		void PushTxVerify(const std::shared_ptr<TxVerifyRequest>&);
+		void FlushTxsQueued();
+		void FlushTxs();
+
+		// body packs are assembled in chunks, so that other peers are served meanwhile. Bodies requested for recovery are converted by the executor threads
+		struct BodyPackTask;
+		std::mutex m_MutexBodies;
+		std::vector<std::shared_ptr<BodyPackRequest> > m_vBodiesDone;
+		io::AsyncEvent::Ptr m_pAsyncBodies;
+		void PushBodyPack(const std::shared_ptr<BodyPackRequest>&);
+		void FlushBodyPacks();
+		bool ReadBodyPackChunk(BodyPackRequest&);
+
+		struct BodyCache
+		{
+			struct Entry
+			{
+				struct Key
+					:public boost::intrusive::set_base_hook<>
+				{
+					uint64_t m_Row;
+					Height m_h0;
+					Height m_hLo1;
+					Height m_hHi1;
+					uint8_t m_FlagP;
+
+					void Set(uint64_t row, const proto::GetBodyPack&);
+					bool operator < (const Key&) const;
+
+					IMPLEMENT_GET_PARENT_OBJ(Entry, m_Key)
+				} m_Key;
+
+				struct Mru
+					:public boost::intrusive::list_base_hook<>
+				{
+					IMPLEMENT_GET_PARENT_OBJ(Entry, m_Mru)
+				} m_Mru;
+
+				ByteBuffer m_Perishable;
+			};
+
+			typedef boost::intrusive::multiset<Entry::Key> KeySet;
+			typedef boost::intrusive::list<Entry::Mru> MruList;
+
+			KeySet m_setKeys;
+			MruList m_lstMru; // most recently used first
+			size_t m_Size = 0;
+			uint32_t m_Generation = 0; // incremented on clear, conversions started before are not cached
+
+			const ByteBuffer* Find(const Entry::Key&);
+			void Insert(const Entry::Key&, const ByteBuffer&, size_t nSizeMax);
+			void Delete(Entry&);
+			void Clear();
+
+			~BodyCache() { Clear(); }
+		} m_BodyCache;
+
+		bool IsBodyCacheable(const NodeDB::StateID&, const proto::GetBodyPack&);
+		bool GetBody(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive, bool& bConvert); // if bConvert is set - the perishable part should be converted by ConvertRecovery1()
+		void OnBodyConverted(const NodeDB::StateID&, const proto::GetBodyPack&, const ByteBuffer&);
+		static void ConvertRecovery1(ByteBuffer&);
+
 		void DeleteOutdated();
 
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Processor)
@@ -296,6 +416,14 @@ private:
 	void RefreshOwnedUtxos();
 	void MaybeGenerateRecovery();
 
+	// recovery info is generated from the utxo set snapshot, while the node keeps running. The data is read by the reactor thread in chunks,
+	// the serialization and the file i/o are done by the executor
+	struct RecoveryGen;
+	std::shared_ptr<RecoveryGen> m_pRecoveryGen;
+	io::AsyncEvent::Ptr m_pAsyncRecovery;
+	void FlushRecovery();
+	void OnRecoveryGenerated(bool bOk);
+
 	struct Wanted
 	{
 		typedef ECC::Hash::Value KeyType;
@@ -349,7 +477,7 @@ private:
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Dandelion)
 	} m_Dandelion;
 
-	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*);
+	uint8_t OnTransactionStem(Transaction::Ptr&&, const Peer*, const TxVerifyRequest* = nullptr);
 	void OnTransactionAggregated(Dandelion::Element&);
 	void PerformAggregation(Dandelion::Element&);
 	void AddDummyInputs(Transaction&);
@@ -357,9 +485,10 @@ private:
 	bool AddDummyInputEx(Transaction& tx, const CoinID&);
 	void AddDummyOutputs(Transaction&);
 	Height SampleDummySpentHeight();
-	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*);
+	bool OnTransactionFluff(Transaction::Ptr&&, const Peer*, Dandelion::Element*, const TxVerifyRequest* = nullptr);
 
-	uint8_t ValidateTx(Transaction::Context&, const Transaction&); // complete validation
+	uint8_t ValidateTx(Transaction::Context&, const Transaction&, const TxVerifyRequest* = nullptr); // complete validation, the context-free part may be already done
+	uint8_t ValidateTxInternal(Transaction::Context&, const Transaction&, const TxVerifyRequest*);
 	void LogTx(const Transaction&, uint8_t nStatus, const Transaction::KeyType&);
 	void LogTxStem(const Transaction&, const char* szTxt);
 
@@ -403,7 +532,8 @@ private:
 		Subscription::BbsSet m_Subscribed;
 		Timestamp m_HighestPosted_s = 0;
 
-		NodeDB::BbsTotals m_Totals;
+		BbsStore m_Store;
+		void OpenStore();
 
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Bbs)
 	} m_Bbs;
@@ -470,6 +600,7 @@ private:
 
 		uint16_t m_Flags;
 		uint16_t m_Port; // to connect to
+		uint32_t m_nChockings;
 		beam::io::Address m_RemoteAddr; // for logging only
 
 		Block::SystemState::Full m_Tip;
@@ -503,7 +634,6 @@ private:
 		void BroadcastBbs(Bbs::Subscription&);
 		void OnChocking();
 		void SetTxCursor(TxPool::Fluff::Element*);
-		bool GetBlock(proto::BodyBuffers&, const NodeDB::StateID&, const proto::GetBodyPack&, bool bActive);
 
 		bool IsChocking(size_t nExtra = 0);
 		bool ShouldAssignTasks();
@@ -515,6 +645,26 @@ private:
 
 		void SendTx(Transaction::Ptr& ptx, bool bFluff);
 
+		// Requests processed asynchronously. Responses must preserve the order, hence all the consequent messages are deferred till they're done
+		struct Deferred
+		{
+			virtual ~Deferred() {}
+			virtual bool IsReady() const { return true; }
+			virtual void Process(Peer&) = 0;
+		};
+
+		template <typename TMsg>
+		struct DeferredMsg;
+		struct DeferredProofUtxo;
+		struct DeferredTx;
+		struct DeferredBodyPack;
+
+		std::deque<std::unique_ptr<Deferred> > m_lstDeferred;
+		bool* m_pbDeleted; // set while the deferred queue is processed
+
+		void PushProofUtxo(std::shared_ptr<ProofUtxoRequest>&&);
+		void FlushDeferred();
+
 		// proto::NodeConnection
 		virtual void OnConnectedSecure() override;
 		virtual void OnDisconnect(const DisconnectReason&) override;
@@ -544,6 +694,8 @@ private:
 		virtual void OnMsg(proto::GetProofKernel&&) override;
 		virtual void OnMsg(proto::GetProofKernel2&&) override;
 		virtual void OnMsg(proto::GetProofUtxo&&) override;
+		virtual void OnMsg(proto::GetProofKernels&&) override;
+		virtual void OnMsg(proto::GetProofUtxos&&) override;
 		virtual void OnMsg(proto::GetProofShieldedOutp&&) override;
 		virtual void OnMsg(proto::GetProofShieldedInp&&) override;
 		virtual void OnMsg(proto::GetProofAsset&&) override;
@@ -560,6 +712,66 @@ private:
 		virtual void OnMsg(proto::GetEvents&&) override;
 		virtual void OnMsg(proto::BlockFinalization&&) override;
 		virtual void OnMsg(proto::GetStateSummary&&) override;
+
+#define THE_MACRO(code, msg) virtual bool OnMsg2(proto::msg&&) override;
+		BeamNodeMsgsAll(THE_MACRO)
+#undef THE_MACRO
+	};
+
+	struct ProofUtxoRequest
+	{
+		typedef std::shared_ptr<ProofUtxoRequest> Ptr;
+
+		Peer* m_pPeer; // reset if the peer is deleted meanwhile
+		std::vector<ECC::Point> m_vUtxos;
+		Height m_MaturityMin = 0;
+		bool m_bBatch = false; // GetProofUtxos, otherwise GetProofUtxo
+		NodeProcessor::UtxoSnapshot::Ptr m_pSnapshot;
+
+		std::vector<std::vector<Input::Proof> > m_vRes; // per utxo
+		bool m_bOk = false; // set by the executor
+		bool m_bDone = false;
+
+		bool Build(NodeProcessor&, const NodeProcessor::UtxoSnapshot&); // thread-safe
+		void Send(Peer&);
+	};
+
+	struct TxVerifyRequest
+	{
+		typedef std::shared_ptr<TxVerifyRequest> Ptr;
+
+		Peer* m_pPeer; // reset if the peer is deleted meanwhile
+		Transaction::Ptr m_pTx;
+		bool m_bFluff;
+
+		Transaction::Context::Params m_Pars;
+		Transaction::Context m_Ctx; // m_Height.m_Min must be set
+		Height m_hVerify; // the result is only reused at this height
+		bool m_bOk = false; // set by the executor
+		bool m_bDone = false;
+		uint64_t m_T0_us; // arrival time
+
+		TxVerifyRequest() :m_Ctx(m_Pars) {}
+	};
+
+	struct BodyPackRequest
+	{
+		typedef std::shared_ptr<BodyPackRequest> Ptr;
+
+		Peer* m_pPeer; // reset if the peer is deleted meanwhile
+		proto::GetBodyPack m_Msg;
+		uint64_t m_RowTop;
+		Height m_hNext;
+		Height m_hMax;
+		size_t m_nSize = 0;
+		uint32_t m_Generation; // of the body cache
+
+		// the current chunk
+		size_t m_iChunk0 = 0;
+		std::vector<bool> m_vConvert;
+
+		proto::BodyPack m_Res;
+		bool m_bDone = false;
 	};
 
 	typedef boost::intrusive::list<Peer> PeerList;
@@ -670,6 +882,16 @@ private:
 		void OnTimer();
 		void SetTimer(uint32_t timeout_ms, bool bHard);
 
+		struct Template
+		{
+			// the last generated block, reused on soft restarts if neither the tip nor the relevant part of the tx pool changed
+			Task::Ptr m_pTask; // not being-mined, only keeps the serialized body
+			Merkle::Hash m_hvTip;
+			uint64_t m_PoolVersion = 0;
+
+			bool IsActual(const Merkle::Hash& hvTip, const TxPool::Fluff&) const;
+		} m_Template;
+
 		IMPLEMENT_GET_PARENT_OBJ(Node, m_Miner)
 	} m_Miner;
 };
@@ -21,6 +21,7 @@
 #include "../utility/logger_checkpoints.h"
 #include <condition_variable>
 #include <cctype>
+#include <iomanip>
 
 namespace beam {
 
@@ -109,6 +110,15 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 
 	m_Mmr.m_Assets.m_Count = m_DB.ParamIntGetDef(NodeDB::ParamID::AssetsCount);
 
+	{
+		std::string sPath;
+		get_MappingPath(sPath, szPath, "-shielded-mmr.bin");
+		m_Mmr.m_Shielded.Open(sPath.c_str());
+
+		get_MappingPath(sPath, szPath, "-assets-mmr.bin");
+		m_Mmr.m_Assets.Open(sPath.c_str());
+	}
+
 	bool bUpdateChecksum = !m_DB.ParamGet(NodeDB::ParamID::CfgChecksum, NULL, &blob);
 	if (!bUpdateChecksum)
 	{
@@ -164,6 +174,8 @@ void NodeProcessor::Initialize(const char* szPath, const StartParams& sp)
 	InitCursor(false);
 
 	InitializeUtxos(szPath);
+	InitShieldedImage(szPath);
+	InitKernelIndex(szPath);
 
 	m_Extra.m_Txos = get_TxosBefore(m_Cursor.m_ID.m_Height + 1);
 
@@ -234,9 +246,9 @@ int My_strcmpi(const char* sz1, const char* sz2)
 	return 0;
 }
 
-void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+void NodeProcessor::get_MappingPath(std::string& sPath, const char* sz, const char* szSufixNew)
 {
-	// derive UTXO path from db path
+	// derive the path from db path
 	sPath = sz;
 
 	static const char szSufix[] = ".db";
@@ -245,7 +257,12 @@ void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
 	if ((sPath.size() >= nSufix) && !My_strcmpi(sPath.c_str() + sPath.size() - nSufix, szSufix))
 		sPath.resize(sPath.size() - nSufix);
 
-	sPath += "-utxo-image.bin";
+	sPath += szSufixNew;
+}
+
+void NodeProcessor::get_UtxoMappingPath(std::string& sPath, const char* sz)
+{
+	get_MappingPath(sPath, sz, "-utxo-image.bin");
 }
 
 bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset)
@@ -267,6 +284,143 @@ bool NodeProcessor::InitUtxoMapping(const char* sz, bool bForceReset)
 	return m_Utxos.Open(sPath.c_str(), us);
 }
 
+void NodeProcessor::InitShieldedImage(const char* sz)
+{
+	std::string sPath;
+	get_MappingPath(sPath, sz, "-shielded-image.bin");
+
+	ShieldedImage::Stamp st;
+	Blob blob(st);
+
+	if (!m_DB.ParamGet(NodeDB::ParamID::ShieldedImageStamp, nullptr, &blob))
+		st = Zero; // never matches
+
+	if (m_ShieldedImage.Open(sPath.c_str(), st, m_Extra.m_ShieldedOutputs))
+		return;
+
+	LOG_INFO() << "Rebuilding shielded image...";
+
+	m_ShieldedImage.Resize(m_Extra.m_ShieldedOutputs);
+
+	std::vector<ECC::Point::Storage> v;
+	const uint64_t nChunk = 0x4000;
+
+	for (uint64_t i = 0; i < m_Extra.m_ShieldedOutputs; )
+	{
+		uint64_t n = std::min(nChunk, m_Extra.m_ShieldedOutputs - i);
+		v.resize(n);
+
+		m_DB.ShieldedRead(i, &v.front(), n);
+		m_ShieldedImage.Write(i, &v.front(), n);
+
+		i += n;
+	}
+}
+
+void NodeProcessor::InitKernelIndex(const char* sz)
+{
+	std::string sPath;
+	get_MappingPath(sPath, sz, "-kernels-image.bin");
+
+	NodeDB::KernelIndex::Stamp st;
+	Blob blob(st);
+
+	if (!m_DB.ParamGet(NodeDB::ParamID::KernelIndexStamp, nullptr, &blob))
+		st = Zero; // never matches
+
+	if (m_KernelIndex.Open(sPath.c_str(), st))
+		return;
+
+	LOG_INFO() << "Rebuilding kernel index...";
+
+	NodeDB::WalkerKernel wlk;
+	for (m_DB.EnumKernels(wlk); wlk.MoveNext(); )
+	{
+		if (wlk.m_ID.n != Merkle::Hash::nBytes)
+			OnCorrupted();
+
+		m_KernelIndex.Insert(Merkle::Hash(wlk.m_ID), wlk.m_Height);
+	}
+}
+
+Height NodeProcessor::FindKernel(const Merkle::Hash& id)
+{
+	return m_KernelIndex.IsOpen() ?
+		m_KernelIndex.Find(id) :
+		m_DB.FindKernel(id);
+}
+
+bool NodeProcessor::ShieldedImage::Open(const char* sz, const Stamp& st, uint64_t nCount)
+{
+	// change this when format changes
+	static const uint8_t s_pSig[] = {
+		0x5A, 0x19, 0xE3, 0x6D,
+		0x82, 0xC7, 0x0B, 0xF4,
+		0x3E, 0xA1, 0x56, 0x98,
+		0xD0, 0x2F, 0x74, 0xBB
+	};
+
+	MappedFile::Defs d;
+	d.m_pSig = s_pSig;
+	d.m_nSizeSig = sizeof(s_pSig);
+	d.m_nBanks = 0;
+	d.m_nFixedHdr = sizeof(Hdr);
+
+	m_nData0 = d.get_SizeMin();
+
+	m_Mapping.Open(sz, d);
+
+	const Hdr& h = get_Hdr();
+	if (!h.m_Dirty && (h.m_Stamp == st) && !(st == Zero) && (h.m_Count == nCount))
+		return true;
+
+	m_Mapping.Open(sz, d, true);
+	return false;
+}
+
+void NodeProcessor::ShieldedImage::FlushStrict(const Stamp& st)
+{
+	Hdr& h = get_Hdr();
+	assert(h.m_Dirty);
+
+	h.m_Stamp = st;
+	h.m_Dirty = 0;
+}
+
+void NodeProcessor::ShieldedImage::Resize(uint64_t nCount)
+{
+	OnDirty();
+
+	MappedFile::Offset nSize = m_nData0 + nCount * sizeof(ECC::Point::Storage);
+	if (m_Mapping.get_Size() < nSize)
+	{
+		// grow with some reserve, to avoid remapping on every block
+		const MappedFile::Offset nChunk = 1024 * 1024;
+		m_Mapping.EnsureSize((nSize + nChunk - 1) / nChunk * nChunk);
+	}
+
+	get_Hdr().m_Count = nCount;
+}
+
+void NodeProcessor::ShieldedImage::Write(uint64_t pos, const ECC::Point::Storage* p, uint64_t nCount)
+{
+	assert(pos + nCount <= get_Count());
+	OnDirty();
+
+	memcpy(Cast::NotConst(get_Data()) + pos, p, nCount * sizeof(ECC::Point::Storage));
+}
+
+void NodeProcessor::ShieldedRead(TxoID id0, ECC::Point::Storage* p, uint64_t nCount)
+{
+	if (m_ShieldedImage.IsOpen() && (id0 + nCount <= m_ShieldedImage.get_Count()))
+	{
+		if (nCount)
+			memcpy(p, m_ShieldedImage.get_Data() + id0, nCount * sizeof(ECC::Point::Storage));
+	}
+	else
+		m_DB.ShieldedRead(id0, p, nCount);
+}
+
 void NodeProcessor::LogSyncData()
 {
 	if (!IsFastSync())
@@ -288,8 +442,8 @@ void NodeProcessor::SaveSyncData()
 
 NodeProcessor::Mmr::Mmr(NodeDB& db)
 	:m_States(db)
-	,m_Shielded(db, NodeDB::StreamType::ShieldedMmr, true)
-	,m_Assets(db, NodeDB::StreamType::AssetsMmr, true)
+	,m_Shielded(db, NodeDB::ParamID::ShieldedMmrJournal, NodeDB::StreamType::ShieldedMmr, true)
+	,m_Assets(db, NodeDB::ParamID::AssetsMmrJournal, NodeDB::StreamType::AssetsMmr, true)
 {
 }
 
@@ -310,35 +464,174 @@ NodeProcessor::~NodeProcessor()
 	}
 }
 
+static void UpdateStamp(NodeDB& db, NodeDB::ParamID::Enum eParam, Merkle::Hash& hv)
+{
+	Blob blob(hv);
+
+	if (db.ParamGet(eParam, nullptr, &blob)) {
+		ECC::Hash::Processor() << hv >> hv;
+	} else {
+		ECC::GenRandom(hv);
+	}
+
+	db.ParamSet(eParam, nullptr, &blob);
+}
+
 void NodeProcessor::CommitUtxosAndDB()
 {
+	uint64_t t0_us = GetTime_us();
+
 	UtxoTreeMapped::Stamp us;
 
 	bool bFlushUtxos = (m_Utxos.IsOpen() && m_Utxos.get_Hdr().m_Dirty);
-
 	if (bFlushUtxos)
-	{
-		Blob blob(us);
+		UpdateStamp(m_DB, NodeDB::ParamID::UtxoStamp, us);
 
-		if (m_DB.ParamGet(NodeDB::ParamID::UtxoStamp, nullptr, &blob)) {
-			ECC::Hash::Processor() << us >> us;
-		} else {
-			ECC::GenRandom(us);
-		}
+	ShieldedImage::Stamp ss;
 
-		m_DB.ParamSet(NodeDB::ParamID::UtxoStamp, nullptr, &blob);
-	}
+	bool bFlushShielded = m_ShieldedImage.IsDirty();
+	if (bFlushShielded)
+		UpdateStamp(m_DB, NodeDB::ParamID::ShieldedImageStamp, ss);
+
+	NodeDB::KernelIndex::Stamp ks;
+
+	bool bFlushKernels = m_KernelIndex.IsDirty();
+	if (bFlushKernels)
+		UpdateStamp(m_DB, NodeDB::ParamID::KernelIndexStamp, ks);
+
+	m_Mmr.m_Shielded.SaveJournal();
+	m_Mmr.m_Assets.SaveJournal();
 
 	m_DbTx.Commit();
 
 	if (bFlushUtxos)
 		m_Utxos.FlushStrict(us);
+
+	if (bFlushShielded)
+		m_ShieldedImage.FlushStrict(ss);
+
+	if (bFlushKernels)
+		m_KernelIndex.FlushStrict(ks);
+
+	m_Mmr.m_Shielded.FlushJournal();
+	m_Mmr.m_Assets.FlushJournal();
+
+	// all the applied blocks are committed now
+	ImportStats::Stage& stats = m_ImportStats.m_Commit;
+	stats.m_Blocks = m_ImportStats.m_Apply.m_Blocks;
+	stats.m_Bytes = m_ImportStats.m_Apply.m_Bytes;
+
+	uint64_t dt_us = GetTime_us() - t0_us;
+	stats.m_Busy_us += dt_us;
+	stats.m_Latency.Add(dt_us);
+}
+
+void NodeProcessor::ImportStats::Stage::Add(uint64_t nBytes, uint64_t dt_us)
+{
+	m_Blocks++;
+	m_Bytes += nBytes;
+	m_Busy_us += dt_us;
+	m_Latency.Add(dt_us);
+}
+
+void NodeProcessor::MaybeLogImportStats()
+{
+	const uint64_t nInterval_us = 10 * 1000 * 1000;
+
+	uint64_t t_us = GetTime_us();
+	uint64_t dt_us = t_us - m_ImportReport.m_Time_us;
+	if (dt_us < nInterval_us)
+		return;
+
+	if (m_ImportReport.m_Time_us && (dt_us < nInterval_us * 2)) // otherwise we were idle, just restart the measurement
+		LogImportStats(m_ImportReport.m_Stats, dt_us);
+
+	m_ImportReport.m_Stats = m_ImportStats;
+	m_ImportReport.m_Time_us = t_us;
+}
+
+void NodeProcessor::LogImportStats(const ImportStats& prev, uint64_t dt_us)
+{
+	struct Fmt
+	{
+		static void Stage(std::ostream& os, const char* sz, const ImportStats::Stage& s1, const ImportStats::Stage& s0, uint64_t dt_us)
+		{
+			double k = 1e6 / dt_us;
+			os
+				<< " " << sz << ": "
+				<< std::fixed << std::setprecision(1)
+				<< (s1.m_Blocks - s0.m_Blocks) * k << " blk/s, "
+				<< (s1.m_Bytes - s0.m_Bytes) * k / (1024 * 1024) << " MB/s, load="
+				<< std::setprecision(2)
+				<< static_cast<double>(s1.m_Busy_us - s0.m_Busy_us) / dt_us << ";";
+		}
+	};
+
+	const ImportStats& cur = m_ImportStats; // alias
+
+	std::ostringstream os;
+	os << "Import rate";
+	Fmt::Stage(os, "Decode", cur.m_Decode, prev.m_Decode, dt_us);
+	Fmt::Stage(os, "Verify", cur.m_Verify, prev.m_Verify, dt_us);
+	Fmt::Stage(os, "Apply", cur.m_Apply, prev.m_Apply, dt_us);
+	Fmt::Stage(os, "Commit", cur.m_Commit, prev.m_Commit, dt_us);
+
+	os
+		<< std::setprecision(2)
+		<< " Stalled on decode=" << static_cast<double>(cur.m_StallDecode_us - prev.m_StallDecode_us) / dt_us
+		<< ", verify=" << static_cast<double>(cur.m_StallVerify_us - prev.m_StallVerify_us) / dt_us;
+
+	LOG_INFO() << os.str();
+}
+
+void NodeProcessor::WriteMetrics(metrics::Writer& w) const
+{
+	const ImportStats& s = m_ImportStats; // alias
+
+	struct Stage
+	{
+		const char* m_szLabel;
+		const ImportStats::Stage& m_Stats;
+	};
+
+	const Stage pStages[] = {
+		{ "stage=\"decode\"", s.m_Decode },
+		{ "stage=\"verify\"", s.m_Verify },
+		{ "stage=\"apply\"", s.m_Apply },
+		{ "stage=\"commit\"", s.m_Commit },
+	};
+
+	w.Header("beam_import_blocks_total", "counter", "Blocks passed the import stage");
+	for (size_t i = 0; i < _countof(pStages); i++)
+		w.Value("beam_import_blocks_total", pStages[i].m_szLabel, pStages[i].m_Stats.m_Blocks);
+
+	w.Header("beam_import_bytes_total", "counter", "Size of the blocks passed the import stage");
+	for (size_t i = 0; i < _countof(pStages); i++)
+		w.Value("beam_import_bytes_total", pStages[i].m_szLabel, pStages[i].m_Stats.m_Bytes);
+
+	w.Header("beam_import_busy_seconds_total", "counter", "Time spent in the import stage, summed over all the threads");
+	for (size_t i = 0; i < _countof(pStages); i++)
+		w.Value("beam_import_busy_seconds_total", pStages[i].m_szLabel, pStages[i].m_Stats.m_Busy_us * 1e-6);
+
+	w.Header("beam_import_stage_seconds", "histogram", "Import stage duration per block (for commit - per batch)");
+	for (size_t i = 0; i < _countof(pStages); i++)
+		w.Write("beam_import_stage_seconds", pStages[i].m_szLabel, pStages[i].m_Stats.m_Latency);
+
+	w.Header("beam_import_stall_seconds_total", "counter", "Time the apply stage waited for the other stages");
+	w.Value("beam_import_stall_seconds_total", "on=\"decode\"", s.m_StallDecode_us * 1e-6);
+	w.Value("beam_import_stall_seconds_total", "on=\"verify\"", s.m_StallVerify_us * 1e-6);
+
+	w.Header("beam_height", "gauge", "Current blockchain height");
+	w.Value("beam_height", nullptr, static_cast<uint64_t>(m_Cursor.m_ID.m_Height));
+
+	w.Header("beam_utxo_mapped_bytes", "gauge", "Size of the mapped UTXO tree image");
+	w.Value("beam_utxo_mapped_bytes", nullptr, static_cast<uint64_t>(m_Utxos.get_MappedSize()));
 }
 
 void NodeProcessor::Vacuum()
 {
 	if (m_DbTx.IsInProgress())
-		m_DbTx.Commit();
+		CommitUtxosAndDB();
 
 	LOG_INFO() << "DB compacting...";
 	m_DB.Vacuum();
@@ -878,7 +1171,24 @@ struct NodeProcessor::MultiShieldedContext
 	bool IsValid(const TxVectors::Eternal&, ECC::InnerProduct::BatchContext&, uint32_t iVerifier, uint32_t nTotal);
 private:
 
-	Sigma::CmListVec m_Lst;
+	struct CmList
+		:public Sigma::CmList
+	{
+		const ECC::Point::Storage* m_p;
+		uint32_t m_Count;
+
+		virtual bool get_At(ECC::Point::Storage& res, uint32_t iIdx) override
+		{
+			if (iIdx >= m_Count)
+				return false;
+
+			res = m_p[iIdx];
+			return true;
+		}
+	};
+
+	CmList m_Lst;
+	std::vector<ECC::Point::Storage> m_vBuf; // if the image is unavailable
 
 	bool IsValid(const TxKernelShieldedInput&, std::vector<ECC::Scalar::Native>& vBuf, ECC::InnerProduct::BatchContext&);
 
@@ -889,8 +1199,19 @@ private:
 
 	virtual void PrepareList(NodeProcessor& np, const Node& n) override
 	{
-		m_Lst.m_vec.resize(s_Chunk); // will allocate if empty
-		np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_Lst.m_vec.front() + n.m_Min, n.m_Max - n.m_Min);
+		m_Lst.m_Count = n.m_Max;
+
+		// Windows of all the kernels are already merged into chunks, each chunk is read once.
+		// Use the image in-place (no copy), it's not modified during the calculation.
+		const ShieldedImage& img = np.m_ShieldedImage;
+		if (img.IsOpen() && (n.m_ID.m_Value + n.m_Max <= img.get_Count()))
+			m_Lst.m_p = img.get_Data() + n.m_ID.m_Value;
+		else
+		{
+			m_vBuf.resize(s_Chunk); // will allocate if empty
+			np.get_DB().ShieldedRead(n.m_ID.m_Value + n.m_Min, &m_vBuf.front() + n.m_Min, n.m_Max - n.m_Min);
+			m_Lst.m_p = &m_vBuf.front();
+		}
 	}
 };
 
@@ -1060,6 +1381,7 @@ struct NodeProcessor::MultiblockContext
 	MultiAssetContext m_Mac;
 
 	size_t m_SizePending = 0;
+	size_t m_SizeLast = 0; // raw size of the last handled block, for stats
 	bool m_bFail = false;
 	bool m_bBatchDirty = false;
 
@@ -1097,12 +1419,24 @@ struct NodeProcessor::MultiblockContext
 			TxBase::Context::Params m_Pars;
 			TxBase::Context m_Ctx;
 
+			// decode stage
+			NodeDB::StateID m_Sid;
+			ByteBuffer m_bbP;
+			ByteBuffer m_bbE;
+			bool m_bDecoded = false;
+			bool m_bDecodeOk = false;
+
+			// verify stage
+			uint64_t m_Busy_us = 0; // summed over all the verifiers
+
 			SharedBlock(MultiblockContext& mbc)
 				:Shared(mbc)
 				,m_Ctx(m_Pars)
 			{
 			}
 
+			void Decode();
+
 			virtual ~SharedBlock() {} // auto
 
 			virtual void Exec(uint32_t iVerifier) override;
@@ -1112,6 +1446,93 @@ struct NodeProcessor::MultiblockContext
 		uint32_t m_iVerifier;
 	};
 
+	struct DecodeTask
+		:public Executor::TaskAsync
+	{
+		MyTask::SharedBlock::Ptr m_pShared;
+		virtual void Exec(Executor::Context&) override { m_pShared->Decode(); }
+	};
+
+	// blocks that are read from DB and deserialized in the executor ahead of being applied
+	std::deque<MyTask::SharedBlock::Ptr> m_queDecode;
+	size_t m_SizeDecode = 0;
+
+	void DecodeAhead(const std::vector<uint64_t>& vPath, size_t& iPos, NodeDB::StateID& sid)
+	{
+		const size_t nSizeMax = 1024 * 1024 * 10; // same as the verification backlog
+		const size_t nCountMax = 256;
+
+		while (iPos && (m_SizeDecode <= nSizeMax) && (m_queDecode.size() < nCountMax))
+		{
+			sid.m_Row = vPath[--iPos];
+			sid.m_Height++;
+			PushDecode(sid);
+		}
+	}
+
+	void PushDecode(const NodeDB::StateID& sid)
+	{
+		MyTask::SharedBlock::Ptr pShared = std::make_shared<MyTask::SharedBlock>(*this);
+		pShared->m_Sid = sid;
+		m_This.m_DB.GetStateBlock(sid.m_Row, &pShared->m_bbP, &pShared->m_bbE, nullptr);
+		pShared->m_Size = pShared->m_bbP.size() + pShared->m_bbE.size();
+
+		m_queDecode.push_back(pShared);
+		m_SizeDecode += pShared->m_Size;
+
+		std::unique_ptr<DecodeTask> pTask(new DecodeTask);
+		pTask->m_pShared = std::move(pShared);
+		m_This.get_Executor().Push(std::move(pTask));
+	}
+
+	MyTask::SharedBlock::Ptr PopDecoded(const NodeDB::StateID& sid)
+	{
+		if (!m_queDecode.empty() && (m_queDecode.front()->m_Sid.m_Row != sid.m_Row))
+		{
+			// path changed, discard the read-ahead
+			m_queDecode.clear();
+			m_SizeDecode = 0;
+		}
+
+		if (m_queDecode.empty())
+			PushDecode(sid);
+
+		MyTask::SharedBlock::Ptr pShared = std::move(m_queDecode.front());
+		m_queDecode.pop_front();
+
+		assert(m_SizeDecode >= pShared->m_Size);
+		m_SizeDecode -= pShared->m_Size;
+
+		uint64_t t0_us = 0;
+		Executor& ex = m_This.get_Executor();
+		for (uint32_t nTasks = static_cast<uint32_t>(-1); ; )
+		{
+			{
+				std::unique_lock<std::mutex> scope(m_Mutex);
+				if (pShared->m_bDecoded)
+					break;
+			}
+
+			if (!t0_us)
+				t0_us = GetTime_us();
+
+			assert(nTasks);
+			nTasks = ex.Flush(nTasks - 1);
+		}
+
+		if (t0_us)
+			m_This.m_ImportStats.m_StallDecode_us += GetTime_us() - t0_us;
+
+		return pShared;
+	}
+
+	void MaybeLogStats()
+	{
+		// decode and verify counters are updated by the executor threads
+		std::unique_lock<std::mutex> scope(m_Mutex);
+		m_This.MaybeLogImportStats();
+	}
+
 	bool Flush()
 	{
 		FlushInternal();
@@ -1236,6 +1657,7 @@ struct NodeProcessor::MultiblockContext
 
 		const size_t nSizeMax = 1024 * 1024 * 10; // fair enough
 
+		uint64_t t0_us = 0;
 		Executor& ex = m_This.get_Executor();
 		for (uint32_t nTasks = static_cast<uint32_t>(-1); ; )
 		{
@@ -1248,10 +1670,16 @@ struct NodeProcessor::MultiblockContext
 				}
 			}
 
+			if (!t0_us)
+				t0_us = GetTime_us();
+
 			assert(nTasks);
 			nTasks = ex.Flush(nTasks - 1);
 		}
 
+		if (t0_us)
+			m_This.m_ImportStats.m_StallVerify_us += GetTime_us() - t0_us;
+
 		m_InProgress.m_Max++;
 		assert(m_InProgress.m_Max == pShared->m_Ctx.m_Height.m_Min);
 
@@ -1321,8 +1749,40 @@ void NodeProcessor::MultiblockContext::MyTask::Exec(Executor::Context&)
 	m_pShared->Exec(m_iVerifier);
 }
 
+void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Decode()
+{
+	uint64_t t0_us = GetTime_us();
+	bool bOk = true;
+
+	try {
+		Deserializer der;
+		der.reset(m_bbP);
+		der & Cast::Down<Block::BodyBase>(m_Body);
+		der & Cast::Down<TxVectors::Perishable>(m_Body);
+
+		der.reset(m_bbE);
+		der & Cast::Down<TxVectors::Eternal>(m_Body);
+	}
+	catch (const std::exception&) {
+		bOk = false;
+	}
+
+	// raw data is not needed anymore
+	ByteBuffer().swap(m_bbP);
+	ByteBuffer().swap(m_bbE);
+
+	uint64_t dt_us = GetTime_us() - t0_us;
+
+	std::unique_lock<std::mutex> scope(m_Mbc.m_Mutex);
+	m_bDecoded = true;
+	m_bDecodeOk = bOk;
+	m_Mbc.m_This.m_ImportStats.m_Decode.Add(m_Size, dt_us);
+}
+
 void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerifier)
 {
+	uint64_t t0_us = GetTime_us();
+
 	TxBase::Context ctx(m_Ctx.m_Params);
 	ctx.m_Height = m_Ctx.m_Height;
 	ctx.m_iVerifier = iVerifier;
@@ -1346,9 +1806,13 @@ void NodeProcessor::MultiblockContext::MyTask::SharedBlock::Exec(uint32_t iVerif
 	if (bValid)
 		bValid = m_Ctx.Merge(ctx);
 
+	m_Busy_us += GetTime_us() - t0_us;
+
 	assert(m_Done < m_Pars.m_nVerifiers);
 	if (++m_Done == m_Pars.m_nVerifiers)
 	{
+		m_Mbc.m_This.m_ImportStats.m_Verify.Add(m_Size, m_Busy_us);
+
 		assert(m_Mbc.m_SizePending >= m_Size);
 		m_Mbc.m_SizePending -= m_Size;
 
@@ -1434,13 +1898,20 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 	bool bContextFail = false, bKeepBlocks = false;
 
 	NodeDB::StateID sidFwd = m_Cursor.m_Sid;
+	NodeDB::StateID sidDecode = m_Cursor.m_Sid;
 
-	size_t iPos = vPath.size();
+	size_t iPos = vPath.size(), iPosDecode = iPos;
 	while (iPos)
 	{
 		sidFwd.m_Height = m_Cursor.m_Sid.m_Height + 1;
 		sidFwd.m_Row = vPath[--iPos];
 
+		// keep the following blocks decoding in the executor while this one is applied
+		mbc.DecodeAhead(vPath, iPosDecode, sidDecode);
+
+		uint64_t t0_us = GetTime_us();
+		uint64_t nStall_us = m_ImportStats.m_StallDecode_us + m_ImportStats.m_StallVerify_us;
+
 		Block::SystemState::Full s;
 		m_DB.get_State(sidFwd.m_Row, s); // need it for logging anyway
 
@@ -1466,6 +1937,10 @@ void NodeProcessor::TryGoTo(NodeDB::StateID& sidTrg)
 		if (IsFastSync())
 			m_DB.DelStateBlockPP(sidFwd.m_Row); // save space
 
+		nStall_us = m_ImportStats.m_StallDecode_us + m_ImportStats.m_StallVerify_us - nStall_us;
+		m_ImportStats.m_Apply.Add(mbc.m_SizeLast, GetTime_us() - t0_us - nStall_us);
+		mbc.MaybeLogStats();
+
 		if (mbc.m_InProgress.m_Max == m_SyncData.m_Target.m_Height)
 		{
 			if (!mbc.Flush())
@@ -1726,6 +2201,7 @@ Height NodeProcessor::RaiseTxoLo(Height hTrg)
 
 	m_Extra.m_TxoLo = hTrg;
 	m_DB.ParamIntSet(NodeDB::ParamID::HeightTxoLo, m_Extra.m_TxoLo);
+	m_DB.BodyCacheDelOutdated(m_Extra.m_TxoLo, m_Extra.m_TxoHi);
 
 	return hRet;
 }
@@ -1763,6 +2239,7 @@ Height NodeProcessor::RaiseTxoHi(Height hTrg)
 	}
 
 	m_DB.ParamIntSet(NodeDB::ParamID::HeightTxoHi, m_Extra.m_TxoHi);
+	m_DB.BodyCacheDelOutdated(m_Extra.m_TxoLo, m_Extra.m_TxoHi);
 
 	return hRet;
 }
@@ -1832,7 +2309,7 @@ bool NodeProcessor::Evaluator::get_History(Merkle::Hash& hv)
 
 bool NodeProcessor::Evaluator::get_Utxos(Merkle::Hash& hv)
 {
-	m_Proc.m_Utxos.get_Hash(hv);
+	m_Proc.m_Utxos.get_Hash(hv, m_Proc.get_Executor());
 	return true;
 }
 
@@ -1861,6 +2338,102 @@ void NodeProcessor::ProofBuilderHard::OnProof(Merkle::Hash& hv, bool bNewOnRight
 	m_Proof.back() = hv;
 }
 
+const NodeProcessor::UtxoSnapshot::Ptr& NodeProcessor::PublishUtxos()
+{
+	uint64_t nEpoch = m_Utxos.Publish();
+
+	if (!m_pUtxoSnapshot || (m_pUtxoSnapshot->m_Epoch != nEpoch) || (m_pUtxoSnapshot->m_ID != m_Cursor.m_ID))
+	{
+		std::shared_ptr<UtxoSnapshot> pRes = std::make_shared<UtxoSnapshot>();
+		pRes->m_Epoch = nEpoch;
+		pRes->m_ID = m_Cursor.m_ID;
+
+		// the rest of the proof is the same for all the utxos
+		struct MyProofBuilder
+			:public ProofBuilder
+		{
+			using ProofBuilder::ProofBuilder;
+			virtual bool get_Utxos(Merkle::Hash&) override { return false; }
+		};
+
+		MyProofBuilder pb(*this, pRes->m_ProofOuter);
+		pb.GenerateProof();
+
+		m_pUtxoSnapshot = std::move(pRes);
+	}
+
+	return m_pUtxoSnapshot;
+}
+
+bool NodeProcessor::get_ProofUtxo(std::vector<Input::Proof>& vRes, const ECC::Point& comm, Height hMaturityMin, const UtxoSnapshot& us)
+{
+	RadixHashTree::Reader r(m_Utxos, us.m_Epoch);
+	if (!r.m_bEntered)
+		return false;
+
+	struct Traveler :public UtxoTree::ITraveler
+	{
+		std::vector<Input::Proof>& m_vRes;
+		const UtxoSnapshot& m_Snapshot;
+		RadixHashTree::Reader& m_Reader;
+		UtxoTreeMapped& m_Utxos;
+		bool m_bAborted = false;
+
+		Traveler(std::vector<Input::Proof>& vRes, const UtxoSnapshot& us, RadixHashTree::Reader& r, UtxoTreeMapped& t)
+			:m_vRes(vRes)
+			,m_Snapshot(us)
+			,m_Reader(r)
+			,m_Utxos(t)
+		{
+		}
+
+		virtual bool OnLeaf(const RadixTree::Leaf& x) override {
+
+			if (!m_Reader.IsValid())
+			{
+				m_bAborted = true; // the owner is waiting for us
+				return false;
+			}
+
+			const UtxoTree::MyLeaf& v = Cast::Up<UtxoTree::MyLeaf>(x);
+			UtxoTree::Key::Data d;
+			d = v.m_Key;
+
+			Input::Proof& ret = m_vRes.emplace_back();
+
+			ret.m_State.m_Count = v.get_Count();
+			ret.m_State.m_Maturity = d.m_Maturity;
+			m_Utxos.get_Proof(ret.m_Proof, *m_pCu);
+
+			ret.m_Proof.insert(ret.m_Proof.end(), m_Snapshot.m_ProofOuter.begin(), m_Snapshot.m_ProofOuter.end());
+
+			return m_vRes.size() < Input::Proof::s_EntriesMax;
+		}
+	};
+
+	Traveler t(vRes, us, r, m_Utxos);
+
+	UtxoTree::Cursor cu;
+	t.m_pCu = &cu;
+
+	// bounds
+	UtxoTree::Key kMin, kMax;
+
+	UtxoTree::Key::Data d;
+	d.m_Commitment = comm;
+	d.m_Maturity = hMaturityMin;
+	kMin = d;
+	d.m_Maturity = Height(-1);
+	kMax = d;
+
+	t.m_pBound[0] = kMin.V.m_pData;
+	t.m_pBound[1] = kMax.V.m_pData;
+
+	m_Utxos.Traverse(t);
+
+	return !t.m_bAborted;
+}
+
 uint64_t NodeProcessor::ProcessKrnMmr(Merkle::Mmr& mmr, std::vector<TxKernel::Ptr>& vKrn, const Merkle::Hash& idKrn, TxKernel::Ptr* ppRes)
 {
 	uint64_t iRet = uint64_t (-1);
@@ -1884,7 +2457,7 @@ uint64_t NodeProcessor::ProcessKrnMmr(Merkle::Mmr& mmr, std::vector<TxKernel::Pt
 
 Height NodeProcessor::get_ProofKernel(Merkle::Proof& proof, TxKernel::Ptr* ppRes, const Merkle::Hash& idKrn)
 {
-	Height h = m_DB.FindKernel(idKrn);
+	Height h = FindKernel(idKrn);
 	if (h < Rules::HeightGenesis)
 		return h;
 
@@ -1910,6 +2483,97 @@ Height NodeProcessor::get_ProofKernel(Merkle::Proof& proof, TxKernel::Ptr* ppRes
 	return h;
 }
 
+void NodeProcessor::get_ProofKernels(proto::ProofKernels& res, const std::vector<Merkle::Hash>& vIDs, bool bFetch)
+{
+	// group by blocks, each one is loaded once
+	std::vector<std::pair<Height, size_t> > vFound;
+
+	for (size_t i = 0; i < vIDs.size(); i++)
+	{
+		Height h = FindKernel(vIDs[i]);
+		if (h >= Rules::HeightGenesis)
+		{
+			res.m_Heights[i] = h;
+			vFound.emplace_back(h, i);
+		}
+	}
+
+	std::sort(vFound.begin(), vFound.end());
+
+	struct MyBuilder
+		:public Merkle::MultiProof::Builder
+	{
+		const Merkle::FixedMmr& m_Mmr;
+
+		MyBuilder(Merkle::MultiProof& x, const Merkle::FixedMmr& mmr)
+			:Merkle::MultiProof::Builder(x)
+			,m_Mmr(mmr)
+		{
+		}
+
+		virtual void get_Proof(Merkle::IProofBuilder& bld, uint64_t i) override
+		{
+			m_Mmr.get_Proof(bld, i);
+		}
+	};
+
+	std::vector<std::pair<uint32_t, size_t> > vBlock;
+
+	for (size_t i0 = 0; i0 < vFound.size(); )
+	{
+		Height h = vFound[i0].first;
+
+		ByteBuffer bbE;
+		m_DB.GetStateBlock(FindActiveAtStrict(h), nullptr, &bbE, nullptr);
+
+		TxVectors::Eternal txve;
+
+		Deserializer der;
+		der.reset(bbE);
+		der & txve;
+
+		std::vector<TxKernel::Ptr>& vKrn = txve.m_vKernels;
+
+		Merkle::FixedMmr mmr;
+		mmr.Resize(vKrn.size());
+		for (size_t j = 0; j < vKrn.size(); j++)
+			mmr.Append(vKrn[j]->m_Internal.m_ID);
+
+		vBlock.clear();
+		for (; (i0 < vFound.size()) && (vFound[i0].first == h); i0++)
+		{
+			size_t iID = vFound[i0].second;
+
+			size_t j = 0;
+			for (; ; j++)
+			{
+				if (vKrn.size() == j)
+					OnCorrupted();
+				if (vKrn[j]->m_Internal.m_ID == vIDs[iID])
+					break;
+			}
+
+			res.m_Indices[iID] = static_cast<uint32_t>(j);
+			if (bFetch)
+				vKrn[j]->Clone(res.m_Kernels[iID]); // the same kernel may be requested more than once
+
+			vBlock.emplace_back(static_cast<uint32_t>(j), iID);
+		}
+
+		std::sort(vBlock.begin(), vBlock.end());
+
+		res.m_Proofs.emplace_back();
+		proto::BlockKernelsProof& bp = res.m_Proofs.back();
+		bp.m_Height = h;
+		bp.m_Count = static_cast<uint32_t>(vKrn.size());
+
+		MyBuilder bld(bp.m_Proof, mmr);
+		for (size_t j = 0; j < vBlock.size(); j++)
+			if (!j || (vBlock[j].first != vBlock[j - 1].first)) // skip duplicates
+				bld.Add(vBlock[j].first);
+	}
+}
+
 struct NodeProcessor::BlockInterpretCtx
 {
 	Height m_Height;
@@ -2108,30 +2772,21 @@ struct NodeProcessor::KrnFlyMmr
 
 bool NodeProcessor::HandleBlock(const NodeDB::StateID& sid, const Block::SystemState::Full& s, MultiblockContext& mbc)
 {
-	ByteBuffer bbP, bbE;
-	m_DB.GetStateBlock(sid.m_Row, &bbP, &bbE, nullptr);
-
-	MultiblockContext::MyTask::SharedBlock::Ptr pShared = std::make_shared<MultiblockContext::MyTask::SharedBlock>(mbc);
+	MultiblockContext::MyTask::SharedBlock::Ptr pShared = mbc.PopDecoded(sid);
 	Block::Body& block = pShared->m_Body;
+	mbc.m_SizeLast = pShared->m_Size;
 
-	try {
-		Deserializer der;
-		der.reset(bbP);
-		der & Cast::Down<Block::BodyBase>(block);
-		der & Cast::Down<TxVectors::Perishable>(block);
-
-		der.reset(bbE);
-		der & Cast::Down<TxVectors::Eternal>(block);
-	}
-	catch (const std::exception&) {
+	if (!pShared->m_bDecodeOk)
+	{
 		LOG_WARNING() << LogSid(m_DB, sid) << " Block deserialization failed";
 		return false;
 	}
 
+	ByteBuffer bbP;
+
 	bool bFirstTime = (m_DB.get_StateTxos(sid.m_Row) == MaxHeight);
 	if (bFirstTime)
 	{
-		pShared->m_Size = bbP.size() + bbE.size();
 		pShared->m_Ctx.m_Height = sid.m_Height;
 
 		PeerID pid;
@@ -2645,7 +3300,7 @@ bool NodeProcessor::IsDummy(const CoinID&  cid)
 
 Height NodeProcessor::FindVisibleKernel(const Merkle::Hash& id, const BlockInterpretCtx& bic)
 {
-	Height h = m_DB.FindKernel(id);
+	Height h = FindKernel(id);
 	if (h >= Rules::HeightGenesis)
 	{
 		assert(h <= bic.m_Height);
@@ -2950,6 +3605,9 @@ bool NodeProcessor::HandleKernel(const TxKernelShieldedOutput& krn, BlockInterpr
 				m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs + 1, m_Extra.m_ShieldedOutputs);
 				// Append to cmList
 				m_DB.ShieldedWrite(m_Extra.m_ShieldedOutputs, &pt_s, 1);
+
+				m_ShieldedImage.Resize(m_Extra.m_ShieldedOutputs + 1);
+				m_ShieldedImage.Write(m_Extra.m_ShieldedOutputs, &pt_s, 1);
 			}
 
 			if (bic.m_UpdateMmrs)
@@ -2981,7 +3639,10 @@ bool NodeProcessor::HandleKernel(const TxKernelShieldedOutput& krn, BlockInterpr
 			m_Mmr.m_Shielded.ShrinkTo(m_Mmr.m_Shielded.m_Count - 1);
 
 		if (bic.m_StoreShieldedOutput)
+		{
 			m_DB.ShieldedResize(m_Extra.m_ShieldedOutputs - 1, m_Extra.m_ShieldedOutputs);
+			m_ShieldedImage.Resize(m_Extra.m_ShieldedOutputs - 1);
+		}
 
 		assert(bic.m_ShieldedOuts);
 		bic.m_ShieldedOuts--;
@@ -3152,6 +3813,8 @@ bool NodeProcessor::HandleValidatedBlock(const Block::Body& block, BlockInterpre
 
 bool NodeProcessor::HandleBlockElement(const Input& v, BlockInterpretCtx& bic)
 {
+	m_Utxos.Unpublish(); // no concurrent readers beyond this point
+
 	UtxoTree::Cursor cu;
 	UtxoTree::MyLeaf* p;
 	UtxoTree::Key::Data d;
@@ -3227,6 +3890,8 @@ bool NodeProcessor::HandleBlockElement(const Input& v, BlockInterpretCtx& bic)
 
 bool NodeProcessor::HandleBlockElement(const Output& v, BlockInterpretCtx& bic)
 {
+	m_Utxos.Unpublish(); // no concurrent readers beyond this point
+
 	UtxoTree::Key::Data d;
 	d.m_Commitment = v.m_Commitment;
 	d.m_Maturity = v.get_MinMaturity(bic.m_Height);
@@ -3299,7 +3964,11 @@ bool NodeProcessor::HandleBlockElement(const TxKernel& v, BlockInterpretCtx& bic
 
 	bool bSaveID = ((bic.m_Height >= Rules::HeightGenesis) && bic.m_SaveKid); // for historical reasons treasury kernels are ignored
 	if (bSaveID && !bic.m_Fwd)
+	{
 		m_DB.DeleteKernel(v.m_Internal.m_ID, bic.m_Height);
+		if (m_KernelIndex.IsOpen())
+			m_KernelIndex.Delete(v.m_Internal.m_ID, bic.m_Height);
+	}
 
 	if (!HandleKernel(v, bic))
 	{
@@ -3309,7 +3978,11 @@ bool NodeProcessor::HandleBlockElement(const TxKernel& v, BlockInterpretCtx& bic
 	}
 
 	if (bSaveID && bic.m_Fwd)
+	{
 		m_DB.InsertKernel(v.m_Internal.m_ID, bic.m_Height);
+		if (m_KernelIndex.IsOpen())
+			m_KernelIndex.Insert(v.m_Internal.m_ID, bic.m_Height);
+	}
 
 	return true;
 }
@@ -3631,6 +4304,7 @@ void NodeProcessor::RollbackTo(Height h)
 
 
 	m_RecentStates.RollbackTo(h);
+	m_DB.BodyCacheCut(h);
 
 	m_Mmr.m_States.ShrinkTo(m_Mmr.m_States.H2I(m_Cursor.m_Sid.m_Height));
 
@@ -4087,6 +4761,13 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 
 	size_t nTxNum = 0;
 
+	TxPool::Fluff::Template& tmpl = bc.m_TxPool.m_Template;
+	tmpl.m_Valid = false; // until the block is fully generated
+	tmpl.m_pLast = nullptr;
+
+	for (TxPool::Fluff::ProfitSet::iterator it = bc.m_TxPool.m_setProfit.begin(); bc.m_TxPool.m_setProfit.end() != it; it++)
+		it->get_ParentObj().m_bInTemplate = false;
+
 	for (TxPool::Fluff::ProfitSet::iterator it = bc.m_TxPool.m_setProfit.begin(); bc.m_TxPool.m_setProfit.end() != it; )
 	{
 		TxPool::Fluff::Element& x = (it++)->get_ParentObj();
@@ -4133,6 +4814,9 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 				ssc.m_Counter.m_Value = nSizeNext;
 				offset += ECC::Scalar::Native(tx.m_Offset);
 				++nTxNum;
+
+				x.m_bInTemplate = true;
+				tmpl.m_pLast = &x;
 			}
 			else
 			{
@@ -4149,6 +4833,8 @@ size_t NodeProcessor::GenerateNewBlockInternal(BlockContext& bc, BlockInterpretC
 
 	LOG_INFO() << "GenerateNewBlock: size of block = " << ssc.m_Counter.m_Value << "; amount of tx = " << nTxNum;
 
+	tmpl.m_nSizeFree = static_cast<uint32_t>(nSizeMax - ssc.m_Counter.m_Value);
+
 	if (BlockContext::Mode::Assemble != bc.m_Mode)
 	{
 		if (bc.m_Fees)
@@ -4192,13 +4878,18 @@ void NodeProcessor::GenerateNewHdr(BlockContext& bc)
 	fmmr.get_Hash(bc.m_Hdr.m_Kernels);
 
 	bc.m_Hdr.m_PoW.m_Difficulty = m_Cursor.m_DifficultyNext;
-	bc.m_Hdr.m_TimeStamp = getTimestamp();
-
 	bc.m_Hdr.m_ChainWork = m_Cursor.m_Full.m_ChainWork + bc.m_Hdr.m_PoW.m_Difficulty;
 
+	UpdateHdrTimestamp(bc.m_Hdr);
+}
+
+void NodeProcessor::UpdateHdrTimestamp(Block::SystemState::Full& s)
+{
+	s.m_TimeStamp = getTimestamp();
+
 	// Adjust the timestamp to be no less than the moving median (otherwise the block'll be invalid)
 	Timestamp tm = get_MovingMedian() + 1;
-	std::setmax(bc.m_Hdr.m_TimeStamp, tm);
+	std::setmax(s.m_TimeStamp, tm);
 }
 
 NodeProcessor::BlockContext::BlockContext(TxPool::Fluff& txp, Key::Index nSubKey, Key::IKdf& coin, Key::IPKdf& tag)
@@ -4243,6 +4934,7 @@ bool NodeProcessor::GenerateNewBlock(BlockContext& bc)
 	if (BlockContext::Mode::Assemble == bc.m_Mode)
 	{
 		bc.m_Hdr.m_Height = bic.m_Height;
+		bc.m_TxPool.m_Template.m_Valid = true;
 		return true;
 	}
 
@@ -4296,7 +4988,13 @@ bool NodeProcessor::GenerateNewBlock(BlockContext& bc)
 		);
 	}
 
-	return nSize <= Rules::get().MaxBodySize;
+	if (nSize > Rules::get().MaxBodySize)
+		return false;
+
+	if (BlockContext::Mode::Finalize != bc.m_Mode)
+		bc.m_TxPool.m_Template.m_Valid = true;
+
+	return true;
 }
 
 Executor& NodeProcessor::get_Executor()
@@ -4633,6 +5331,35 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 	if (!bActive && !(m_DB.GetStateFlags(sid.m_Row) & NodeDB::StateFlags::Active))
 		return false; // only active states are supported
 
+	// Horizon-cut bodies are cached. The spend heights are final only up to the current tip, hence the horizons above it are not cached
+	bool bCache = !pBody && (hHi1 <= m_Cursor.m_ID.m_Height);
+	if (bCache && m_DB.BodyCacheFind(sid.m_Row, h0, hLo1, hHi1, *pPerishable))
+		return true;
+
+	// the range of horizons for which the body would be the same
+	NodeDB::CachedBody cb;
+	if (bCache)
+	{
+		cb.m_Row = sid.m_Row;
+		cb.m_Height = sid.m_Height;
+		cb.m_h0 = h0;
+
+		if (sid.m_Height > hLo1)
+		{
+			// all the inputs are transferred, can't be full block (otherwise it'd be fetched as-is)
+			cb.m_Lo.m_Min = cb.m_Lo.m_Max = hLo1;
+			cb.m_Hi.m_Min = sid.m_Height + 1;
+		}
+		else
+		{
+			cb.m_Lo.m_Min = sid.m_Height;
+			cb.m_Lo.m_Max = m_Cursor.m_ID.m_Height;
+			cb.m_Hi.m_Min = sid.m_Height;
+		}
+
+		cb.m_Hi.m_Max = m_Cursor.m_ID.m_Height;
+	}
+
 	TxoID idInpCut = get_TxosBefore(h0 + 1);
 	TxoID id0;
 
@@ -4720,6 +5447,19 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 		if (wlk.m_ID >= id1)
 			break;
 
+		if (bCache)
+		{
+			if (wlk.m_SpendHeight <= hLo1)
+				std::setmax(cb.m_Lo.m_Min, wlk.m_SpendHeight);
+			else
+				std::setmin(cb.m_Lo.m_Max, wlk.m_SpendHeight - 1);
+
+			if (wlk.m_SpendHeight <= hHi1)
+				std::setmax(cb.m_Hi.m_Min, wlk.m_SpendHeight);
+			else
+				std::setmin(cb.m_Hi.m_Max, wlk.m_SpendHeight - 1);
+		}
+
 		//	if SpendHeight > hHi1 (or null) then fully transfer
 		//	if SpendHeight > hLo1 then transfer naked (remove Confidential, Public, Asset::ID)
 		//	Otherwise - don't transfer
@@ -4759,6 +5499,9 @@ bool NodeProcessor::GetBlockInternal(const NodeDB::StateID& sid, ByteBuffer* pEt
 		ser.swap_buf(*pPerishable);
 
 		ser.swap_buf(*pPerishable);
+
+		if (bCache)
+			m_DB.BodyCacheIns(cb, *pPerishable);
 	}
 
 	return true;
@@ -18,6 +18,7 @@
 #include "../core/proto.h"
 #include "../utility/dvector.h"
 #include "../utility/executor.h"
+#include "../utility/metrics.h"
 #include "db.h"
 #include "txpool.h"
 
@@ -37,6 +38,47 @@ class NodeProcessor
 
 	UtxoTreeMapped m_Utxos;
 
+	// Resident copy of the shielded outputs list (the DB stream is authoritative), used by Lelantus verification.
+	// Maintained and flushed the same way as the UTXO image, rebuilt from the DB on mismatch.
+	class ShieldedImage
+	{
+		MappedFile m_Mapping;
+		MappedFile::Offset m_nData0 = 0;
+
+#pragma pack(push, 1)
+		struct Hdr
+		{
+			Merkle::Hash m_Stamp;
+			uint64_t m_Count;
+			uint8_t m_Dirty;
+		};
+#pragma pack(pop)
+
+		Hdr& get_Hdr() const { return *static_cast<Hdr*>(m_Mapping.get_FixedHdr()); }
+		void OnDirty() { get_Hdr().m_Dirty = 1; }
+
+	public:
+		typedef Merkle::Hash Stamp;
+
+		~ShieldedImage() { Close(); }
+
+		bool Open(const char* sz, const Stamp&, uint64_t nCount); // returns false if was reset
+		bool IsOpen() const { return m_Mapping.get_Base() != nullptr; }
+		void Close() { m_Mapping.Close(); }
+
+		bool IsDirty() const { return IsOpen() && get_Hdr().m_Dirty; }
+		void FlushStrict(const Stamp&);
+
+		uint64_t get_Count() const { return get_Hdr().m_Count; }
+		const ECC::Point::Storage* get_Data() const { return (const ECC::Point::Storage*) (m_Mapping.get_Base() + m_nData0); }
+
+		void Resize(uint64_t nCount); // may remap, pointers are invalidated
+		void Write(uint64_t pos, const ECC::Point::Storage*, uint64_t nCount);
+
+	} m_ShieldedImage;
+
+	NodeDB::KernelIndex m_KernelIndex;
+
 	size_t m_nSizeUtxoComission;
 
 	struct MultiblockContext;
@@ -96,8 +138,6 @@ class NodeProcessor
 	static const uint32_t s_TxoNakedMax = s_TxoNakedMin + 0x10; // In case the output has the Incubation period - extra size is needed (actually less than this).
 
 	static void TxoToNaked(uint8_t* pBuf, Blob&);
-	static bool TxoIsNaked(const Blob&);
-
 	void ToInputWithMaturity(Input&, TxoID);
 
 	TxoID get_TxosBefore(Height);
@@ -105,6 +145,9 @@ class NodeProcessor
 
 	void InitCursor(bool bMovingUp);
 	bool InitUtxoMapping(const char*, bool bForceReset);
+	void InitShieldedImage(const char*);
+	void InitKernelIndex(const char*);
+	Height FindKernel(const Merkle::Hash&);
 	void InitializeUtxos(const char*);
 	static void OnCorrupted();
 
@@ -174,6 +217,7 @@ public:
 	void Initialize(const char* szPath);
 	void Initialize(const char* szPath, const StartParams&);
 
+	static void get_MappingPath(std::string&, const char*, const char* szSufix);
 	static void get_UtxoMappingPath(std::string&, const char*);
 
 	NodeProcessor();
@@ -237,6 +281,31 @@ public:
 
 	bool IsFastSync() const { return m_SyncData.m_Target.m_Row != 0; }
 
+	struct ImportStats
+	{
+		// block import pipeline: decode -> context-free verify -> apply -> commit
+		struct Stage
+		{
+			uint64_t m_Blocks = 0;
+			uint64_t m_Bytes = 0;
+			uint64_t m_Busy_us = 0; // for multi-threaded stages - summed over all the threads
+			metrics::Histogram m_Latency; // per block (for commit - per batch)
+
+			void Add(uint64_t nBytes, uint64_t dt_us);
+		};
+
+		Stage m_Decode;
+		Stage m_Verify;
+		Stage m_Apply;
+		Stage m_Commit;
+
+		uint64_t m_StallDecode_us = 0; // apply waited for the block to be decoded
+		uint64_t m_StallVerify_us = 0; // apply waited for the verification backlog to shrink
+
+	} m_ImportStats;
+
+	void WriteMetrics(metrics::Writer&) const; // import stats and the state. Not during the import (executor threads update the stats)
+
 	void SaveSyncData();
 	void LogSyncData();
 
@@ -262,6 +331,20 @@ public:
 	// use only for data retrieval for peers
 	NodeDB& get_DB() { return m_DB; }
 	UtxoTree& get_Utxos() { return m_Utxos; }
+	void ShieldedRead(TxoID id0, ECC::Point::Storage*, uint64_t nCount); // from the resident image if possible
+
+	// Published image of the current utxo set. Allows building utxo proofs in other threads while the tree is intact.
+	struct UtxoSnapshot
+	{
+		typedef std::shared_ptr<const UtxoSnapshot> Ptr;
+
+		uint64_t m_Epoch;
+		Block::SystemState::ID m_ID;
+		Merkle::Proof m_ProofOuter; // utxo root -> state definition
+	};
+
+	const UtxoSnapshot::Ptr& PublishUtxos(); // for the current state. Invoke in the processor thread only
+	bool get_ProofUtxo(std::vector<Input::Proof>&, const ECC::Point&, Height hMaturityMin, const UtxoSnapshot&); // thread-safe. Fails if the snapshot is gone
 
 	struct Evaluator
 		:public Block::SystemState::Evaluator
@@ -304,6 +387,7 @@ public:
 	};
 
 	Height get_ProofKernel(Merkle::Proof&, TxKernel::Ptr*, const Merkle::Hash& idKrn);
+	void get_ProofKernels(proto::ProofKernels&, const std::vector<Merkle::Hash>& vIDs, bool bFetch); // the result arrays must be already resized
 
 	void CommitDB();
 
@@ -394,6 +478,7 @@ public:
 	};
 
 	bool GenerateNewBlock(BlockContext&);
+	void UpdateHdrTimestamp(Block::SystemState::Full&); // for the header of a generated block
 
 	bool GetBlock(const NodeDB::StateID&, ByteBuffer* pEthernal, ByteBuffer* pPerishable, Height h0, Height hLo1, Height hHi1, bool bActive);
 
@@ -430,6 +515,8 @@ public:
 		virtual bool OnTxo(const NodeDB::WalkerTxo&, Height hCreate) override;
 	};
 
+	static bool TxoIsNaked(const Blob&);
+
 	struct IKrnWalker
 		:public TxKernel::IWalker
 	{
@@ -497,12 +584,23 @@ public:
 	{
 		Mmr(NodeDB&);
 		NodeDB::StatesMmr m_States;
-		NodeDB::StreamMmr m_Shielded;
-		NodeDB::StreamMmr m_Assets;
+		NodeDB::MappedMmr m_Shielded;
+		NodeDB::MappedMmr m_Assets;
 
 	} m_Mmr;
 
 private:
+	struct ImportReport
+	{
+		ImportStats m_Stats;
+		uint64_t m_Time_us = 0;
+	} m_ImportReport;
+
+	void MaybeLogImportStats();
+	void LogImportStats(const ImportStats& prev, uint64_t dt_us);
+
+	UtxoSnapshot::Ptr m_pUtxoSnapshot;
+
 	size_t GenerateNewBlockInternal(BlockContext&, BlockInterpretCtx&);
 	void GenerateNewHdr(BlockContext&);
 	DataStatus::Enum OnStateInternal(const Block::SystemState::Full&, Block::SystemState::ID&, bool bAlreadyChecked);
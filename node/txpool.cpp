@@ -60,6 +60,11 @@ TxPool::Fluff::Element* TxPool::Fluff::AddValidTx(Transaction::Ptr&& pValue, con
 	p->m_Queue.m_Refs = 1;
 	m_Queue.push_back(p->m_Queue);
 
+	if (!m_Template.m_Valid ||
+		(p->m_Profit.m_nSize <= m_Template.m_nSizeFree) ||
+		(m_Template.m_pLast && (p->m_Profit < m_Template.m_pLast->m_Profit)))
+		InvalidateTemplate();
+
 	return p;
 }
 
@@ -72,6 +77,12 @@ void TxPool::Fluff::Delete(Element& x)
 	m_setProfit.erase(ProfitSet::s_iterator_to(x.m_Profit));
 	m_setTxs.erase(TxSet::s_iterator_to(x.m_Tx));
 
+	if (x.m_bInTemplate)
+	{
+		x.m_bInTemplate = false;
+		InvalidateTemplate();
+	}
+
 	Release(x);
 }
 
@@ -86,6 +97,13 @@ void TxPool::Fluff::Release(Element& x)
 	}
 }
 
+void TxPool::Fluff::InvalidateTemplate()
+{
+	m_Template.m_Version++;
+	m_Template.m_pLast = nullptr;
+	m_Template.m_Valid = false;
+}
+
 void TxPool::Fluff::Clear()
 {
 	while (!m_setThreshold.empty())
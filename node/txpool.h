@@ -71,6 +71,8 @@ struct TxPool
 				uint32_t m_Refs = 0;
 				IMPLEMENT_GET_PARENT_OBJ(Element, m_Queue)
 			} m_Queue;
+
+			bool m_bInTemplate = false; // included in the last generated block template
 		};
 
 		typedef boost::intrusive::multiset<Element::Tx> TxSet;
@@ -83,6 +85,20 @@ struct TxPool
 		ThresholdSet m_setThreshold;
 		Queue m_Queue;
 
+		// The last generated block template. The block is assembled greedily in the profit order, hence a pool change can't affect it if:
+		//	- a deleted tx wasn't included
+		//	- an added tx is ordered after the last included one, and doesn't fit the remaining block space
+		// Otherwise the version is incremented, the template should be regenerated.
+		struct Template
+		{
+			uint64_t m_Version = 0;
+			const Element* m_pLast = nullptr; // least profitable included tx
+			uint32_t m_nSizeFree = 0;
+			bool m_Valid = false;
+		} m_Template;
+
+		void InvalidateTemplate();
+
 		Element* AddValidTx(Transaction::Ptr&&, const Transaction::Context&, const Transaction::KeyType&);
 		void Delete(Element&);
 		void Release(Element&);
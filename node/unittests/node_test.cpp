@@ -495,12 +495,6 @@ namespace beam
 		}
 
 		NodeDB::WalkerBbs wlkbbs;
-		wlkbbs.m_Data = dBbs;
-		verify_test(db.BbsFind(wlkbbs));
-
-		wlkbbs.m_Data.m_Key.Inc();
-		verify_test(!db.BbsFind(wlkbbs));
-
 
 		for (wlkbbs.m_Data.m_Channel = 0; wlkbbs.m_Data.m_Channel < 7; wlkbbs.m_Data.m_Channel++)
 		{
@@ -689,6 +683,210 @@ namespace beam
 		const char* g_sz3 = "/tmp/recovery_info";
 #endif // WIN32
 
+	struct RefMmr
+		:public Merkle::FlyMmr
+	{
+		std::vector<Merkle::Hash> m_vHashes;
+
+		virtual void LoadElement(Merkle::Hash& hv, uint64_t n) const override
+		{
+			hv = m_vHashes[n];
+		}
+
+		void Append(const Merkle::Hash& hv)
+		{
+			m_vHashes.push_back(hv);
+			m_Count = m_vHashes.size();
+		}
+
+		void ShrinkTo(uint64_t n)
+		{
+			m_vHashes.resize(n);
+			m_Count = n;
+		}
+
+		void TestEqual(const Merkle::Mmr& mmr) const
+		{
+			verify_test(mmr.m_Count == m_Count);
+
+			Merkle::Hash hv1, hv2;
+			get_Hash(hv1);
+			mmr.get_Hash(hv2);
+			verify_test(hv1 == hv2);
+		}
+	};
+
+	void TestMappedMmr(const char* sz)
+	{
+		std::string sPath, sPath2;
+		NodeProcessor::get_MappingPath(sPath, sz, "-test-mmr.bin");
+		NodeProcessor::get_MappingPath(sPath2, sz, "-test-mmr2.bin");
+
+		RefMmr ref;
+
+		{
+			NodeDB db;
+			db.Open(sz);
+
+			NodeDB::MappedMmr mmr(db, NodeDB::ParamID::ShieldedMmrJournal, NodeDB::StreamType::ShieldedMmr, true);
+			mmr.m_Count = 0;
+			mmr.Open(sPath.c_str());
+
+			NodeDB::Transaction tr(db);
+
+			for (uint32_t i = 0; i < 100; i++)
+			{
+				Merkle::Hash hv = i + 1;
+				mmr.Append(hv);
+				ref.Append(hv);
+			}
+			ref.TestEqual(mmr);
+
+			mmr.SaveJournal();
+			tr.Commit();
+			mmr.FlushJournal();
+
+			// rollback + modification of the committed data
+			tr.Start(db);
+
+			mmr.ShrinkTo(70);
+			ref.ShrinkTo(70);
+
+			for (uint32_t i = 0; i < 20; i++)
+			{
+				Merkle::Hash hv = i + 500;
+				mmr.Append(hv);
+				ref.Append(hv);
+			}
+
+			ref.m_vHashes[5] = 777U;
+			mmr.Replace(5, ref.m_vHashes[5]);
+			ref.TestEqual(mmr);
+
+			// commit, but don't flush the image (simulate crash)
+			mmr.SaveJournal();
+			tr.Commit();
+		}
+
+		{
+			NodeDB db;
+			db.Open(sz);
+
+			NodeDB::MappedMmr mmr(db, NodeDB::ParamID::ShieldedMmrJournal, NodeDB::StreamType::ShieldedMmr, true);
+			mmr.m_Count = ref.m_Count;
+			mmr.Open(sPath.c_str()); // should replay the journal
+			ref.TestEqual(mmr);
+
+			// uncommitted changes must not affect the image
+			NodeDB::Transaction tr(db);
+			mmr.ShrinkTo(10);
+			mmr.Append(Merkle::Hash(Zero));
+			mmr.SaveJournal();
+			tr.Rollback();
+		}
+
+		{
+			NodeDB db;
+			db.Open(sz);
+
+			NodeDB::MappedMmr mmr(db, NodeDB::ParamID::ShieldedMmrJournal, NodeDB::StreamType::ShieldedMmr, true);
+			mmr.m_Count = ref.m_Count;
+			mmr.Open(sPath.c_str());
+			ref.TestEqual(mmr);
+
+			// migration from the stream
+			NodeDB::Transaction tr(db);
+
+			NodeDB::StreamMmr smmr(db, NodeDB::StreamType::AssetsMmr, true);
+			for (uint32_t i = 0; i < 30; i++)
+				smmr.Append(Merkle::Hash(i + 1000));
+
+			NodeDB::MappedMmr mmr2(db, NodeDB::ParamID::AssetsMmrJournal, NodeDB::StreamType::AssetsMmr, true);
+			mmr2.m_Count = smmr.m_Count;
+			mmr2.Open(sPath2.c_str());
+
+			Merkle::Hash hv1, hv2;
+			smmr.get_Hash(hv1);
+			mmr2.get_Hash(hv2);
+			verify_test(hv1 == hv2);
+
+			tr.Commit();
+		}
+
+		DeleteFile(sPath.c_str());
+		DeleteFile(sPath2.c_str());
+	}
+
+	void TestKernelIndex(const char* sz)
+	{
+		std::string sPath;
+		NodeProcessor::get_MappingPath(sPath, sz, "-test-kernels.bin");
+		DeleteFile(sPath.c_str());
+
+		// enough to grow the table several times
+		const uint32_t nKrns = 300000;
+		std::vector<Merkle::Hash> vIDs(nKrns);
+
+		for (uint32_t i = 0; i < nKrns; i++)
+			ECC::Hash::Processor() << i >> vIDs[i];
+
+		NodeDB::KernelIndex::Stamp st;
+		ECC::GenRandom(st);
+
+		{
+			NodeDB::KernelIndex ki;
+			verify_test(!ki.Open(sPath.c_str(), st));
+			verify_test(!ki.Find(vIDs[0]));
+
+			for (uint32_t i = 0; i < nKrns; i++)
+				ki.Insert(vIDs[i], i + 10);
+
+			// duplicates
+			ki.Insert(vIDs[5], 3);
+			ki.Insert(vIDs[6], 1000000);
+			verify_test(ki.get_Count() == nKrns + 2);
+
+			verify_test(ki.Find(vIDs[5]) == 15);
+			verify_test(ki.Find(vIDs[6]) == 1000000);
+
+			ki.Delete(vIDs[6], 1000000);
+			verify_test(ki.Find(vIDs[6]) == 16);
+			ki.Delete(vIDs[5], 15);
+			verify_test(ki.Find(vIDs[5]) == 3);
+			ki.Insert(vIDs[5], 15);
+
+			// delete every 3rd, the rest must survive the cluster shifts
+			for (uint32_t i = 0; i < nKrns; i += 3)
+				ki.Delete(vIDs[i], i + 10);
+
+			verify_test(ki.IsDirty());
+			ki.FlushStrict(st);
+			verify_test(!ki.IsDirty());
+		}
+
+		{
+			NodeDB::KernelIndex ki;
+			verify_test(ki.Open(sPath.c_str(), st)); // should be reused
+
+			for (uint32_t i = 0; i < nKrns; i++)
+				verify_test(ki.Find(vIDs[i]) == ((i % 3) ? (i + 10) : 0));
+
+			Merkle::Hash hv(Zero);
+			verify_test(!ki.Find(hv));
+
+			// modified, but not flushed (simulate crash)
+			ki.Insert(hv, 5);
+		}
+
+		{
+			NodeDB::KernelIndex ki;
+			verify_test(!ki.Open(sPath.c_str(), st)); // dirty
+			verify_test(!ki.get_Count());
+		}
+
+		DeleteFile(sPath.c_str());
+	}
+
 	void TestNodeDB()
 	{
 		TestNodeDB(g_sz); // will create
@@ -697,6 +895,185 @@ namespace beam
 			NodeDB db;
 			db.Open(g_sz); // test to open already-existing DB
 		}
+
+		DeleteFile(g_sz);
+		TestMappedMmr(g_sz);
+		TestKernelIndex(g_sz);
+	}
+
+	void DeleteNodeFiles(const char* sz)
+	{
+		DeleteFile(sz);
+		BbsStore::Delete(std::string(sz) + ".bbs");
+	}
+
+	void TestBbsStore()
+	{
+		std::string sDir = std::string(g_sz) + ".bbs";
+		BbsStore::Delete(sDir);
+
+		const uint32_t nMsgs = 200;
+		const Timestamp t0 = BbsStore::s_SegmentDuration_s * 1000;
+		const Timestamp dt = BbsStore::s_SegmentDuration_s / 50; // 4 segments
+
+		std::vector<NodeDB::WalkerBbs::Data> vData(nMsgs);
+		std::vector<ByteBuffer> vMsgs(nMsgs);
+
+		for (uint32_t i = 0; i < nMsgs; i++)
+		{
+			NodeDB::WalkerBbs::Data& d = vData[i];
+			d.m_Key = i + 1; // all the keys share the leading bytes (the in-memory tag), so that they're told apart on disk
+			d.m_Channel = i % 7;
+			d.m_TimePosted = t0 + i * dt;
+			d.m_Nonce = i * 3;
+
+			vMsgs[i].resize(i % 11);
+			for (size_t j = 0; j < vMsgs[i].size(); j++)
+				vMsgs[i][j] = static_cast<uint8_t>(i + j);
+
+			d.m_Message = Blob(vMsgs[i]);
+		}
+
+		struct Verifier
+		{
+			const std::vector<NodeDB::WalkerBbs::Data>& m_vData;
+			Verifier(const std::vector<NodeDB::WalkerBbs::Data>& v) :m_vData(v) {}
+
+			void TestMsg(const NodeDB::WalkerBbs::Data& d, uint64_t id)
+			{
+				verify_test(id && (id <= m_vData.size()));
+				const NodeDB::WalkerBbs::Data& d0 = m_vData[id - 1];
+
+				verify_test(d.m_Key == d0.m_Key);
+				verify_test(d.m_Channel == d0.m_Channel);
+				verify_test(d.m_TimePosted == d0.m_TimePosted);
+				verify_test(d.m_Nonce == d0.m_Nonce);
+				verify_test(d.m_Message.n == d0.m_Message.n);
+				verify_test(!memcmp(d.m_Message.p, d0.m_Message.p, d.m_Message.n));
+			}
+
+			void TestAll(BbsStore& store, uint32_t iFirst)
+			{
+				verify_test(store.get_Totals().m_Count == m_vData.size() - iFirst);
+
+				for (uint32_t i = 0; i < m_vData.size(); i++)
+				{
+					uint64_t id = store.Find(m_vData[i].m_Key);
+					verify_test(id == ((i >= iFirst) ? (i + 1) : 0));
+
+					if (id)
+					{
+						NodeDB::WalkerBbs::Data d;
+						ByteBuffer buf;
+						verify_test(store.Find(id, d, buf));
+						TestMsg(d, id);
+					}
+				}
+
+				uint32_t nCount = 0;
+				for (BbsChannel ch = 0; ch < 7; ch++)
+				{
+					BbsStore::WalkerChannel wlk;
+					wlk.m_Data.m_Channel = ch;
+					wlk.m_ID = 0;
+
+					uint64_t idPrev = 0;
+					for (store.EnumChannel(wlk); wlk.MoveNext(); nCount++)
+					{
+						verify_test(wlk.m_ID > idPrev);
+						idPrev = wlk.m_ID;
+						verify_test(wlk.m_Data.m_Channel == ch);
+						TestMsg(wlk.m_Data, wlk.m_ID);
+					}
+				}
+				verify_test(nCount == m_vData.size() - iFirst);
+
+				BbsStore::WalkerLite wlk;
+				wlk.m_ID = 0;
+				nCount = 0;
+				for (store.EnumAll(wlk); wlk.MoveNext(); nCount++)
+					verify_test(wlk.m_Key == m_vData[wlk.m_ID - 1].m_Key);
+				verify_test(nCount == m_vData.size() - iFirst);
+			}
+
+		} v(vData);
+
+		{
+			BbsStore store;
+			store.Open(sDir);
+			verify_test(!store.get_Totals().m_Count);
+
+			for (uint32_t i = 0; i < nMsgs; i++)
+				verify_test(store.Ins(vData[i]) == i + 1);
+
+			v.TestAll(store, 0);
+			verify_test(store.get_MaxTime() == vData.back().m_TimePosted);
+			verify_test(store.FindCursor(0) == 1);
+			verify_test(store.FindCursor(vData[77].m_TimePosted) == 78);
+			verify_test(store.FindCursor(vData.back().m_TimePosted + 1) == nMsgs + 1);
+		}
+
+		{
+			// reopen, append a partially written record (as if crashed), make sure it's ignored
+			std::string sPath = sDir + "/000003e8.bbs"; // the 1st segment
+			FILE* pF = fopen(sPath.c_str(), "ab");
+			verify_test(pF);
+			fwrite("garbage", 1, 7, pF);
+			fclose(pF);
+
+			BbsStore store;
+			store.Open(sDir);
+			v.TestAll(store, 0);
+
+			// drop the 1st segment
+			store.DeleteOlder(t0 + BbsStore::s_SegmentDuration_s);
+			v.TestAll(store, 50);
+
+			verify_test(store.FindCursor(0) == 51);
+			verify_test(store.FindCursor(vData[120].m_TimePosted) == 121);
+
+			verify_test(store.DeleteOldest());
+			v.TestAll(store, 100);
+		}
+
+		{
+			BbsStore store;
+			store.Open(sDir);
+			v.TestAll(store, 100);
+			verify_test(store.get_LastID() == nMsgs);
+
+			while (store.DeleteOldest())
+				;
+			verify_test(!store.get_Totals().m_Count);
+		}
+
+		{
+			// reads and appends interleaved on the same segment files
+			BbsStore store;
+			store.Open(sDir);
+
+			for (uint32_t i = 0; i < nMsgs; i++)
+			{
+				verify_test(store.Ins(vData[i]) == i + 1);
+				verify_test(store.Find(vData[i].m_Key) == i + 1);
+
+				NodeDB::WalkerBbs::Data d;
+				ByteBuffer buf;
+				verify_test(store.Find(i / 2 + 1, d, buf));
+				v.TestMsg(d, i / 2 + 1);
+			}
+
+			v.TestAll(store, 0);
+		}
+
+		{
+			// the records must stay aligned
+			BbsStore store;
+			store.Open(sDir);
+			v.TestAll(store, 0);
+		}
+
+		BbsStore::Delete(sDir);
 	}
 
 	struct MiniWallet
@@ -963,6 +1340,18 @@ namespace beam
 			NodeProcessor::BlockContext bc(np.m_TxPool, 0, *np.m_Wallet.m_pKdf, *np.m_Wallet.m_pKdf);
 			verify_test(np.GenerateNewBlock(bc));
 
+			// the template is tracked, all the included txs are marked
+			const TxPool::Fluff::Template& tmpl = np.m_TxPool.m_Template;
+			verify_test(tmpl.m_Valid);
+
+			size_t nInTemplate = 0;
+			for (TxPool::Fluff::ProfitSet::iterator it = np.m_TxPool.m_setProfit.begin(); np.m_TxPool.m_setProfit.end() != it; it++)
+				if (it->get_ParentObj().m_bInTemplate)
+					nInTemplate++;
+
+			verify_test(!nInTemplate == !tmpl.m_pLast);
+			verify_test(bc.m_Block.m_vKernels.size() >= nInTemplate + 1); // + coinbase
+
 			np.OnState(bc.m_Hdr, PeerID());
 
 			Block::SystemState::ID id;
@@ -1233,6 +1622,11 @@ namespace beam
 			ByteBuffer bbE, bbP;
 			verify_test(npSrc.GetBlock(sid, &bbE, &bbP, 0, np.m_SyncData.m_TxoLo, np.m_SyncData.m_Target.m_Height, true));
 
+			// horizon-cut bodies are cached now, must be the same
+			ByteBuffer bbP2;
+			verify_test(npSrc.GetBlock(sid, nullptr, &bbP2, 0, np.m_SyncData.m_TxoLo, np.m_SyncData.m_Target.m_Height, true));
+			verify_test(bbP == bbP2);
+
 			if (!bTampered)
 			{
 				Deserializer der;
@@ -1441,6 +1835,9 @@ namespace beam
 		node.m_Cfg.m_Timeout.m_GetBlock_ms = 1000 * 60;
 		node.m_Cfg.m_Timeout.m_GetState_ms = 1000 * 60;
 
+		node.m_Cfg.m_Recovery.m_sPathOutput = g_sz3;
+		node.m_Cfg.m_Recovery.m_Granularity = 50;
+
 		node2.m_Cfg.m_sPathLocal = g_sz2;
 		node2.m_Cfg.m_Listen.port(g_Port + 1);
 		node2.m_Cfg.m_Listen.ip(INADDR_ANY);
@@ -1576,6 +1973,24 @@ namespace beam
 		verify_test(parser.Proceed(g_sz3));
 
 		DeleteFile(g_sz3);
+
+		// the recovery generated by the node in the background
+		NodeDB::StateID sid;
+		sid.m_Height = node.get_Processor().get_DB().ParamIntGetDef(NodeDB::ParamID::LastRecoveryHeight);
+		verify_test(sid.m_Height);
+		sid.m_Row = node.get_Processor().FindActiveAtStrict(sid.m_Height);
+
+		Block::SystemState::ID id;
+		node.get_Processor().get_DB().get_StateID(sid, id);
+
+		std::ostringstream os;
+		os << g_sz3 << id;
+		std::string sPath = os.str();
+
+		parser.m_nUnrecognized = 0;
+		verify_test(parser.Proceed(sPath.c_str()));
+
+		DeleteFile(sPath.c_str());
 	}
 
 
@@ -2654,6 +3069,77 @@ namespace beam
 
 		verify_test((p.m_SpendKeys.size() == 1) && (p.m_Spent == 1) && p.m_Utxos && p.m_Assets);
 
+		// same for several owners at once, recognized in parallel
+		struct MyParserMulti
+			:public beam::RecoveryInfo::IRecognizerMulti
+		{
+			uint32_t m_pUtxos[2] = { 0, 0 };
+			uint32_t m_Spent = 0;
+			uint32_t m_pAssets[2] = { 0, 0 };
+			MyParser::PkSet m_SpendKeys;
+
+			virtual bool OnUtxoRecognized(uint32_t iOwner, Height, const Output&, CoinID&) override
+			{
+				m_pUtxos[iOwner]++;
+				return true;
+			}
+
+			virtual bool OnShieldedOutRecognized(uint32_t iOwner, const ShieldedTxo::DescriptionOutp& dout, const ShieldedTxo::DataParams& pars) override
+			{
+				verify_test(!iOwner);
+				m_SpendKeys.insert(pars.m_Serial.m_SpendPk);
+				return true;
+			}
+
+			virtual bool OnShieldedInOrdered(const ShieldedTxo::DescriptionInp& din) override
+			{
+				if (m_SpendKeys.end() != m_SpendKeys.find(din.m_SpendPk))
+					m_Spent++;
+				return true;
+			}
+
+			virtual bool OnAssetRecognized(uint32_t iOwner, Asset::Full&) override
+			{
+				m_pAssets[iOwner]++;
+				return true;
+			}
+		};
+
+		struct MyExecutor
+			:public ExecutorMT
+		{
+			virtual uint32_t get_Threads() override { return 4; }
+
+			virtual void RunThread(uint32_t iThread) override
+			{
+				ExecutorMT::Context ctx;
+				ctx.m_iThread = iThread;
+				RunThreadCtx(ctx);
+			}
+
+			~MyExecutor() { Stop(); }
+
+		} ex;
+
+		{
+			Executor::Scope scope(ex);
+
+			MyParserMulti pm;
+			pm.m_ChunkSize = 16;
+			pm.m_vOwners.resize(2);
+			pm.m_vOwners[0].m_pOwner = p.m_pOwner;
+			pm.m_vOwners[0].m_pViewer = &viewer;
+
+			Key::IKdf::Ptr pKdfOther; // owns nothing
+			ECC::SetRandom(pKdfOther);
+			pm.m_vOwners[1].m_pOwner = pKdfOther;
+
+			verify_test(pm.Proceed(beam::g_sz3));
+
+			verify_test((pm.m_pUtxos[0] == p.m_Utxos) && !pm.m_pUtxos[1] && !pm.m_pAssets[1]);
+			verify_test((pm.m_SpendKeys == p.m_SpendKeys) && (pm.m_Spent == p.m_Spent) && (pm.m_pAssets[0] == p.m_Assets));
+		}
+
 		auto logger = beam::Logger::create(LOG_LEVEL_DEBUG, LOG_LEVEL_DEBUG);
 		node.PrintTxos();
 	}
@@ -2722,6 +3208,90 @@ namespace beam
 		}
 	}
 
+	uint64_t get_Metric(Node& node, const char* szName, const char* szKind)
+	{
+		std::ostringstream os;
+		node.WriteMetrics(os);
+
+		std::string sPrefix = std::string(szName) + "{kind=\"" + szKind + "\"} ";
+		std::string s = os.str();
+
+		size_t nPos = s.find(sPrefix);
+		verify_test(std::string::npos != nPos);
+		return std::stoull(s.substr(nPos + sPrefix.size()));
+	}
+
+	uint64_t get_MinerTemplates(Node& node, bool bReused)
+	{
+		return get_Metric(node, "beam_miner_templates_total", bReused ? "reused" : "generated");
+	}
+
+	void TestMinerTemplate()
+	{
+		io::Reactor::Ptr pReactor(io::Reactor::create());
+		io::Reactor::Scope scope(*pReactor);
+
+		Node node;
+		node.m_Cfg.m_sPathLocal = g_sz;
+		node.m_Cfg.m_MiningThreads = 1;
+		node.m_Cfg.m_TestMode.m_FakePowSolveTime_ms = 3600 * 1000; // not mined during the test
+		node.m_Cfg.m_Treasury = g_Treasury;
+
+		ECC::SetRandom(node);
+
+		node.Initialize();
+
+		verify_test(node.RestartMining());
+		uint64_t nGenerated = get_MinerTemplates(node, false);
+		uint64_t nReused = get_MinerTemplates(node, true);
+		verify_test(nGenerated);
+
+		// nothing changed
+		verify_test(node.RestartMining());
+		verify_test(get_MinerTemplates(node, false) == nGenerated);
+		verify_test(get_MinerTemplates(node, true) == ++nReused);
+
+		// add a tx, it fits the block
+		MiniWallet wallet;
+		ECC::SetRandom(wallet.m_pKdf);
+
+		Height h = node.get_Processor().m_Cursor.m_ID.m_Height;
+
+		Transaction::Ptr pTx = std::make_shared<Transaction>();
+		pTx->m_Offset = Zero;
+		wallet.MakeTxKernel(*pTx, 0, h);
+		pTx->Normalize();
+
+		Transaction::Context::Params pars;
+		Transaction::Context ctx(pars);
+		ctx.m_Height = h + 1;
+		verify_test(pTx->IsValid(ctx));
+
+		Transaction::KeyType key;
+		pTx->get_Key(key);
+
+		TxPool::Fluff& txp = node.get_TxPool();
+		TxPool::Fluff::Element* pElem = txp.AddValidTx(std::move(pTx), ctx, key);
+		verify_test(!txp.m_Template.m_Valid);
+
+		verify_test(node.RestartMining());
+		verify_test(get_MinerTemplates(node, false) == ++nGenerated);
+		verify_test(get_MinerTemplates(node, true) == nReused);
+		verify_test(pElem->m_bInTemplate);
+
+		verify_test(node.RestartMining());
+		verify_test(get_MinerTemplates(node, false) == nGenerated);
+		verify_test(get_MinerTemplates(node, true) == ++nReused);
+
+		// remove the included tx
+		txp.Delete(*pElem);
+		verify_test(!txp.m_Template.m_Valid);
+
+		verify_test(node.RestartMining());
+		verify_test(get_MinerTemplates(node, false) == ++nGenerated);
+		verify_test(get_MinerTemplates(node, true) == nReused);
+	}
+
 	void TestFlyClient()
 	{
 		io::Reactor::Ptr pReactor(io::Reactor::create());
@@ -2907,6 +3477,279 @@ namespace beam
 		verify_test(fc.m_bTip);
 		verify_test(fc.m_hRolledTo <= hBranch); // must rollback beyond the manually appended state
 		verify_test(!fc.m_Hist.m_Map.empty() && fc.m_Hist.m_Map.rbegin()->second.m_Height == hThrd2);
+
+		{
+			// several clients over a shared network
+			proto::FlyClient::NetworkShared::Ptr pNet = std::make_shared<proto::FlyClient::NetworkShared>();
+
+			io::Address addr;
+			addr.resolve("127.0.0.1");
+			addr.port(g_Port);
+			pNet->m_Net.m_Cfg.m_vNodes.push_back(addr);
+			pNet->m_Net.Connect();
+
+			MyFlyClient pFc[2];
+			// diverged within the rollback window
+			const Height hBranch2 = hThrd2 - 3;
+			pFc[1].m_Hist = fc.m_Hist;
+			pFc[1].m_Hist.DeleteFrom(hBranch2 + 1);
+			s1.m_Height = hBranch2 + 2;
+			pFc[1].m_Hist.m_Map[s1.m_Height] = s1;
+
+			const BbsChannel nChannel = 177;
+			std::unique_ptr<proto::FlyClient::NetworkShared::Endpoint> pEp[_countof(pFc)];
+
+			for (size_t i = 0; i < _countof(pFc); i++)
+			{
+				MyFlyClient& c = pFc[i];
+				c.m_bTip = false;
+				c.m_hRolledTo = MaxHeight;
+				c.m_nProofsExpected = 1;
+				c.m_bBbsReceived = false;
+				c.m_bRunning = true;
+
+				pEp[i].reset(new proto::FlyClient::NetworkShared::Endpoint(pNet, c));
+				pEp[i]->Connect();
+
+				proto::FlyClient::RequestKernel::Ptr pKrnl(new proto::FlyClient::RequestKernel);
+				pEp[i]->PostRequest(*pKrnl, c);
+
+				pEp[i]->BbsSubscribe(nChannel, 0, &c);
+			}
+
+			proto::FlyClient::RequestBbsMsg::Ptr pBbs(new proto::FlyClient::RequestBbsMsg);
+			pBbs->m_Msg.m_Channel = nChannel;
+			pBbs->m_Msg.m_TimePosted = getTimestamp();
+			pEp[0]->PostRequest(*pBbs, pFc[0]);
+			pFc[0].m_nProofsExpected++;
+
+			for (uint32_t i = 0; (i < _countof(pFc)) && (pFc[0].m_bRunning || pFc[1].m_bRunning); i++)
+			{
+				pFc[0].SetTimer(90 * 1000);
+				io::Reactor::get_Current().run();
+				pFc[0].KillTimer();
+			}
+
+			for (size_t i = 0; i < _countof(pFc); i++)
+			{
+				MyFlyClient& c = pFc[i];
+				verify_test(!c.m_bRunning);
+				verify_test(!c.m_Hist.m_Map.empty() && c.m_Hist.m_Map.rbegin()->second.m_Height == hThrd2);
+			}
+
+			verify_test(pFc[0].m_hRolledTo == MaxHeight);
+			verify_test(pFc[1].m_hRolledTo <= hBranch2);
+
+			// late client is synchronized immediately, without the network roundtrip
+			MyFlyClient fc2;
+			fc2.m_bTip = false;
+			fc2.m_bRunning = false;
+			proto::FlyClient::NetworkShared::Endpoint ep(pNet, fc2);
+			ep.Connect();
+			verify_test(fc2.m_bTip);
+			verify_test(!fc2.m_Hist.m_Map.empty() && fc2.m_Hist.m_Map.rbegin()->second.m_Height == hThrd2);
+
+			// bbs msgs posted out of time order (within MaxAhead) are all delivered. Each subscriber gets the stored msgs once
+			struct MyBbs
+				:public proto::FlyClient::IBbsReceiver
+				,public proto::FlyClient::Request::IHandler
+			{
+				std::vector<Timestamp> m_vTimes;
+				uint32_t m_nExpected = 0;
+
+				virtual void OnMsg(proto::BbsMsg&& msg) override
+				{
+					m_vTimes.push_back(msg.m_TimePosted);
+					if (m_vTimes.size() == m_nExpected)
+						io::Reactor::get_Current().stop();
+				}
+
+				virtual void OnComplete(proto::FlyClient::Request&) override {}
+			} pBbsRcv[2];
+
+			const BbsChannel nChannel2 = nChannel + 1;
+			const Timestamp t0 = getTimestamp();
+
+			std::vector<proto::FlyClient::RequestBbsMsg::Ptr> vBbs2;
+			auto fnPost = [&](Timestamp t)
+			{
+				vBbs2.emplace_back(new proto::FlyClient::RequestBbsMsg);
+				proto::FlyClient::RequestBbsMsg& r = *vBbs2.back();
+				r.m_Msg.m_Channel = nChannel2;
+				r.m_Msg.m_TimePosted = t;
+				r.m_Msg.m_Message.push_back(static_cast<uint8_t>(vBbs2.size()));
+				pEp[0]->PostRequest(r, pBbsRcv[0]);
+			};
+
+			auto fnRun = [&]()
+			{
+				pFc[0].SetTimer(90 * 1000);
+				io::Reactor::get_Current().run();
+				pFc[0].KillTimer();
+			};
+
+			pEp[0]->BbsSubscribe(nChannel2, t0 - 120, pBbsRcv);
+			pBbsRcv[0].m_nExpected = 2;
+
+			fnPost(t0);
+			fnPost(t0 - 60); // older
+			fnRun();
+
+			verify_test(pBbsRcv[0].m_vTimes.size() == 2);
+			verify_test(pBbsRcv[0].m_vTimes[0] == t0);
+			verify_test(pBbsRcv[0].m_vTimes[1] == t0 - 60);
+
+			// joins the channel from a later time, the stored msgs are replayed for it only
+			pEp[1]->BbsSubscribe(nChannel2, t0 - 60, pBbsRcv + 1);
+			pBbsRcv[1].m_nExpected = 2;
+			fnRun();
+
+			verify_test(pBbsRcv[1].m_vTimes.size() == 2);
+			verify_test(pBbsRcv[0].m_vTimes.size() == 2);
+
+			// delivered to the 1st only
+			pBbsRcv[0].m_nExpected = 3;
+			fnPost(t0 - 90);
+			fnRun();
+
+			verify_test(pBbsRcv[0].m_vTimes.size() == 3);
+			verify_test(pBbsRcv[1].m_vTimes.size() == 2);
+
+			// the 2nd moves its start time earlier. It's a fresh join, everything is replayed for it, including the msg the 1st got since
+			pEp[1]->BbsSubscribe(nChannel2, t0 - 120, pBbsRcv + 1);
+			pBbsRcv[1].m_nExpected = 5;
+			fnRun();
+
+			verify_test(pBbsRcv[1].m_vTimes.size() == 5);
+			verify_test(pBbsRcv[1].m_vTimes.back() == t0 - 90);
+			verify_test(pBbsRcv[0].m_vTimes.size() == 3);
+
+			for (size_t i = 0; i < vBbs2.size(); i++)
+				vBbs2[i]->m_pTrg = nullptr;
+			for (uint32_t i = 0; i < _countof(pBbsRcv); i++)
+				pEp[i]->BbsSubscribe(nChannel2, 0, nullptr);
+		}
+
+		{
+			// batched proofs. The requests posted at once are coalesced
+			struct MyHandler :public proto::FlyClient::Request::IHandler
+			{
+				uint32_t m_nPending = 0;
+
+				virtual void OnComplete(proto::FlyClient::Request&) override
+				{
+					verify_test(m_nPending);
+					if (!--m_nPending)
+						io::Reactor::get_Current().stop();
+				}
+			} h;
+
+			fc.m_bRunning = false;
+			proto::FlyClient::NetworkStd net(fc);
+
+			io::Address addr;
+			addr.resolve("127.0.0.1");
+			addr.port(g_Port);
+			net.m_Cfg.m_vNodes.push_back(addr);
+			net.Connect();
+
+			std::vector<std::pair<proto::FlyClient::RequestKernel2::Ptr, Height> > vKrn;
+
+			NodeDB::WalkerKernel wlk;
+			for (node.get_Processor().get_DB().EnumKernels(wlk); wlk.MoveNext(); )
+			{
+				if (wlk.m_Height + 10 < hThrd2)
+					continue; // recent blocks, their headers are likely to be in the client history, then the proofs are verified
+
+				vKrn.emplace_back(new proto::FlyClient::RequestKernel2, wlk.m_Height);
+				vKrn.back().first->m_Msg.m_ID = Merkle::Hash(wlk.m_ID);
+			}
+
+			verify_test(vKrn.size() > 10);
+
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				// not found
+				vKrn.emplace_back(new proto::FlyClient::RequestKernel2, 0);
+				ECC::GenRandom(vKrn.back().first->m_Msg.m_ID);
+			}
+
+			// duplicate
+			vKrn.emplace_back(new proto::FlyClient::RequestKernel2, vKrn.front().second);
+			vKrn.back().first->m_Msg.m_ID = vKrn.front().first->m_Msg.m_ID;
+
+			for (size_t i = 0; i < vKrn.size(); i++)
+			{
+				proto::FlyClient::RequestKernel2& r = *vKrn[i].first;
+				r.m_Msg.m_Fetch = (i < vKrn.size() / 2); // would be split into 2 batches
+				net.PostRequest(r, h);
+				h.m_nPending++;
+			}
+
+			std::vector<proto::FlyClient::RequestUtxo::Ptr> vUtxo;
+			for (uint32_t i = 0; i < 5; i++)
+			{
+				vUtxo.emplace_back(new proto::FlyClient::RequestUtxo);
+				vUtxo.back()->m_Msg.m_Utxo.m_X = vKrn[i].first->m_Msg.m_ID; // no such utxos, the proofs would be empty
+				vUtxo.back()->m_Msg.m_Utxo.m_Y = 0;
+				net.PostRequest(*vUtxo.back(), h);
+				h.m_nPending++;
+			}
+
+			fc.SetTimer(90 * 1000);
+			io::Reactor::get_Current().run();
+			fc.KillTimer();
+
+			verify_test(!h.m_nPending);
+
+			for (size_t i = 0; i < vKrn.size(); i++)
+			{
+				const proto::FlyClient::RequestKernel2& r = *vKrn[i].first;
+				verify_test(r.m_Res.m_Height == vKrn[i].second);
+				if (r.m_Msg.m_Fetch && vKrn[i].second)
+					verify_test(r.m_Res.m_Kernel && (r.m_Res.m_Kernel->m_Internal.m_ID == r.m_Msg.m_ID));
+				else
+					verify_test(!r.m_Res.m_Kernel);
+			}
+
+			for (size_t i = 0; i < vUtxo.size(); i++)
+				verify_test(vUtxo[i]->m_Res.m_Proofs.empty());
+
+			// the connection is synced now. The requests posted within the same reactor turn still go in batches
+			uint64_t nBatchesKrn = get_Metric(node, "beam_proof_batches_total", "kernels");
+			uint64_t nBatchesUtxo = get_Metric(node, "beam_proof_batches_total", "utxos");
+
+			std::vector<proto::FlyClient::RequestKernel2::Ptr> vKrn2;
+			for (uint32_t i = 0; i < 5; i++)
+			{
+				vKrn2.emplace_back(new proto::FlyClient::RequestKernel2);
+				vKrn2.back()->m_Msg.m_ID = vKrn[i].first->m_Msg.m_ID;
+				net.PostRequest(*vKrn2.back(), h);
+				h.m_nPending++;
+			}
+
+			vUtxo.clear();
+			for (uint32_t i = 0; i < 5; i++)
+			{
+				vUtxo.emplace_back(new proto::FlyClient::RequestUtxo);
+				vUtxo.back()->m_Msg.m_Utxo.m_X = vKrn[i].first->m_Msg.m_ID;
+				vUtxo.back()->m_Msg.m_Utxo.m_Y = 0;
+				net.PostRequest(*vUtxo.back(), h);
+				h.m_nPending++;
+			}
+
+			fc.SetTimer(90 * 1000);
+			io::Reactor::get_Current().run();
+			fc.KillTimer();
+
+			verify_test(!h.m_nPending);
+
+			for (size_t i = 0; i < vKrn2.size(); i++)
+				verify_test(vKrn2[i]->m_Res.m_Height == vKrn[i].second);
+
+			verify_test(get_Metric(node, "beam_proof_batches_total", "kernels") == nBatchesKrn + 1);
+			verify_test(get_Metric(node, "beam_proof_batches_total", "utxos") == nBatchesUtxo + 1);
+		}
 	}
 
 	void TestHalving()
@@ -2971,8 +3814,8 @@ void TestAll()
 	//	ports, wrong beacon and etc.
 	verify_test(beam::helpers::ProcessWideLock("/tmp/BEAM_node_test_lock"));
 
-	beam::DeleteFile(beam::g_sz);
-	beam::DeleteFile(beam::g_sz2);
+	beam::DeleteNodeFiles(beam::g_sz);
+	beam::DeleteNodeFiles(beam::g_sz2);
 
 	if (!bClientProtoOnly)
 	{
@@ -2980,7 +3823,9 @@ void TestAll()
 		fflush(stdout);
 
 		beam::TestNodeDB();
-		beam::DeleteFile(beam::g_sz);
+		beam::DeleteNodeFiles(beam::g_sz);
+
+		beam::TestBbsStore();
 
 		{
 			printf("NodeProcessor test1...\n");
@@ -2989,29 +3834,29 @@ void TestAll()
 
 			std::vector<beam::BlockPlus::Ptr> blockChain;
 			beam::TestNodeProcessor1(blockChain);
-			beam::DeleteFile(beam::g_sz);
-			beam::DeleteFile(beam::g_sz2);
+			beam::DeleteNodeFiles(beam::g_sz);
+			beam::DeleteNodeFiles(beam::g_sz2);
 
 			printf("NodeProcessor test2...\n");
 			fflush(stdout);
 
 			beam::TestNodeProcessor2(blockChain);
-			beam::DeleteFile(beam::g_sz);
+			beam::DeleteNodeFiles(beam::g_sz);
 
 			printf("NodeProcessor test3...\n");
 			fflush(stdout);
 
 			beam::TestNodeProcessor3(blockChain);
-			beam::DeleteFile(beam::g_sz);
-			beam::DeleteFile(beam::g_sz2);
+			beam::DeleteNodeFiles(beam::g_sz);
+			beam::DeleteNodeFiles(beam::g_sz2);
 		}
 
 		printf("NodeX2 concurrent test...\n");
 		fflush(stdout);
 
 		beam::TestNodeConversation();
-		beam::DeleteFile(beam::g_sz);
-		beam::DeleteFile(beam::g_sz2);
+		beam::DeleteNodeFiles(beam::g_sz);
+		beam::DeleteNodeFiles(beam::g_sz2);
 	}
 
 	beam::Rules::get().pForks[2].m_Height = 17;
@@ -3037,15 +3882,21 @@ void TestAll()
 		node.Initialize();
 	}
 
-	beam::DeleteFile(beam::g_sz);
-	beam::DeleteFile(beam::g_sz2);
+	beam::DeleteNodeFiles(beam::g_sz);
+	beam::DeleteNodeFiles(beam::g_sz2);
 	beam::DeleteFile(beam::g_sz3);
 
+	printf("Miner template test...\n");
+	fflush(stdout);
+
+	beam::TestMinerTemplate();
+	beam::DeleteNodeFiles(beam::g_sz);
+
 	printf("Node <---> FlyClient test...\n");
 	fflush(stdout);
 
 	beam::TestFlyClient();
-	beam::DeleteFile(beam::g_sz);
+	beam::DeleteNodeFiles(beam::g_sz);
 }
 
 int main()
@@ -143,10 +143,17 @@ namespace beam
 
 		m_Run = true;
 		m_pCtl = nullptr;
+		m_pInject = nullptr;
+		m_Queued = 0;
 		m_InProgress = 0;
-		m_FlushTarget = static_cast<uint32_t>(-1);
+		m_FlushTarget = s_NoTarget;
+		m_Sleeping = 0;
+		m_CtlEpoch = 0;
 
 		uint32_t nThreads = get_Threads();
+		m_Workers = nThreads;
+		m_pWorkers.reset(new Worker[nThreads]);
+
 		m_vThreads.resize(nThreads);
 
 		for (uint32_t i = 0; i < nThreads; i++)
@@ -158,49 +165,83 @@ namespace beam
 		assert(pTask);
 		InitSafe();
 
-		std::unique_lock<std::mutex> scope(m_Mutex);
-
-		m_queTasks.push_back(*pTask.release());
 		m_InProgress++;
 
-		m_NewTask.notify_one();
+		TaskAsync* p = pTask.release();
+		p->m_pNext = m_pInject.load();
+		while (!m_pInject.compare_exchange_weak(p->m_pNext, p))
+			;
+
+		WakeIdle(false);
 	}
 
-	uint32_t ExecutorMT::Flush(uint32_t nMaxTasks)
+	void ExecutorMT::WakeIdle(bool bAll)
 	{
-		InitSafe();
+		if (!m_Sleeping)
+			return;
 
 		std::unique_lock<std::mutex> scope(m_Mutex);
-		FlushLocked(scope, nMaxTasks);
+
+		if (bAll)
+			m_NewTask.notify_all();
+		else
+			m_NewTask.notify_one();
+	}
+
+	uint32_t ExecutorMT::Flush(uint32_t nMaxTasks)
+	{
+		InitSafe();
+		FlushInternal(nMaxTasks);
 
 		return m_InProgress;
 	}
 
-	void ExecutorMT::FlushLocked(std::unique_lock<std::mutex>& scope, uint32_t nMaxTasks)
+	void ExecutorMT::FlushInternal(uint32_t nMaxTasks)
 	{
+		std::unique_lock<std::mutex> scope(m_Mutex);
 		m_FlushTarget = nMaxTasks;
 
 		while (m_InProgress > nMaxTasks)
 			m_Flushed.wait(scope);
 
-		m_FlushTarget = static_cast<uint32_t>(-1);
+		m_FlushTarget = s_NoTarget;
+	}
+
+	void ExecutorMT::OnDone()
+	{
+		uint32_t n = --m_InProgress;
+
+		uint32_t nTarget = m_FlushTarget;
+		if ((s_NoTarget != nTarget) && (n <= nTarget))
+		{
+			std::unique_lock<std::mutex> scope(m_Mutex);
+			m_Flushed.notify_one();
+		}
 	}
 
 	void ExecutorMT::ExecAll(TaskSync& t)
 	{
 		InitSafe();
-
-		std::unique_lock<std::mutex> scope(m_Mutex);
-		FlushLocked(scope, 0);
+		FlushInternal(0);
 
 		assert(!m_pCtl && !m_InProgress);
 		m_pCtl = &t;
-		m_InProgress = get_Threads();
+		m_InProgress = m_Workers;
+		m_CtlEpoch++; // each thread executes the control task once per epoch
 
-		m_NewTask.notify_all();
+		WakeIdle(true);
 
-		FlushLocked(scope, 0);
-		assert(!m_pCtl);
+		FlushInternal(0);
+		m_pCtl = nullptr;
+	}
+
+	void ExecutorMT::DeleteList(TaskAsync* p)
+	{
+		while (p)
+		{
+			TaskAsync::Ptr pGuard(p);
+			p = p->m_pNext;
+		}
 	}
 
 	void ExecutorMT::Stop()
@@ -220,73 +261,132 @@ namespace beam
 
 		m_vThreads.clear();
 
-		while (!m_queTasks.empty())
-		{
-			TaskAsync::Ptr pGuard(&m_queTasks.front());
-			m_queTasks.pop_front();
-		}
+		DeleteList(m_pInject.exchange(nullptr));
+
+		for (uint32_t i = 0; i < m_Workers; i++)
+			for (TaskAsync* p : m_pWorkers[i].m_Tasks)
+				delete p;
+
+		m_pWorkers.reset();
+		m_Workers = 0;
 	}
 
-	void ExecutorMT::RunThreadCtx(Context& ctx)
+	bool ExecutorMT::HasWork(const Worker& w) const
 	{
-		ctx.m_pThis = this;
+		return
+			!m_Run ||
+			(m_CtlEpoch != w.m_CtlEpoch) ||
+			m_pInject.load() ||
+			m_Queued;
+	}
 
-		while (true)
+	ExecutorMT::TaskAsync* ExecutorMT::PopTask(Worker& w)
+	{
+		{
+			std::unique_lock<std::mutex> scope(w.m_Mutex);
+			if (!w.m_Tasks.empty())
+			{
+				TaskAsync* p = w.m_Tasks.front();
+				w.m_Tasks.pop_front();
+				m_Queued--;
+				return p;
+			}
+		}
+
+		TaskAsync* pList = m_pInject.exchange(nullptr);
+		if (pList)
 		{
-			TaskAsync::Ptr pGuard;
-			TaskSync* pTask;
+			// the stack is in reverse order
+			TaskAsync* pPrev = nullptr;
+			uint32_t nCount = 0;
+
+			while (pList)
+			{
+				TaskAsync* pNext = pList->m_pNext;
+				pList->m_pNext = pPrev;
+				pPrev = pList;
+				pList = pNext;
+				nCount++;
+			}
+
+			TaskAsync* p = pPrev;
 
+			if (nCount > 1)
 			{
-				std::unique_lock<std::mutex> scope(m_Mutex);
-				while (true)
 				{
-					if (!m_Run)
-						return;
+					std::unique_lock<std::mutex> scope(w.m_Mutex);
+					for (TaskAsync* pT = p->m_pNext; pT; pT = pT->m_pNext)
+						w.m_Tasks.push_back(pT);
+				}
 
-					if (!m_queTasks.empty())
-					{
-						pGuard.reset(&m_queTasks.front());
-						pTask = pGuard.get();
-						m_queTasks.pop_front();
-						break;
-					}
+				m_Queued += nCount - 1;
+				WakeIdle(true); // let others steal
+			}
 
-					if (m_pCtl)
-					{
-						pTask = m_pCtl;
-						break;
-					}
+			return p;
+		}
 
-					m_NewTask.wait(scope);
-				}
+		// steal from the back, starting from the neighbor
+		uint32_t iSelf = static_cast<uint32_t>(&w - m_pWorkers.get());
+		for (uint32_t i = 1; i < m_Workers; i++)
+		{
+			Worker& wVictim = m_pWorkers[(iSelf + i) % m_Workers];
+
+			std::unique_lock<std::mutex> scope(wVictim.m_Mutex);
+			if (!wVictim.m_Tasks.empty())
+			{
+				TaskAsync* p = wVictim.m_Tasks.back();
+				wVictim.m_Tasks.pop_back();
+				m_Queued--;
+				return p;
 			}
+		}
 
-			assert(pTask && m_InProgress);
-			pTask->Exec(ctx);
+		return nullptr;
+	}
 
-			std::unique_lock<std::mutex> scope(m_Mutex);
+	void ExecutorMT::RunThreadCtx(Context& ctx)
+	{
+		ctx.m_pThis = this;
 
-			assert(m_InProgress);
-			m_InProgress--;
+		assert(ctx.m_iThread < m_Workers);
+		Worker& w = m_pWorkers[ctx.m_iThread];
 
-			if (pGuard)
+		while (m_Run)
+		{
+			uint32_t nEpoch = m_CtlEpoch;
+			if (w.m_CtlEpoch != nEpoch)
 			{
-				// standard task
-				if (m_InProgress == m_FlushTarget)
-					m_Flushed.notify_one();
+				// control task
+				w.m_CtlEpoch = nEpoch;
+
+				assert(m_pCtl && m_InProgress);
+				m_pCtl->Exec(ctx);
+
+				OnDone();
+				continue;
 			}
-			else
+
+			TaskAsync* p = PopTask(w);
+			if (p)
 			{
-				// control task
-				if (m_InProgress)
-					m_Flushed.wait(scope); // make sure we give other threads opportuinty to execute the control task
-				else
+				assert(m_InProgress);
+
 				{
-					m_pCtl = nullptr;
-					m_Flushed.notify_all();
+					TaskAsync::Ptr pGuard(p);
+					p->Exec(ctx);
 				}
+
+				OnDone();
+				continue;
 			}
 
+			std::unique_lock<std::mutex> scope(m_Mutex);
+
+			m_Sleeping++;
+			while (!HasWork(w))
+				m_NewTask.wait(scope);
+			m_Sleeping--;
 		}
 	}
 
@@ -17,7 +17,8 @@
 #include "common.h"
 #include <condition_variable>
 #include <thread>
-#include <boost/intrusive/list.hpp>
+#include <atomic>
+#include <deque>
 
 namespace beam
 {
@@ -55,11 +56,12 @@ namespace beam
 		};
 
 		struct TaskAsync
-			:public boost::intrusive::list_base_hook<>
-			, public TaskSync
+			:public TaskSync
 		{
 			typedef std::unique_ptr<TaskAsync> Ptr;
 			virtual ~TaskAsync() {}
+
+			TaskAsync* m_pNext = nullptr; // used by the executor while the task is queued
 		};
 
 		virtual uint32_t get_Threads() = 0;
@@ -86,20 +88,41 @@ namespace beam
 		void RunThreadCtx(Context&);
 
 	private:
-		std::mutex m_Mutex;
+		// Work-stealing scheduling. Pushed tasks go to the lock-free injection stack, an idle thread grabs them all at once
+		// into its own deque. Threads with empty deques steal from others. The mutex is only used to sleep/wake.
+		struct Worker
+		{
+			std::mutex m_Mutex; // contended only by thieves
+			std::deque<TaskAsync*> m_Tasks;
+			uint32_t m_CtlEpoch = 0;
+		};
 
-		boost::intrusive::list<TaskAsync> m_queTasks;
+		std::unique_ptr<Worker[]> m_pWorkers;
+		uint32_t m_Workers = 0;
 
-		uint32_t m_InProgress;
-		uint32_t m_FlushTarget;
-		bool m_Run;
+		std::atomic<TaskAsync*> m_pInject;
+		std::atomic<uint32_t> m_Queued; // in the workers deques
+		std::atomic<uint32_t> m_InProgress;
+		std::atomic<uint32_t> m_FlushTarget;
+		std::atomic<uint32_t> m_Sleeping;
+		std::atomic<uint32_t> m_CtlEpoch;
+		std::atomic<bool> m_Run;
 		TaskSync* m_pCtl;
+
+		std::mutex m_Mutex;
 		std::condition_variable m_NewTask;
 		std::condition_variable m_Flushed;
 
 		std::vector<std::thread> m_vThreads;
 
+		static const uint32_t s_NoTarget = static_cast<uint32_t>(-1);
+
 		void InitSafe();
-		void FlushLocked(std::unique_lock<std::mutex>&, uint32_t nMaxTasks);
+		void FlushInternal(uint32_t nMaxTasks);
+		TaskAsync* PopTask(Worker&);
+		bool HasWork(const Worker&) const;
+		void WakeIdle(bool bAll);
+		void OnDone();
+		static void DeleteList(TaskAsync*);
 	};
 }
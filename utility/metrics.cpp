@@ -0,0 +1,114 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+#include <algorithm>
+#include <iomanip>
+
+namespace beam {
+namespace metrics {
+
+	const uint64_t Histogram::s_pBounds_us[s_Bounds] = {
+		10, 25, 50, 100, 250, 500,
+		1000, 2500, 5000, 10000, 25000, 50000,
+		100000, 250000, 500000, 1000000, 2500000, 5000000,
+		10000000
+	};
+
+	void Histogram::Add(uint64_t dt_us)
+	{
+		const uint64_t* pEnd = s_pBounds_us + s_Bounds;
+		m_pCount[std::lower_bound(s_pBounds_us, pEnd, dt_us) - s_pBounds_us]++;
+		m_Sum_us += dt_us;
+	}
+
+	uint64_t Histogram::get_Count() const
+	{
+		uint64_t ret = 0;
+		for (uint32_t i = 0; i <= s_Bounds; i++)
+			ret += m_pCount[i];
+		return ret;
+	}
+
+	void Writer::Header(const char* szName, const char* szType, const char* szHelp)
+	{
+		m_os
+			<< "# HELP " << szName << ' ' << szHelp << '\n'
+			<< "# TYPE " << szName << ' ' << szType << '\n';
+	}
+
+	void Writer::Name(const char* szName, const char* szSuffix, const char* szLabels, const char* szExtraLabel)
+	{
+		m_os << szName;
+		if (szSuffix)
+			m_os << szSuffix;
+
+		bool bLabels = szLabels && *szLabels;
+		if (bLabels || szExtraLabel)
+		{
+			m_os << '{';
+			if (bLabels)
+				m_os << szLabels;
+			if (szExtraLabel)
+			{
+				if (bLabels)
+					m_os << ',';
+				m_os << szExtraLabel;
+			}
+			m_os << '}';
+		}
+
+		m_os << ' ';
+	}
+
+	void Writer::Value(const char* szName, const char* szLabels, uint64_t val)
+	{
+		Name(szName, nullptr, szLabels, nullptr);
+		m_os << val << '\n';
+	}
+
+	void Writer::Value(const char* szName, const char* szLabels, double val)
+	{
+		Name(szName, nullptr, szLabels, nullptr);
+		m_os << std::setprecision(9) << val << '\n';
+	}
+
+	void Writer::Write(const char* szName, const char* szLabels, const Histogram& h)
+	{
+		uint64_t nCount = 0;
+		char szLe[0x20];
+
+		for (uint32_t i = 0; i < Histogram::s_Bounds; i++)
+		{
+			nCount += h.m_pCount[i];
+
+			snprintf(szLe, sizeof(szLe), "le=\"%g\"", Histogram::s_pBounds_us[i] * 1e-6);
+			Name(szName, "_bucket", szLabels, szLe);
+			m_os << nCount << '\n';
+		}
+
+		nCount += h.m_pCount[Histogram::s_Bounds];
+
+		Name(szName, "_bucket", szLabels, "le=\"+Inf\"");
+		m_os << nCount << '\n';
+
+		Name(szName, "_sum", szLabels, nullptr);
+		m_os << std::setprecision(9) << h.m_Sum_us * 1e-6 << '\n';
+
+		Name(szName, "_count", szLabels, nullptr);
+		m_os << nCount << '\n';
+	}
+
+} // namespace metrics
+} // namespace beam
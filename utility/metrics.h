@@ -0,0 +1,54 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+namespace beam {
+namespace metrics {
+
+	// Latency histogram with fixed buckets, 10us .. 10s.
+	// Not thread-safe, should be updated and read under the owner's lock (or in its thread)
+	struct Histogram
+	{
+		static const uint32_t s_Bounds = 19;
+		static const uint64_t s_pBounds_us[s_Bounds];
+
+		uint64_t m_pCount[s_Bounds + 1] = { 0 }; // per bucket (not cumulative), the last one is for the overflow
+		uint64_t m_Sum_us = 0;
+
+		void Add(uint64_t dt_us);
+		uint64_t get_Count() const;
+	};
+
+	// Prometheus text exposition format
+	struct Writer
+	{
+		std::ostream& m_os;
+		Writer(std::ostream& os) :m_os(os) {}
+
+		// each metric family must start with the header. szLabels is either null or a comma-separated list: key1="val1",key2="val2"
+		void Header(const char* szName, const char* szType, const char* szHelp);
+		void Value(const char* szName, const char* szLabels, uint64_t);
+		void Value(const char* szName, const char* szLabels, double);
+		void Write(const char* szName, const char* szLabels, const Histogram&); // in seconds: _bucket, _sum, _count
+
+	private:
+		void Name(const char* szName, const char* szSuffix, const char* szLabels, const char* szExtraLabel);
+	};
+
+} // namespace metrics
+} // namespace beam
@@ -0,0 +1,99 @@
+// Copyright 2018 The Beam Team
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "utility/metrics.h"
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <assert.h>
+
+using namespace beam;
+using namespace std;
+
+static int error_count = 0;
+
+#define CHECK(s) \
+do {\
+    assert(s);\
+    if (!(s)) {\
+        ++error_count;\
+    }\
+} while(false)\
+
+
+static bool has_line(const string& text, const string& line) {
+    return text.find(line + "\n") != string::npos;
+}
+
+void test_histogram() {
+    metrics::Histogram h;
+    CHECK(h.get_Count() == 0);
+
+    h.Add(0);
+    h.Add(10); // bounds are inclusive
+    h.Add(11);
+    h.Add(999);
+    h.Add(20000000); // overflow
+
+    CHECK(h.get_Count() == 5);
+    CHECK(h.m_pCount[0] == 2);
+    CHECK(h.m_pCount[1] == 1);
+    CHECK(h.m_pCount[6] == 1);
+    CHECK(h.m_pCount[metrics::Histogram::s_Bounds] == 1);
+    CHECK(h.m_Sum_us == 20001020);
+}
+
+void test_writer() {
+    metrics::Histogram h;
+    h.Add(5);
+    h.Add(700);
+    h.Add(20000000);
+
+    ostringstream os;
+    metrics::Writer w(os);
+
+    w.Header("beam_test_total", "counter", "Test counter");
+    w.Value("beam_test_total", nullptr, uint64_t(17));
+    w.Value("beam_test_total", "kind=\"a\"", uint64_t(3));
+
+    w.Header("beam_test_seconds", "histogram", "Test latency");
+    w.Write("beam_test_seconds", "kind=\"a\"", h);
+
+    string s = os.str();
+
+    CHECK(has_line(s, "# HELP beam_test_total Test counter"));
+    CHECK(has_line(s, "# TYPE beam_test_total counter"));
+    CHECK(has_line(s, "beam_test_total 17"));
+    CHECK(has_line(s, "beam_test_total{kind=\"a\"} 3"));
+
+    CHECK(has_line(s, "beam_test_seconds_bucket{kind=\"a\",le=\"1e-05\"} 1"));
+    CHECK(has_line(s, "beam_test_seconds_bucket{kind=\"a\",le=\"0.0005\"} 1"));
+    CHECK(has_line(s, "beam_test_seconds_bucket{kind=\"a\",le=\"0.001\"} 2"));
+    CHECK(has_line(s, "beam_test_seconds_bucket{kind=\"a\",le=\"10\"} 2"));
+    CHECK(has_line(s, "beam_test_seconds_bucket{kind=\"a\",le=\"+Inf\"} 3"));
+    CHECK(has_line(s, "beam_test_seconds_sum{kind=\"a\"} 20.000705"));
+    CHECK(has_line(s, "beam_test_seconds_count{kind=\"a\"} 3"));
+}
+
+int main() {
+    try {
+        test_histogram();
+        test_writer();
+    }
+    catch (const exception& e) {
+        cout << "Exception: " << e.what() << '\n';
+        ++error_count;
+    }
+    return error_count;
+}
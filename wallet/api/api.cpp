@@ -816,7 +816,7 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
 
         if (existsJsonParam(params, "count"))
         {
-            if (params["count"] > 0)
+            if (params["count"] > 0 && params["count"] <= GetUtxo::MaxCount)
             {
                 getUtxo.count = params["count"];
             }
@@ -832,6 +832,77 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
             else throw jsonrpc_exception{ ApiError::InvalidJsonRpc, "Invalid 'skip' parameter.", id };
         }
 
+        if (existsJsonParam(params, "filter"))
+        {
+            const json& filter = params["filter"];
+
+            if (existsJsonParam(filter, "status"))
+            {
+                if (filter["status"].is_number_unsigned() && filter["status"] < static_cast<int>(Coin::Status::count))
+                {
+                    getUtxo.filter.status = static_cast<Coin::Status>(filter["status"].get<int>());
+                }
+                else throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'status' filter.", id };
+            }
+
+            if (existsJsonParam(filter, "asset_id"))
+            {
+                if (filter["asset_id"].is_number_unsigned())
+                {
+                    getUtxo.filter.assetId = filter["asset_id"].get<Asset::ID>();
+                }
+                else throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'asset_id' filter.", id };
+            }
+
+            if (existsJsonParam(filter, "min_amount"))
+            {
+                if (filter["min_amount"].is_number_unsigned())
+                {
+                    getUtxo.filter.minAmount = filter["min_amount"].get<Amount>();
+                }
+                else throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'min_amount' filter.", id };
+            }
+
+            if (existsJsonParam(filter, "max_amount"))
+            {
+                if (filter["max_amount"].is_number_unsigned())
+                {
+                    getUtxo.filter.maxAmount = filter["max_amount"].get<Amount>();
+                }
+                else throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'max_amount' filter.", id };
+            }
+        }
+
+        if (existsJsonParam(params, "sort"))
+        {
+            const json& sort = params["sort"];
+
+            if (!existsJsonParam(sort, "field") || sort["field"] != "amount")
+                throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'sort' parameter, only 'amount' field is supported.", id };
+
+            bool bDesc = false;
+            if (existsJsonParam(sort, "direction"))
+            {
+                if (sort["direction"] == "desc")
+                    bDesc = true;
+                else if (sort["direction"] != "asc")
+                    throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid sort 'direction' parameter.", id };
+            }
+
+            getUtxo.order = bDesc ? CoinsQuery::Order::AmountDesc : CoinsQuery::Order::AmountAsc;
+        }
+
+        if (existsJsonParam(params, "after"))
+        {
+            if (params["after"].is_string())
+            {
+                getUtxo.after = Coin::FromString(params["after"].get<std::string>());
+            }
+
+            if (!getUtxo.after)
+                throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'after' parameter.", id };
+        }
+
         getHandler().onMessage(id, getUtxo);
     }
 
@@ -896,6 +967,20 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
             else throw jsonrpc_exception{ ApiError::InvalidJsonRpc, "Invalid 'skip' parameter.", id };
         }
 
+        if (existsJsonParam(params, "after"))
+        {
+            const json& after = params["after"];
+
+            if (!after.is_object() || !existsJsonParam(after, "create_time") || !after["create_time"].is_number_unsigned())
+                throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'after' parameter.", id };
+
+            auto txId = readTxIdParameter(id, after);
+            if (!txId)
+                throw jsonrpc_exception{ ApiError::InvalidParamsJsonRpc, "Invalid 'after' parameter.", id };
+
+            txList.after = TxHistoryQuery::Key{ after["create_time"].get<Timestamp>(), *txId };
+        }
+
         getHandler().onMessage(id, txList);
     }
 
@@ -1218,24 +1303,31 @@ OfferInput collectOfferInput(const JsonRpcId& id, const json& params)
 
         for (auto& utxo : res.utxos)
         {
-            std::string createTxId = utxo.m_createTxId.is_initialized() ? TxIDToString(*utxo.m_createTxId) : "";
-            std::string spentTxId = utxo.m_spentTxId.is_initialized() ? TxIDToString(*utxo.m_spentTxId) : "";
-
-            msg["result"].push_back(
-            { 
-                {"id", utxo.toStringID()},
-                {"amount", utxo.m_ID.m_Value},
-                {"type", (const char*)FourCC::Text(utxo.m_ID.m_Type)},
-                {"maturity", utxo.get_Maturity()},
-                {"createTxId", createTxId},
-                {"spentTxId", spentTxId},
-                {"status", utxo.m_status},
-                {"status_string", utxo.getStatusString()},
-                {"session", utxo.m_sessionId}
-            });
+            json item;
+            getUtxoItem(utxo, item);
+            msg["result"].push_back(std::move(item));
         }
     }
 
+    void WalletApi::getUtxoItem(const Coin& utxo, json& item)
+    {
+        std::string createTxId = utxo.m_createTxId.is_initialized() ? TxIDToString(*utxo.m_createTxId) : "";
+        std::string spentTxId = utxo.m_spentTxId.is_initialized() ? TxIDToString(*utxo.m_spentTxId) : "";
+
+        item =
+        {
+            {"id", utxo.toStringID()},
+            {"amount", utxo.m_ID.m_Value},
+            {"type", (const char*)FourCC::Text(utxo.m_ID.m_Type)},
+            {"maturity", utxo.get_Maturity()},
+            {"createTxId", createTxId},
+            {"spentTxId", spentTxId},
+            {"status", utxo.m_status},
+            {"status_string", utxo.getStatusString()},
+            {"session", utxo.m_sessionId}
+        };
+    }
+
     void WalletApi::getResponse(const JsonRpcId& id, const Send::Response& res, json& msg)
     {
         msg = json
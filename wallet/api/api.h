@@ -334,9 +334,22 @@ namespace beam::wallet
 
     struct GetUtxo
     {
-        int count = 0;
+        static constexpr int MaxCount = 1000; // keeps the response bounded, the larger sets are paged by 'after'
+
+        int count = MaxCount;
         int skip = 0;
 
+        struct
+        {
+            boost::optional<Coin::Status> status;
+            boost::optional<Asset::ID> assetId;
+            boost::optional<Amount> minAmount;
+            boost::optional<Amount> maxAmount;
+        } filter;
+
+        CoinsQuery::Order order = CoinsQuery::Order::Default;
+        boost::optional<Coin::ID> after; // the last coin of the previous page
+
         struct Response
         {
             std::vector<Coin> utxos;
@@ -374,6 +387,7 @@ namespace beam::wallet
 
         int count = 0;
         int skip = 0;
+        boost::optional<TxHistoryQuery::Key> after; // create_time and txId of the last tx of the previous page
 
         struct Response
         {
@@ -472,6 +486,9 @@ namespace beam::wallet
 
 #undef RESPONSE_FUNC
 
+        // get_utxo result item, for the callers that fill the response without collecting the coins first
+        static void getUtxoItem(const Coin&, json& item);
+
     private:
         IWalletApiHandler& getHandler() const;
 
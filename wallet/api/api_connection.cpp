@@ -554,16 +554,44 @@ void ApiConnection::onMessage(const JsonRpcId& id, const GetUtxo& data)
 {
     LOG_DEBUG() << "GetUtxo(id = " << id << ")";
 
-    GetUtxo::Response response;
-    _walletData.getWalletDB()->visitCoins([&response](const Coin& c)->bool
+    CoinsQuery query;
+    query.m_Status = data.filter.status;
+    query.m_AssetID = data.filter.assetId;
+    query.m_AmountMin = data.filter.minAmount;
+    query.m_AmountMax = data.filter.maxAmount;
+    query.m_Order = data.order;
+    query.m_After = data.after;
+    query.m_Skip = data.skip;
+    query.m_Count = data.count;
+
+    auto walletDB = _walletData.getWalletDB();
+
+    if (data.after && (CoinsQuery::Order::Default == data.order))
     {
-        response.utxos.push_back(c);
+        // the creation order is located by the cursor coin itself
+        Coin coin;
+        coin.m_ID = *data.after;
+        if (!walletDB->findCoin(coin))
+        {
+            doError(id, ApiError::InvalidParamsJsonRpc, "Unknown 'after' coin.");
+            return;
+        }
+    }
+
+    // the coins go straight into the response
+    json msg;
+    _api.getResponse(id, GetUtxo::Response(), msg);
+
+    json& result = msg["result"];
+    walletDB->visitCoins(query, [&result](const Coin& c)->bool
+    {
+        json item;
+        WalletApi::getUtxoItem(c, item);
+        result.push_back(std::move(item));
         return true;
     });
 
-    doPagination(data.skip, data.count, response.utxos);
-
-    doResponse(id, response);
+    serializeMsg(msg);
 }
 
 void ApiConnection::onMessage(const JsonRpcId& id, const WalletStatus& data)
@@ -634,9 +662,22 @@ void ApiConnection::onMessage(const JsonRpcId& id, const TxList& data)
 
     TxList::Response res;
 
+    // filtering and pagination are done by the db
+    TxHistoryQuery query;
+    query.m_Type = TxType::Simple;
+    query.m_Status = data.filter.status;
+    query.m_KernelProofHeight = data.filter.height;
+    query.m_After = data.after;
+
+    if (data.count > 0)
+    {
+        query.m_Skip = data.skip;
+        query.m_Count = data.count;
+    }
+
     {
         auto walletDB = _walletData.getWalletDB();
-        auto txList = walletDB->getTxHistory();
+        auto txList = walletDB->getTxHistory(query);
 
         Block::SystemState::ID stateID = {};
         _walletData.getWalletDB()->getSystemStateID(stateID);
@@ -654,34 +695,6 @@ void ApiConnection::onMessage(const JsonRpcId& id, const TxList& data)
         }
     }
 
-    using Result = decltype(res.resultList);
-
-    // filter transactions by status if provided
-    if (data.filter.status)
-    {
-        Result filteredList;
-
-        for (const auto& it : res.resultList)
-            if (it.tx.m_status == *data.filter.status)
-                filteredList.push_back(it);
-
-        res.resultList = filteredList;
-    }
-
-    // filter transactions by height if provided
-    if (data.filter.height)
-    {
-        Result filteredList;
-
-        for (const auto& it : res.resultList)
-            if (it.kernelProofHeight == *data.filter.height)
-                filteredList.push_back(it);
-
-        res.resultList = filteredList;
-    }
-
-    doPagination(data.skip, data.count, res.resultList);
-
     doResponse(id, res);
 }
 
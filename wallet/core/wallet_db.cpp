@@ -18,6 +18,7 @@
 #include "utility/helpers.h"
 #include "sqlite/sqlite3.h"
 #include "core/block_rw.h"
+#include "utility/executor.h"
 #include <sstream>
 #include <boost/functional/hash.hpp>
 #include <boost/filesystem.hpp>
@@ -67,6 +68,7 @@
 #define VARIABLES_NAME "variables"
 #define ADDRESSES_NAME "addresses"
 #define TX_PARAMS_NAME "txparams"
+#define TX_SUMMARY_NAME "TxSummary"
 #define PRIVATE_VARIABLES_NAME "PrivateVariables"
 #define WALLET_MESSAGE_NAME "WalletMessages"
 #define INCOMING_WALLET_MESSAGE_NAME "IncomingWalletMessages"
@@ -101,6 +103,17 @@
 
 #define TX_PARAMS_FIELDS ENUM_TX_PARAMS_FIELDS(LIST, COMMA, )
 
+// denormalized from the tx parameters, for the paged history. Only for txs that have all the mandatory parameters
+#define ENUM_TX_SUMMARY_FIELDS(each, sep, obj) \
+    each(txID,              txID,              BLOB NOT NULL PRIMARY KEY, obj) sep \
+    each(txType,            txType,            INTEGER NOT NULL, obj) sep \
+    each(createTime,        createTime,        INTEGER NOT NULL, obj) sep \
+    each(status,            status,            INTEGER NOT NULL, obj) sep \
+    each(assetId,           assetId,           INTEGER NOT NULL, obj) sep \
+    each(kernelProofHeight, kernelProofHeight, INTEGER NOT NULL, obj)
+
+#define TX_SUMMARY_FIELDS ENUM_TX_SUMMARY_FIELDS(LIST, COMMA, )
+
 #define ENUM_WALLET_MESSAGE_FIELDS(each, sep, obj) \
     each(ID,  ID,  INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT, obj) sep \
     each(PeerID, PeerID,   BLOB, obj) sep \
@@ -414,6 +427,27 @@ namespace beam::wallet
             value = blob;
         }
 
+        bool IsTxSummaryParam(TxParameterID paramID)
+        {
+            switch (paramID)
+            {
+            // mandatory
+            case TxParameterID::TransactionType:
+            case TxParameterID::Amount:
+            case TxParameterID::MyID:
+            case TxParameterID::CreateTime:
+            case TxParameterID::IsSender:
+            // summary columns
+            case TxParameterID::Status:
+            case TxParameterID::AssetID:
+            case TxParameterID::KernelProofHeight:
+                return true;
+
+            default:
+                return false;
+            }
+        }
+
         vector<Coin> converIDsToCoins(const vector<Coin::ID>& coinIDs)
         {
             vector<Coin> coins(coinIDs.size());
@@ -766,7 +800,10 @@ namespace beam::wallet
         const char* SystemStateIDName = "SystemStateID";
         const char* LastUpdateTimeName = "LastUpdateTime";
         const int BusyTimeoutMs = 5000;
-        const int DbVersion   = 19;
+        const int DbVersion   = 22;
+        const int DbVersion21 = 21;
+        const int DbVersion20 = 20;
+        const int DbVersion19 = 19;
         const int DbVersion18 = 18;
         const int DbVersion17 = 17;
         const int DbVersion16 = 16;
@@ -926,6 +963,20 @@ namespace beam::wallet
             return stm.step();
         }
 
+        void CreateSpendableIndex(sqlite3* db)
+        {
+            const char* req = "CREATE INDEX IF NOT EXISTS SpendableIndex ON " STORAGE_NAME "(spentHeight,maturity,assetId);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
+        void CreateCoinAmountIndex(sqlite3* db)
+        {
+            const char* req = "CREATE INDEX IF NOT EXISTS CoinAmountIndex ON " STORAGE_NAME "(amount,assetId,Type,SubKey,Number);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
         void CreateStorageTable(sqlite3* db)
         {
             const char* req = "CREATE TABLE " STORAGE_NAME " (" ENUM_ALL_STORAGE_FIELDS(LIST_WITH_TYPES, COMMA, ) ");"
@@ -933,6 +984,9 @@ namespace beam::wallet
                 "CREATE INDEX ConfirmIndex ON " STORAGE_NAME"(confirmHeight);";
             int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
             throwIfError(ret, db);
+
+            CreateSpendableIndex(db);
+            CreateCoinAmountIndex(db);
         }
 
         void CreateWalletMessageTable(sqlite3* db)
@@ -977,6 +1031,15 @@ namespace beam::wallet
             throwIfError(ret, db);
         }
 
+        void CreateTxSummaryTable(sqlite3* db)
+        {
+            const char* req = "CREATE TABLE " TX_SUMMARY_NAME " (" ENUM_TX_SUMMARY_FIELDS(LIST_WITH_TYPES, COMMA, ) ") WITHOUT ROWID;"
+                "CREATE INDEX TxSummaryTimeIndex ON " TX_SUMMARY_NAME "(createTime DESC,txID);"
+                "CREATE INDEX TxSummaryTypeIndex ON " TX_SUMMARY_NAME "(txType,createTime DESC,txID);";
+            int ret = sqlite3_exec(db, req, nullptr, nullptr, nullptr);
+            throwIfError(ret, db);
+        }
+
         void CreateStatesTable(sqlite3* db)
         {
             const char* req = "CREATE TABLE [" TblStates "] ("
@@ -1122,6 +1185,7 @@ namespace beam::wallet
         CreateVariablesTable(db);
         CreateAddressesTable(db);
         CreateTxParamsTable(db);
+        CreateTxSummaryTable(db);
         CreateStatesTable(db);
         CreateLaserTables(db);
         CreateAssetsTable(db);
@@ -1581,6 +1645,29 @@ namespace beam::wallet
                 case DbVersion18:
                     LOG_INFO() << "Converting DB from format 18...";
                     CreateNotificationsTable(walletDB->_db);
+                    // no break
+
+                case DbVersion19:
+                    LOG_INFO() << "Converting DB from format 19...";
+                    CreateSpendableIndex(walletDB->_db);
+                    // no break
+
+                case DbVersion20:
+                    LOG_INFO() << "Converting DB from format 20...";
+                    CreateTxSummaryTable(walletDB->_db);
+                    {
+                        std::vector<TxID> txIDs;
+                        for (sqlite::Statement stm(walletDB.get(), "SELECT DISTINCT txID FROM " TX_PARAMS_NAME ";"); stm.step(); )
+                            stm.get(0, txIDs.emplace_back());
+
+                        for (const auto& txID : txIDs)
+                            walletDB->updateTxSummary(txID);
+                    }
+                    // no break
+
+                case DbVersion21:
+                    LOG_INFO() << "Converting DB from format 21...";
+                    CreateCoinAmountIndex(walletDB->_db);
                     storage::setVar(*walletDB, Version, DbVersion);
                     // no break
 
@@ -1844,15 +1931,21 @@ namespace beam::wallet
 	}
 
 	bool IWalletDB::ImportRecovery(const std::string& path, IRecoveryProgress& prog)
+	{
+		std::vector<IWalletDB*> vDBs(1, this);
+		return ImportRecovery(path, vDBs, prog);
+	}
+
+	bool IWalletDB::ImportRecovery(const std::string& path, const std::vector<IWalletDB*>& vDBs, IRecoveryProgress& prog)
 	{
         struct MyParser
-            :public RecoveryInfo::IRecognizer
+            :public RecoveryInfo::IRecognizerMulti
         {
-            IWalletDB& m_This;
+            const std::vector<IWalletDB*>& m_vDBs;
             IRecoveryProgress& m_Progr;
 
-            MyParser(IWalletDB& db, IRecoveryProgress& progr)
-                :m_This(db)
+            MyParser(const std::vector<IWalletDB*>& vDBs, IRecoveryProgress& progr)
+                :m_vDBs(vDBs)
                 ,m_Progr(progr)
             {
             }
@@ -1865,33 +1958,62 @@ namespace beam::wallet
             virtual bool OnStates(std::vector<Block::SystemState::Full>& vec) override
             {
                 if (!vec.empty())
-                    m_This.get_History().AddStates(&vec.front(), vec.size());
+                {
+                    for (IWalletDB* pDB : m_vDBs)
+                        pDB->get_History().AddStates(&vec.front(), vec.size());
+                }
 
                 return true;
             }
 
-            virtual bool OnUtxoRecognized(Height h, const Output& outp, CoinID& cid) override
+            virtual bool OnUtxoRecognized(uint32_t iOwner, Height h, const Output& outp, CoinID& cid) override
             {
-                if (m_This.IsRecoveredMatch(cid, outp.m_Commitment))
+                IWalletDB& db = *m_vDBs[iOwner];
+
+                if (db.IsRecoveredMatch(cid, outp.m_Commitment))
                 {
                     Coin c;
                     c.m_ID = cid;
-                    m_This.findCoin(c); // in case it exists already - fill its parameters
+                    db.findCoin(c); // in case it exists already - fill its parameters
 
                     c.m_maturity = outp.get_MinMaturity(h);
                     c.m_confirmHeight = h;
 
                     LOG_INFO() << "CoinID: " << c.m_ID << " Maturity=" << c.m_maturity << " Recovered";
 
-                    m_This.saveCoin(c);
+                    db.saveCoin(c);
                 }
 
                 return true;
             }
         };
 
-        MyParser p(*this, prog);
-        p.m_pOwner = get_OwnerKdf();
+        // recognition is done by all the cores
+        struct MyExecutor
+            :public ExecutorMT
+        {
+            virtual uint32_t get_Threads() override
+            {
+                return std::max(std::thread::hardware_concurrency(), 1U);
+            }
+
+            virtual void RunThread(uint32_t iThread) override
+            {
+                ExecutorMT::Context ctx;
+                ctx.m_iThread = iThread;
+                RunThreadCtx(ctx);
+            }
+
+            ~MyExecutor() { Stop(); }
+
+        } ex;
+
+        Executor::Scope scope(ex);
+
+        MyParser p(vDBs, prog);
+        p.m_vOwners.resize(vDBs.size());
+        for (size_t i = 0; i < vDBs.size(); i++)
+            p.m_vOwners[i].m_pOwner = vDBs[i]->get_OwnerKdf();
 
         return p.Proceed(path.c_str());
 	}
@@ -1954,31 +2076,41 @@ namespace beam::wallet
     vector<Coin> WalletDB::selectCoins(Amount amount, Asset::ID assetId)
     {
         vector<Coin> coins, coinsSel;
-        Block::SystemState::ID stateID = {};
-        getSystemStateID(stateID);
+        Height h = getCurrentHeight();
+
+        if (!m_SpendableCoins.m_Loaded)
+            loadSpendableCoins();
+
+        const SpendableCoins::Map& map = m_SpendableCoins.m_Map;
+
+        Coin::ID cid(Zero);
+        cid.m_SubIdx = 0;
+        cid.m_AssetID = assetId;
+        auto itBegin = map.lower_bound(cid);
+
+        cid.m_Value = amount;
+        auto itMid = map.lower_bound(cid);
 
+        std::vector<const Coin*> vSrc;
+
+        auto addIfAvailable = [&](const Coin& c)
         {
-            sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE maturity>=0 AND maturity<=?1 AND spentHeight<0 ORDER BY amount ASC");
-            stm.bind(1, stateID.m_Height);
+            if ((c.m_maturity > h) || storage::IsOngoingTx(*this, c.m_spentTxId))
+                return false;
 
-            while (stm.step())
-            {
-                auto& coin = coins.emplace_back();
-                int colIdx = 0;
-                ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+            coins.emplace_back().m_ID = c.m_ID;
+            vSrc.push_back(&c);
+            return true;
+        };
 
-                storage::DeduceStatus(*this, coin, stateID.m_Height);
-                if (Coin::Status::Available != coin.m_status)
-                    coins.pop_back();
-                else if (coin.m_ID.m_AssetID != assetId)
-                    coins.pop_back();
-                else
-                {
-                    if (coin.m_ID.m_Value >= amount)
-                        break;
-                }
-            }
-        }
+        // coins below the amount, in ascending order
+        for (auto it = itBegin; it != itMid; ++it)
+            addIfAvailable(it->second);
+
+        // and the smallest sufficient one. Bigger coins would never be selected
+        for (auto it = itMid; (map.end() != it) && (it->first.m_AssetID == assetId); ++it)
+            if (addIfAvailable(it->second))
+                break;
 
         CoinSelector3 csel(coins);
         CoinSelector3::Result res = csel.Select(amount);
@@ -1988,12 +2120,59 @@ namespace beam::wallet
             coinsSel.reserve(res.second.size());
 
             for (size_t j = 0; j < res.second.size(); j++)
-                coinsSel.push_back(std::move(coins[res.second[j]]));
+            {
+                Coin& coin = coinsSel.emplace_back(*vSrc[res.second[j]]);
+                coin.m_status = Coin::Status::Available;
+            }
         }
 
         return coinsSel;
     }
 
+    void WalletDB::loadSpendableCoins()
+    {
+        m_SpendableCoins.Reset();
+
+        sqlite::Statement stm(this, "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE spentHeight<0 AND maturity>=0;");
+        while (stm.step())
+        {
+            Coin coin;
+            int colIdx = 0;
+            ENUM_ALL_STORAGE_FIELDS(STM_GET_LIST, NOSEP, coin);
+
+            m_SpendableCoins.OnChanged(coin);
+        }
+
+        m_SpendableCoins.m_Loaded = true;
+    }
+
+    bool WalletDB::SpendableCoins::Cmp::operator() (const Coin::ID& a, const Coin::ID& b) const
+    {
+        return
+            std::make_tuple(a.m_AssetID, a.m_Value, a.m_Idx, uint32_t(a.m_Type), a.m_SubIdx) <
+            std::make_tuple(b.m_AssetID, b.m_Value, b.m_Idx, uint32_t(b.m_Type), b.m_SubIdx);
+    }
+
+    void WalletDB::SpendableCoins::OnChanged(const Coin& coin)
+    {
+        // same criteria as in GetCoinStatus, except for the height and tx dependent ones
+        bool bSpendable =
+            (MaxHeight == coin.m_spentHeight) &&
+            (MaxHeight != coin.m_confirmHeight) &&
+            (MaxHeight != coin.m_maturity);
+
+        if (bSpendable)
+            m_Map[coin.m_ID] = coin;
+        else
+            m_Map.erase(coin.m_ID);
+    }
+
+    void WalletDB::SpendableCoins::Reset()
+    {
+        m_Map.clear();
+        m_Loaded = false;
+    }
+
     std::vector<Coin> WalletDB::getCoinsCreatedByTx(const TxID& txId) const
     {
         // select all coins for TxID
@@ -2284,11 +2463,122 @@ namespace beam::wallet
 
     void WalletDB::visitCoins(function<bool(const Coin& coin)> func)
     {
-        const char* req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " ORDER BY ROWID;";
-        sqlite::Statement stm(this, req);
+        visitCoins(CoinsQuery(), func);
+    }
+
+    void WalletDB::visitCoins(const CoinsQuery& q, function<bool(const Coin& coin)> func)
+    {
+        uint64_t nRowAfter = 0;
+        if (q.m_After && (CoinsQuery::Order::Default == q.m_Order))
+        {
+            // the creation order has no key of its own, the cursor coin is needed to locate it. A missing one must not look like the end of the list
+            Coin coin;
+            coin.m_ID = *q.m_After;
+
+            sqlite::Statement stm(this, "SELECT ROWID FROM " STORAGE_NAME STORAGE_WHERE_ID ";");
+
+            int colIdx = 0;
+            STORAGE_BIND_ID(coin)
+
+            if (!stm.step())
+                throw DatabaseException("coins page cursor not found");
+
+            stm.get(0, nRowAfter);
+        }
+
+        std::string req = "SELECT " STORAGE_FIELDS " FROM " STORAGE_NAME " WHERE 1";
+
+        if (q.m_Status)
+        {
+            // the status is deduced, narrow it down by the heights, the rest is checked per coin
+            switch (*q.m_Status)
+            {
+            case Coin::Status::Available:
+            case Coin::Status::Maturing:
+            case Coin::Status::Outgoing:
+                req += " AND spentHeight<0 AND confirmHeight>=0";
+                break;
+
+            case Coin::Status::Unavailable:
+            case Coin::Status::Incoming:
+                req += " AND spentHeight<0 AND confirmHeight<0";
+                break;
+
+            case Coin::Status::Spent:
+            case Coin::Status::Consumed:
+                req += " AND spentHeight>=0";
+                break;
+
+            default:
+                break;
+            }
+        }
+
+        if (q.m_AssetID)
+            req += " AND assetId=?3";
+        if (q.m_AmountMin)
+            req += " AND amount>=?4";
+        if (q.m_AmountMax)
+            req += " AND amount<=?5";
+
+        switch (q.m_Order)
+        {
+        case CoinsQuery::Order::AmountAsc:
+            if (q.m_After)
+                req += " AND (amount,assetId,Type,SubKey,Number)>(?6,?7,?8,?9,?10)";
+            req += " ORDER BY amount,assetId,Type,SubKey,Number";
+            break;
+
+        case CoinsQuery::Order::AmountDesc:
+            if (q.m_After)
+                req += " AND (amount,assetId,Type,SubKey,Number)<(?6,?7,?8,?9,?10)";
+            req += " ORDER BY amount DESC,assetId DESC,Type DESC,SubKey DESC,Number DESC";
+            break;
+
+        default:
+            if (q.m_After)
+                req += " AND ROWID>?6";
+            req += " ORDER BY ROWID";
+        }
+
+        // with the status filter the page is counted after the per-coin check
+        bool bPageInSql = !q.m_Status;
+        if (bPageInSql)
+            req += " LIMIT ?1 OFFSET ?2";
+
+        req += ";";
+
+        sqlite::Statement stm(this, req.c_str());
+        if (bPageInSql)
+        {
+            stm.bind(1, q.m_Count);
+            stm.bind(2, q.m_Skip);
+        }
+        if (q.m_AssetID)
+            stm.bind(3, *q.m_AssetID);
+        // amounts are bound as int64, larger bounds must not wrap to negative
+        const Amount nAmountLimit = std::numeric_limits<int64_t>::max();
+        if (q.m_AmountMin)
+            stm.bind(4, std::min(*q.m_AmountMin, nAmountLimit));
+        if (q.m_AmountMax)
+            stm.bind(5, std::min(*q.m_AmountMax, nAmountLimit));
+        if (q.m_After && (CoinsQuery::Order::Default == q.m_Order))
+            stm.bind(6, nRowAfter);
+        else if (q.m_After)
+        {
+            const Coin::ID& cid = *q.m_After;
+            stm.bind(6, cid.m_Value);
+            stm.bind(7, cid.m_AssetID);
+            stm.bind(8, cid.m_Type);
+            stm.bind(9, cid.m_SubIdx);
+            stm.bind(10, cid.m_Idx);
+        }
+
+        uint64_t nSkip = bPageInSql ? 0 : q.m_Skip;
+        uint32_t nLeft = bPageInSql ? std::numeric_limits<uint32_t>::max() : q.m_Count;
 
         Height h = getCurrentHeight();
-        while (stm.step())
+        while (nLeft && stm.step())
         {
             Coin coin;
 
@@ -2297,6 +2587,18 @@ namespace beam::wallet
 
             storage::DeduceStatus(*this, coin, h);
 
+            if (q.m_Status && (*q.m_Status != coin.m_status))
+                continue;
+
+            if (nSkip)
+            {
+                nSkip--;
+                continue;
+            }
+
+            if (!bPageInSql)
+                nLeft--;
+
             if (!func(coin))
                 break;
         }
@@ -2437,67 +2739,98 @@ namespace beam::wallet
 
     vector<TxDescription> WalletDB::getTxHistory(wallet::TxType txType, uint64_t start, int count) const
     {
-        // TODO this is temporary solution
-        int txCount = 0;
-        {
-            std::string req = "SELECT COUNT(DISTINCT txID) FROM " TX_PARAMS_NAME " WHERE paramID = ?1";
-            req += (txType != wallet::TxType::ALL) ? " AND value = ?2 ;" : " ;";
+        TxHistoryQuery q;
+        if (txType != wallet::TxType::ALL)
+            q.m_Type = txType;
+        q.m_Skip = start;
+        q.m_Count = static_cast<uint32_t>(std::max(count, 0));
 
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, wallet::TxParameterID::TransactionType);
+        return getTxHistory(q);
+    }
 
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                typeBlob = toByteBuffer(txType);
-                stm.bind(2, typeBlob);
-            }
+    vector<TxDescription> WalletDB::getTxHistory(const TxHistoryQuery& q) const
+    {
+        std::string req = "SELECT txID FROM " TX_SUMMARY_NAME " WHERE 1";
 
-            stm.step();
-            stm.get(0, txCount);
+        if (q.m_Type)
+            req += " AND txType=?3";
+        if (q.m_Status)
+            req += " AND status=?4";
+        if (q.m_AssetID)
+            req += " AND assetId=?5";
+        if (q.m_KernelProofHeight)
+            req += " AND kernelProofHeight=?6";
+        if (q.m_After)
+            req += " AND (createTime<?7 OR (createTime=?7 AND txID>?8))";
+
+        req += " ORDER BY createTime DESC, txID ASC LIMIT ?1 OFFSET ?2;";
+
+        sqlite::Statement stm(this, req.c_str());
+        stm.bind(1, q.m_Count);
+        stm.bind(2, q.m_Skip);
+
+        if (q.m_Type)
+            stm.bind(3, *q.m_Type);
+        if (q.m_Status)
+            stm.bind(4, *q.m_Status);
+        if (q.m_AssetID)
+            stm.bind(5, *q.m_AssetID);
+        if (q.m_KernelProofHeight)
+            stm.bind(6, *q.m_KernelProofHeight);
+        if (q.m_After)
+        {
+            stm.bind(7, q.m_After->m_CreateTime);
+            stm.bind(8, q.m_After->m_TxID);
         }
 
         vector<TxDescription> res;
-        if (txCount > 0)
+        while (stm.step())
         {
-            res.reserve(static_cast<size_t>(min(txCount, count)));
-            std::string req = "SELECT DISTINCT txID FROM " TX_PARAMS_NAME;
-
-            if (txType != wallet::TxType::ALL)
+            TxID txID;
+            stm.get(0, txID);
+            auto t = getTx(txID);
+            if (t.is_initialized())
             {
-                req += " WHERE paramID = ?3 AND value = ?4";
+                res.emplace_back(std::move(*t));
             }
+        }
 
-            req += " LIMIT ?1 OFFSET ?2 ;";
+        return res;
+    }
 
-            sqlite::Statement stm(this, req.c_str());
-            stm.bind(1, count);
-            stm.bind(2, start);
+    void WalletDB::updateTxSummary(const TxID& txID)
+    {
+        if (!hasTransaction(txID))
+        {
+            sqlite::Statement stm(this, "DELETE FROM " TX_SUMMARY_NAME " WHERE txID=?1;");
+            stm.bind(1, txID);
+            stm.step();
+            return;
+        }
 
-            ByteBuffer typeBlob;
-            if (txType != wallet::TxType::ALL)
-            {
-                stm.bind(3, wallet::TxParameterID::TransactionType);
-                typeBlob = toByteBuffer(txType);
-                stm.bind(4, typeBlob);
-            }
+        struct
+        {
+            TxID m_txID;
+            wallet::TxType m_txType = wallet::TxType::Simple;
+            Timestamp m_createTime = 0;
+            wallet::TxStatus m_status = wallet::TxStatus::Pending;
+            Asset::ID m_assetId = Asset::s_InvalidID;
+            Height m_kernelProofHeight = 0;
+        } x;
 
-            while (stm.step())
-            {
-                TxID txID;
-                stm.get(0, txID);
-                auto t = getTx(txID);
-                if (t.is_initialized())
-                {
-                    res.emplace_back(*t);
-                }
-            }
-            sort(res.begin(), res.end(), [](const auto& left, const auto& right) {return left.m_createTime > right.m_createTime; });
-        }
+        x.m_txID = txID;
+        storage::getTxParameter(*this, txID, TxParameterID::TransactionType, x.m_txType);
+        storage::getTxParameter(*this, txID, TxParameterID::CreateTime, x.m_createTime);
+        storage::getTxParameter(*this, txID, TxParameterID::Status, x.m_status);
+        storage::getTxParameter(*this, txID, TxParameterID::AssetID, x.m_assetId);
+        storage::getTxParameter(*this, txID, TxParameterID::KernelProofHeight, x.m_kernelProofHeight);
 
-        return res;
+        sqlite::Statement stm(this, "INSERT OR REPLACE INTO " TX_SUMMARY_NAME " (" TX_SUMMARY_FIELDS ") VALUES(" ENUM_TX_SUMMARY_FIELDS(BIND_LIST, COMMA, ) ");");
+        int colIdx = 0;
+        ENUM_TX_SUMMARY_FIELDS(STM_BIND_LIST, NOSEP, x);
+        stm.step();
     }
-    
+
     boost::optional<TxDescription> WalletDB::getTx(const TxID& txId) const
     {
         // load only simple TX that supported by TxDescription
@@ -2633,6 +2966,7 @@ namespace beam::wallet
 
             stm.step();
             deleteParametersFromCache(txId);
+            updateTxSummary(txId);
             notifyTransactionChanged(ChangeAction::Removed, { *tx });
         }
     }
@@ -3117,6 +3451,10 @@ namespace beam::wallet
                 stm2.bind(4, blob);
                 stm2.step();
 
+                insertParameterToCache(txID, subTxID, paramID, blob);
+                if (kDefaultSubTxID == subTxID && IsTxSummaryParam(paramID))
+                    updateTxSummary(txID);
+
                 if (shouldNotifyAboutChanges)
                 {
                     auto tx = getTx(txID);
@@ -3125,7 +3463,6 @@ namespace beam::wallet
                         notifyTransactionChanged(ChangeAction::Updated, { *tx });
                     }
                 }
-                insertParameterToCache(txID, subTxID, paramID, blob);
                 return true;
             }
         }
@@ -3139,6 +3476,11 @@ namespace beam::wallet
         int colIdx = 0;
         ENUM_TX_PARAMS_FIELDS(STM_BIND_LIST, NOSEP, parameter);
         stm.step();
+
+        insertParameterToCache(txID, subTxID, paramID, blob);
+        if (kDefaultSubTxID == subTxID && IsTxSummaryParam(paramID))
+            updateTxSummary(txID);
+
         if (shouldNotifyAboutChanges)
         {
             auto tx = getTx(txID);
@@ -3147,7 +3489,6 @@ namespace beam::wallet
                 notifyTransactionChanged(hasTx ? ChangeAction::Updated : ChangeAction::Added, { *tx });
             }
         }
-        insertParameterToCache(txID, subTxID, paramID, blob);
         return true;
     }
 
@@ -3251,6 +3592,8 @@ namespace beam::wallet
                 m_DbTransaction->rollback();
                 m_DbTransaction.reset();
             }
+
+            m_SpendableCoins.Reset();
         }
     }
 
@@ -3294,6 +3637,26 @@ namespace beam::wallet
         if (items.empty() && action != ChangeAction::Reset)
             return;
 
+        if (m_SpendableCoins.m_Loaded)
+        {
+            switch (action)
+            {
+            case ChangeAction::Added:
+            case ChangeAction::Updated:
+                for (const auto& coin : items)
+                    m_SpendableCoins.OnChanged(coin);
+                break;
+
+            case ChangeAction::Removed:
+                for (const auto& coin : items)
+                    m_SpendableCoins.m_Map.erase(coin.m_ID);
+                break;
+
+            case ChangeAction::Reset:
+                m_SpendableCoins.Reset();
+            }
+        }
+
         for (const auto sub : m_subscribers)
         {
             sub->onCoinsChanged(action, items);
@@ -3380,6 +3743,10 @@ namespace beam::wallet
 
         stm.step();
 
+        for (auto& v : m_SpendableCoins.m_Map)
+            if (session == v.second.m_sessionId)
+                v.second.m_sessionId = EmptyCoinSession;
+
         return sqlite3_changes(_db) > 0;
     }
 
@@ -191,6 +191,51 @@ namespace beam::wallet
         ByteBuffer m_value;
     };
 
+    // Page of the coins. Everything except the status filter is done in SQL
+    struct CoinsQuery
+    {
+        // filters, ignored if not set
+        boost::optional<Coin::Status> m_Status;
+        boost::optional<Asset::ID> m_AssetID;
+        boost::optional<Amount> m_AmountMin; // inclusive
+        boost::optional<Amount> m_AmountMax; // inclusive
+
+        enum class Order
+        {
+            Default, // creation order
+            AmountAsc, // ties by asset and key ID
+            AmountDesc
+        };
+        Order m_Order = Order::Default;
+
+        // keyset pagination: set to the last coin of the previous page. For the default order this coin must still exist, otherwise DatabaseException is thrown
+        boost::optional<Coin::ID> m_After;
+
+        uint64_t m_Skip = 0;
+        uint32_t m_Count = std::numeric_limits<uint32_t>::max();
+    };
+
+    // Page of the transaction history, newest first (txs created at the same time are ordered by ID)
+    struct TxHistoryQuery
+    {
+        // filters, ignored if not set
+        boost::optional<TxType> m_Type;
+        boost::optional<TxStatus> m_Status;
+        boost::optional<Asset::ID> m_AssetID;
+        boost::optional<Height> m_KernelProofHeight;
+
+        // keyset pagination: set to the last tx of the previous page. Unlike m_Skip it doesn't slow down on deep pages
+        struct Key
+        {
+            Timestamp m_CreateTime;
+            TxID m_TxID;
+        };
+        boost::optional<Key> m_After;
+
+        uint64_t m_Skip = 0;
+        uint32_t m_Count = std::numeric_limits<uint32_t>::max();
+    };
+
     // Outgoing wallet messages sent through SBBS (used in Cold Wallet)
     struct OutgoingWalletMessage
     {
@@ -319,6 +364,9 @@ namespace beam::wallet
 		// returns false if callback asked to stop verification.
 		bool ImportRecovery(const std::string& path, IRecoveryProgress&);
 
+		// recovers several wallets in a single pass over the recovery data
+		static bool ImportRecovery(const std::string& path, const std::vector<IWalletDB*>&, IRecoveryProgress&);
+
         // Allocates new Key ID, used for generation of the blinding factor
         // Will return the next id starting from a random base created during wallet initialization
         virtual uint64_t AllocateKidRange(uint64_t nCount) = 0;
@@ -348,6 +396,7 @@ namespace beam::wallet
 
         // Generic visitor to iterate over coin collection
         virtual void visitCoins(std::function<bool(const Coin& coin)> func) = 0;
+        virtual void visitCoins(const CoinsQuery&, std::function<bool(const Coin& coin)> func) = 0;
 
         // Used in split API for session management
         virtual bool lockCoins(const CoinIDList& list, uint64_t session) = 0;
@@ -364,6 +413,7 @@ namespace beam::wallet
         // /////////////////////////////////////////////
         // Transaction management
         virtual std::vector<TxDescription> getTxHistory(wallet::TxType txType = wallet::TxType::Simple, uint64_t start = 0, int count = std::numeric_limits<int>::max()) const = 0;
+        virtual std::vector<TxDescription> getTxHistory(const TxHistoryQuery&) const = 0;
         virtual boost::optional<TxDescription> getTx(const TxID& txId) const = 0;
         virtual void saveTx(const TxDescription& p) = 0;
         virtual void deleteTx(const TxID& txId) = 0;
@@ -469,6 +519,7 @@ namespace beam::wallet
         void clearCoins() override;
 
         void visitCoins(std::function<bool(const Coin& coin)> func) override;
+        void visitCoins(const CoinsQuery&, std::function<bool(const Coin& coin)> func) override;
 
         void setVarRaw(const char* name, const void* data, size_t size) override;
         bool getVarRaw(const char* name, void* data, int size) const override;
@@ -482,6 +533,7 @@ namespace beam::wallet
         void rollbackConfirmedUtxo(Height minHeight) override;
 
         std::vector<TxDescription> getTxHistory(wallet::TxType txType, uint64_t start, int count) const override;
+        std::vector<TxDescription> getTxHistory(const TxHistoryQuery&) const override;
         boost::optional<TxDescription> getTx(const TxID& txId) const override;
         void saveTx(const TxDescription& p) override;
         void deleteTx(const TxID& txId) override;
@@ -555,6 +607,7 @@ namespace beam::wallet
         void saveCoinRaw(const Coin&);
         std::vector<Coin> getCoinsByRowIDs(const std::vector<int>& rowIDs) const;
         std::vector<Coin> getUpdatedCoins(const std::vector<Coin>& coins) const;
+        void loadSpendableCoins();
         // ////////////////////////////////////////
         // Cache for optimized access for database fields
         using ParameterCache = std::map<TxID, std::map<SubTxID, std::map<TxParameterID, boost::optional<ByteBuffer>>>>;
@@ -562,6 +615,7 @@ namespace beam::wallet
         void insertParameterToCache(const TxID& txID, SubTxID subTxID, TxParameterID paramID, const boost::optional<ByteBuffer>& blob) const;
         void deleteParametersFromCache(const TxID& txID);
         bool hasTransaction(const TxID& txID) const;
+        void updateTxSummary(const TxID& txID);
         void insertAddressToCache(const WalletID& id, const boost::optional<WalletAddress>& address) const;
         void deleteAddressFromCache(const WalletID& id);
         void flushDB();
@@ -600,6 +654,22 @@ namespace beam::wallet
         mutable ParameterCache m_TxParametersCache;
         mutable std::map<WalletID, boost::optional<WalletAddress>> m_AddressesCache;
 
+        // Confirmed unspent coins, ordered by asset and amount, for the coin selection.
+        // Loaded on the first selection, then maintained in notifyCoinsChanged. Maturity and locks by ongoing txs are checked when selecting
+        struct SpendableCoins
+        {
+            struct Cmp {
+                bool operator() (const Coin::ID&, const Coin::ID&) const;
+            };
+
+            typedef std::map<Coin::ID, Coin, Cmp> Map;
+            Map m_Map;
+            bool m_Loaded = false;
+
+            void OnChanged(const Coin&); // inserts, updates or removes, depending on the coin state
+            void Reset();
+        } m_SpendableCoins;
+
         struct LocalKeyKeeper;
         LocalKeyKeeper* m_pLocalKeyKeeper = nullptr;
     };
@@ -677,6 +747,7 @@ namespace beam::wallet
 
         Coin::Status GetCoinStatus(const IWalletDB&, const Coin&, Height hTop);
         void DeduceStatus(const IWalletDB&, Coin&, Height hTop);
+        bool IsOngoingTx(const IWalletDB&, const boost::optional<TxID>& txID);
 
         // Used in statistics
         struct Totals
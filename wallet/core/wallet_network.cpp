@@ -13,6 +13,8 @@
 // limitations under the License.
 
 #include "wallet_network.h"
+#include "utility/executor.h"
+#include <chrono>
 
 using namespace std;
 
@@ -20,6 +22,7 @@ namespace
 {
     const char* BBS_TIMESTAMPS = "BbsTimestamps";
     const unsigned AddressUpdateInterval_ms = 60 * 1000; // check addresses every minute
+    const size_t ParallelDecryptMin = 256; // smaller channels are decrypted on the calling thread
 
     beam::BbsChannel channel_from_wallet_id(const beam::wallet::WalletID& walletID)
     {
@@ -34,6 +37,29 @@ namespace beam::wallet {
 
     ///////////////////////////
 
+    struct BaseMessageEndpoint::DecryptExecutor
+        :public ExecutorMT
+    {
+        virtual uint32_t get_Threads() override
+        {
+            return std::max(std::thread::hardware_concurrency(), 1U);
+        }
+
+        virtual void RunThread(uint32_t iThread) override
+        {
+            ExecutorMT::Context ctx;
+            ctx.m_iThread = iThread;
+            RunThreadCtx(ctx);
+        }
+
+        ~DecryptExecutor() { Stop(); }
+    };
+
+    double BaseMessageEndpoint::Stats::get_MessagesPerSec() const
+    {
+        return m_Time_us ? (m_Messages * 1e6 / m_Time_us) : 0.;
+    }
+
     BaseMessageEndpoint::BaseMessageEndpoint(IWalletMessageConsumer& w, const IWalletDB::Ptr& pWalletDB)
         : m_Wallet(w)
         , m_WalletDB(pWalletDB)
@@ -69,51 +95,78 @@ namespace beam::wallet {
         Addr::Channel key;
         key.m_Value = channel;
 
-        for (ChannelSet::iterator it = m_Channels.lower_bound(key); ; ++it)
+        ChannelSet::iterator it = m_Channels.lower_bound(key);
+        if ((m_Channels.end() == it) || (it->m_Value != channel))
+            return;
+
+        if (!m_pKdfSbbs)
         {
-            if (m_Channels.end() == it)
-                break;
-            if (it->m_Value != channel)
-                break; // as well
+            // read-only wallet
+            m_WalletDB->saveIncomingWalletMessage(channel, msg);
+            OnIncomingMessage();
+            return;
+        }
 
+        auto t0 = std::chrono::steady_clock::now();
 
-            if (!m_pKdfSbbs)
-            {
-                // read-only wallet
-                m_WalletDB->saveIncomingWalletMessage(channel, msg);
-                OnIncomingMessage();
-                return;
-            }
+        m_vDecryptKeys.clear();
+        m_vDecryptAddrs.clear();
+
+        for (; (m_Channels.end() != it) && (it->m_Value == channel); ++it)
+        {
+            const Addr& addr = it->get_ParentObj();
+            m_vDecryptAddrs.push_back(&addr);
 
-            ByteBuffer buf = msg; // duplicate
-            uint8_t* pMsg = &buf.front();
-            uint32_t nSize = static_cast<uint32_t>(buf.size());
+            proto::Bbs::KeyRef& kr = m_vDecryptKeys.emplace_back();
+            kr.m_pSk = &addr.m_sk;
+            kr.m_pPk = &addr.m_Pk;
+        }
 
-            if (!proto::Bbs::Decrypt(pMsg, nSize, it->get_ParentObj().m_sk))
-                continue;
+        uint32_t nKeys = static_cast<uint32_t>(m_vDecryptKeys.size());
 
-            SetTxParameter msgWallet;
-            bool bValid = false;
+        ByteBuffer buf = msg; // duplicate once, decrypted in-place
+        uint8_t* pMsg = &buf.front();
+        uint32_t nSize = static_cast<uint32_t>(buf.size());
 
-            try {
-                Deserializer der;
-                der.reset(pMsg, nSize);
-                der& msgWallet;
-                bValid = true;
-            }
-            catch (const std::exception&) {
-                LOG_WARNING() << "BBS deserialization failed";
-            }
+        uint32_t iKey;
+        if (nKeys >= ParallelDecryptMin)
+        {
+            if (!m_pDecryptExecutor)
+                m_pDecryptExecutor = std::make_unique<DecryptExecutor>();
 
-            if (bValid)
-            {
-                WalletID wid;
-                wid.m_Pk = it->get_ParentObj().m_Pk;
-                wid.m_Channel = it->m_Value;
-                m_Wallet.OnWalletMessage(wid, msgWallet);
-                break;
-            }
+            Executor::Scope scope(*m_pDecryptExecutor);
+            iKey = proto::Bbs::DecryptMulti(pMsg, nSize, &m_vDecryptKeys.front(), nKeys);
+        }
+        else
+            iKey = proto::Bbs::DecryptMulti(pMsg, nSize, &m_vDecryptKeys.front(), nKeys);
+
+        m_Stats.m_Messages++;
+        m_Stats.m_Attempts += (iKey < nKeys) ? (iKey + 1) : nKeys;
+        m_Stats.m_Time_us += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0).count();
+
+        if (iKey >= nKeys)
+            return;
+
+        m_Stats.m_Decrypted++;
+
+        SetTxParameter msgWallet;
+
+        try {
+            Deserializer der;
+            der.reset(pMsg, nSize);
+            der& msgWallet;
+        }
+        catch (const std::exception&) {
+            LOG_WARNING() << "BBS deserialization failed";
+            return;
         }
+
+        const Addr& addr = *m_vDecryptAddrs[iKey];
+
+        WalletID wid;
+        wid.m_Pk = addr.m_Pk;
+        wid.m_Channel = addr.m_Channel.m_Value;
+        m_Wallet.OnWalletMessage(wid, msgWallet);
     }
 
     void BaseMessageEndpoint::AddOwnAddress(const WalletAddress& address)
@@ -233,6 +286,10 @@ namespace beam::wallet {
         {
             DeleteAddr(*address);
         }
+
+        if (m_Stats.m_Messages)
+            LOG_DEBUG() << "BBS: " << m_Stats.m_Messages << " msgs, " << m_Stats.m_Decrypted << " decrypted, " << m_Stats.m_Attempts << " attempts, " << m_Stats.get_MessagesPerSec() << " msgs/sec";
+
         m_AddressExpirationTimer->start(AddressUpdateInterval_ms, false, [this] { OnAddressTimer(); });
     }
 
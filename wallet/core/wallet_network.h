@@ -58,6 +58,18 @@ namespace beam::wallet
         virtual ~BaseMessageEndpoint();
         void AddOwnAddress(const WalletAddress& address);
         void DeleteOwnAddress(uint64_t ownID);
+
+        struct Stats
+        {
+            uint64_t m_Messages = 0; // received on own channels
+            uint64_t m_Decrypted = 0;
+            uint64_t m_Attempts = 0; // addresses tried
+            uint64_t m_Time_us = 0; // spent on processing
+
+            double get_MessagesPerSec() const;
+        };
+
+        const Stats& get_Stats() const { return m_Stats; }
     protected:
         void ProcessMessage(BbsChannel channel, const ByteBuffer& msg);
         void Subscribe();
@@ -84,6 +96,14 @@ namespace beam::wallet
         IWalletDB::Ptr m_WalletDB;
         Key::IKdf::Ptr m_pKdfSbbs;
         io::Timer::Ptr m_AddressExpirationTimer;
+
+        // trial decryption for channels with many addresses is spread across the cores
+        struct DecryptExecutor;
+        std::unique_ptr<DecryptExecutor> m_pDecryptExecutor;
+        std::vector<proto::Bbs::KeyRef> m_vDecryptKeys; // reused
+        std::vector<const Addr*> m_vDecryptAddrs;
+
+        Stats m_Stats;
     };
 
     class WalletNetworkViaBbs
@@ -58,6 +58,7 @@ using namespace beam::wallet;
 namespace beam::wallet
 {
     io::Address node_addr;
+    proto::FlyClient::NetworkShared::Ptr node_net;
 
     WalletServiceApi::WalletServiceApi(IWalletServiceApiHandler& handler, ACL acl)
         : WalletApi(handler, acl)
@@ -642,24 +643,8 @@ namespace
 
                 _wallet->ResumeAllTransactions();
 
-                auto nnet = std::make_shared<proto::FlyClient::NetworkStd>(*_wallet);
-                nnet->m_Cfg.m_PollPeriod_ms = 0;//options.pollPeriod_ms.value;
-            
-                if (nnet->m_Cfg.m_PollPeriod_ms)
-                {
-                    LOG_INFO() << "Node poll period = " << nnet->m_Cfg.m_PollPeriod_ms << " ms";
-                    uint32_t timeout_ms = std::max(Rules::get().DA.Target_s * 1000, nnet->m_Cfg.m_PollPeriod_ms);
-                    if (timeout_ms != nnet->m_Cfg.m_PollPeriod_ms)
-                    {
-                        LOG_INFO() << "Node poll period has been automatically rounded up to block rate: " << timeout_ms << " ms";
-                    }
-                }
-                uint32_t responceTime_s = Rules::get().DA.Target_s * wallet::kDefaultTxResponseTime;
-                if (nnet->m_Cfg.m_PollPeriod_ms >= responceTime_s * 1000)
-                {
-                    LOG_WARNING() << "The \"--node_poll_period\" parameter set to more than " << uint32_t(responceTime_s / 3600) << " hours may cause transaction problems.";
-                }
-                nnet->m_Cfg.m_vNodes.push_back(node_addr);
+                // all the wallets share the node connection(s) and the header chain
+                auto nnet = std::make_shared<proto::FlyClient::NetworkShared::Endpoint>(node_net, *_wallet);
                 nnet->Connect();
 
                 auto wnet = std::make_shared<WalletNetworkViaBbs>(*_wallet, nnet, _walletDB);
@@ -831,10 +816,33 @@ int main(int argc, char* argv[])
 
         LogRotation logRotation(*reactor, LOG_ROTATION_PERIOD, 5);//options.logCleanupPeriod);
 
+        node_net = std::make_shared<proto::FlyClient::NetworkShared>();
+        auto& nnet = node_net->m_Net;
+        nnet.m_Cfg.m_PollPeriod_ms = 0;//options.pollPeriod_ms.value;
+
+        if (nnet.m_Cfg.m_PollPeriod_ms)
+        {
+            LOG_INFO() << "Node poll period = " << nnet.m_Cfg.m_PollPeriod_ms << " ms";
+            uint32_t timeout_ms = std::max(Rules::get().DA.Target_s * 1000, nnet.m_Cfg.m_PollPeriod_ms);
+            if (timeout_ms != nnet.m_Cfg.m_PollPeriod_ms)
+            {
+                LOG_INFO() << "Node poll period has been automatically rounded up to block rate: " << timeout_ms << " ms";
+            }
+        }
+        uint32_t responceTime_s = Rules::get().DA.Target_s * wallet::kDefaultTxResponseTime;
+        if (nnet.m_Cfg.m_PollPeriod_ms >= responceTime_s * 1000)
+        {
+            LOG_WARNING() << "The \"--node_poll_period\" parameter set to more than " << uint32_t(responceTime_s / 3600) << " hours may cause transaction problems.";
+        }
+        nnet.m_Cfg.m_vNodes.push_back(node_addr);
+        nnet.Connect();
+
         LOG_INFO() << "Starting server on port " << options.port;
         WalletApiServer server(reactor, options.port);
         reactor->run();
 
+        node_net.reset(); // the wallets still opened keep it alive
+
         LOG_INFO() << "Done";
     }
     catch (const std::exception& e)
@@ -165,6 +165,8 @@ namespace
             void onMessage(const JsonRpcId& id, const GetUtxo& data) override
             {
                 WALLET_CHECK(id > 0);
+                WALLET_CHECK(data.count == GetUtxo::MaxCount); // bounded by default
+                WALLET_CHECK(data.skip == 0);
             }
         };
 
@@ -207,6 +209,50 @@ namespace
         }
     }
 
+    void testGetUtxoFilterJsonRpc()
+    {
+        class WalletApiHandler : public WalletApiHandlerBase
+        {
+        public:
+
+            void onInvalidJsonRpc(const json& msg) override
+            {
+                WALLET_CHECK(!"invalid get_utxo api json!!!");
+
+                cout << msg["error"] << endl;
+            }
+
+            void onMessage(const JsonRpcId& id, const GetUtxo& data) override
+            {
+                WALLET_CHECK(id > 0);
+
+                WALLET_CHECK(data.skip == 10);
+                WALLET_CHECK(data.count == 5);
+                WALLET_CHECK(*data.filter.status == Coin::Status::Available);
+                WALLET_CHECK(*data.filter.assetId == 3);
+                WALLET_CHECK(*data.filter.minAmount == 100);
+                WALLET_CHECK(!data.filter.maxAmount);
+                WALLET_CHECK(data.order == CoinsQuery::Order::AmountDesc);
+                WALLET_CHECK(data.after && data.after->m_Value == 1234 && data.after->m_Idx == 132);
+            }
+        };
+
+        Coin coin{ Amount(1234) };
+        coin.m_ID.m_Idx = 132;
+
+        std::string msg =
+            "{\"jsonrpc\":\"2.0\", \"id\":12345, \"method\":\"get_utxo\", \"params\":{"
+            "\"skip\":10, \"count\":5,"
+            "\"filter\":{\"status\":1, \"asset_id\":3, \"min_amount\":100},"
+            "\"sort\":{\"field\":\"amount\", \"direction\":\"desc\"},"
+            "\"after\":\"" + coin.toStringID() + "\"}}";
+
+        WalletApiHandler handler;
+        WalletApi api(handler);
+
+        WALLET_CHECK(api.parse(msg.data(), msg.size()));
+    }
+
     void testSendJsonRpc(const std::string& msg)
     {
         class WalletApiHandler : public WalletApiHandlerBase
@@ -530,12 +576,59 @@ namespace
 
                 WALLET_CHECK(data.skip == 10);
                 WALLET_CHECK(data.count == 10);
+                WALLET_CHECK(!data.after);
+            }
+        };
+
+        WalletApiHandler handler;
+        WalletApi api(handler);
+
+        WALLET_CHECK(api.parse(msg.data(), msg.size()));
+    }
+
+    void testTxListAfterJsonRpc()
+    {
+        class WalletApiHandler : public WalletApiHandlerBase
+        {
+        public:
+
+            void onInvalidJsonRpc(const json& msg) override
+            {
+                WALLET_CHECK(!"invalid list api json!!!");
+
+                cout << msg["error"] << endl;
+            }
+
+            void onMessage(const JsonRpcId& id, const TxList& data) override
+            {
+                WALLET_CHECK(id > 0);
+
+                WALLET_CHECK(data.count == 10);
+                WALLET_CHECK(data.after);
+                WALLET_CHECK(data.after->m_CreateTime == 1585000000);
+                WALLET_CHECK(to_hex(data.after->m_TxID.data(), data.after->m_TxID.size()) == "10c4b760c842433cb58339a0fafef3db");
             }
         };
 
         WalletApiHandler handler;
         WalletApi api(handler);
 
+        std::string msg = JSON_CODE(
+        {
+            "jsonrpc": "2.0",
+            "id" : 12345,
+            "method" : "tx_list",
+            "params" :
+            {
+                "count" : 10,
+                "after" :
+                {
+                    "create_time" : 1585000000,
+                    "txId" : "10c4b760c842433cb58339a0fafef3db"
+                }
+            }
+        });
+
         WALLET_CHECK(api.parse(msg.data(), msg.size()));
     }
 
@@ -726,6 +819,25 @@ int main()
         "method" : "get_utxo"
     }));
 
+    testGetUtxoFilterJsonRpc();
+
+    testInvalidJsonRpc([](const json& msg)
+    {
+        testErrorHeaderWithId(msg);
+
+        WALLET_CHECK(msg["id"] == 12345);
+        WALLET_CHECK(msg["error"]["code"] == ApiError::InvalidJsonRpc);
+    }, JSON_CODE(
+    {
+        "jsonrpc": "2.0",
+        "id" : 12345,
+        "method" : "get_utxo",
+        "params" :
+        {
+            "count" : 1001
+        }
+    }));
+
     testSendJsonRpc(JSON_CODE(
     {
         "jsonrpc": "2.0",
@@ -1022,6 +1134,28 @@ int main()
         }
     }));
 
+    testTxListAfterJsonRpc();
+
+    testInvalidJsonRpc([](const json& msg)
+    {
+        testErrorHeaderWithId(msg);
+
+        WALLET_CHECK(msg["id"] == 12345);
+        WALLET_CHECK(msg["error"]["code"] == ApiError::InvalidParamsJsonRpc);
+    }, JSON_CODE(
+    {
+        "jsonrpc": "2.0",
+        "id" : 12345,
+        "method" : "tx_list",
+        "params" :
+        {
+            "after" :
+            {
+                "txId" : "10c4b760c842433cb58339a0fafef3db"
+            }
+        }
+    }));
+
     testValidateAddressJsonRpc(JSON_CODE(
     {
         "jsonrpc": "2.0",
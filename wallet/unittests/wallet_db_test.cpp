@@ -364,6 +364,90 @@ void TestStoreTxRecord()
     WALLET_CHECK(t.size() == 0);
 }
 
+void TestTxHistory()
+{
+    cout << "\nWallet database tx history test\n";
+    auto walletDB = createSqliteWalletDB();
+
+    TxDescription tr(TxID{});
+    tr.m_amount = 34;
+    tr.m_myId.m_Pk = unsigned(42);
+    tr.m_myId.m_Channel = 0U;
+    tr.m_sender = true;
+
+    const uint8_t count = 30;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        tr.m_txId = {{ i }};
+        tr.m_createTime = 1000 + i / 2; // pairs with the same time
+        tr.m_txType = (i % 3) ? TxType::Simple : TxType::AssetIssue;
+        tr.m_status = (i % 5) ? TxStatus::Completed : TxStatus::InProgress;
+        tr.m_assetId = (i % 3) ? 0 : 4;
+        WALLET_CHECK_NO_THROW(walletDB->saveTx(tr));
+    }
+
+    // newest first, then by ID
+    TxHistoryQuery q;
+    auto t = walletDB->getTxHistory(q);
+    WALLET_CHECK(t.size() == count);
+    for (size_t i = 1; i < t.size(); ++i)
+    {
+        WALLET_CHECK(t[i - 1].m_createTime >= t[i].m_createTime);
+        if (t[i - 1].m_createTime == t[i].m_createTime)
+            WALLET_CHECK(t[i - 1].m_txId < t[i].m_txId);
+    }
+    WALLET_CHECK(t[0].m_txId[0] == 28 && t[1].m_txId[0] == 29);
+
+    // keyset pagination visits all of them once, in the same order
+    {
+        q.m_Count = 7;
+        size_t n = 0;
+        for (bool bMore = true; bMore; )
+        {
+            auto page = walletDB->getTxHistory(q);
+            for (const auto& tx : page)
+            {
+                WALLET_CHECK(n < t.size() && tx.m_txId == t[n].m_txId);
+                n++;
+            }
+
+            bMore = (page.size() == q.m_Count);
+            if (bMore)
+                q.m_After = TxHistoryQuery::Key{ page.back().m_createTime, page.back().m_txId };
+        }
+        WALLET_CHECK(n == count);
+    }
+
+    // filters
+    q = TxHistoryQuery();
+    q.m_Type = TxType::AssetIssue;
+    t = walletDB->getTxHistory(q);
+    WALLET_CHECK(t.size() == 10);
+    for (const auto& tx : t)
+        WALLET_CHECK(tx.m_txType == TxType::AssetIssue && tx.m_assetId == 4);
+
+    q.m_Status = TxStatus::InProgress;
+    t = walletDB->getTxHistory(q);
+    WALLET_CHECK(t.size() == 2); // 0, 15
+    WALLET_CHECK(t[0].m_txId[0] == 15 && t[1].m_txId[0] == 0);
+
+    // the summary follows the parameter changes
+    storage::setTxParameter(*walletDB, t[0].m_txId, TxParameterID::Status, TxStatus::Failed, true);
+    t = walletDB->getTxHistory(q);
+    WALLET_CHECK(t.size() == 1 && t[0].m_txId[0] == 0);
+
+    q = TxHistoryQuery();
+    q.m_KernelProofHeight = 177;
+    WALLET_CHECK(walletDB->getTxHistory(q).empty());
+    storage::setTxParameter(*walletDB, t[0].m_txId, TxParameterID::KernelProofHeight, Height(177), true);
+    t = walletDB->getTxHistory(q);
+    WALLET_CHECK(t.size() == 1 && t[0].m_txId[0] == 0);
+
+    walletDB->deleteTx(t[0].m_txId);
+    WALLET_CHECK(walletDB->getTxHistory(q).empty());
+    WALLET_CHECK(walletDB->getTxHistory(TxType::ALL).size() == count - 1);
+}
+
 void TestUTXORollback()
 {
     cout << "\nWallet database rollback test\n";
@@ -1213,6 +1297,180 @@ void TestSelect6()
     }
 }
 
+void TestSelect7()
+{
+    cout << "\nWallet database coin selection 7 test\n";
+    auto db = createSqliteWalletDB();
+    const uint32_t count = 100000;
+    const Asset::ID assetId = 3;
+
+    vector<Coin> coins;
+    coins.reserve(count);
+
+    for (uint32_t i = 1; i <= count; ++i)
+    {
+        Coin coin = CreateAvailCoin(Amount(1000 + rand() % 100000));
+        if (!(i % 4))
+            coin.m_ID.m_AssetID = assetId;
+        coins.push_back(coin);
+    }
+
+    db->storeCoins(coins);
+
+    // the first selection loads the index
+    SelectCoins(db, 450'678'910, false);
+
+    const uint32_t nSelections = 100;
+    helpers::StopWatch sw;
+    sw.start();
+    for (uint32_t i = 0; i < nSelections; ++i)
+    {
+        auto selected = db->selectCoins(10'000 + i * 1'000, (i & 1) ? assetId : 0);
+        WALLET_CHECK(!selected.empty());
+    }
+    sw.stop();
+    cout << "Average selection time: " << sw.microseconds() / nSelections << " us\n";
+
+    // the index must follow the coin changes
+    auto selected = db->selectCoins(150'000, assetId);
+    WALLET_CHECK(!selected.empty());
+    for (const auto& coin : selected)
+    {
+        WALLET_CHECK(coin.m_ID.m_AssetID == assetId);
+        WALLET_CHECK(coin.m_status == Coin::Status::Available);
+    }
+
+    for (auto& coin : selected)
+        coin.m_spentHeight = 120;
+    db->saveCoins(selected);
+
+    for (const auto& coin : db->selectCoins(150'000, assetId))
+    {
+        for (const auto& spent : selected)
+            WALLET_CHECK(coin.m_ID.m_Idx != spent.m_ID.m_Idx);
+    }
+
+    Coin big = CreateAvailCoin(5'000'000'000, 140);
+    db->storeCoin(big);
+    WALLET_CHECK(db->selectCoins(4'000'000'000, 0).empty()); // not mature yet
+
+    Block::SystemState::ID id = { };
+    id.m_Height = 140;
+    db->setSystemStateID(id);
+    selected = db->selectCoins(4'000'000'000, 0);
+    WALLET_CHECK(selected.size() == 1 && selected[0].m_ID.m_Idx == big.m_ID.m_Idx);
+
+    db->removeCoin(big.m_ID);
+    WALLET_CHECK(db->selectCoins(4'000'000'000, 0).empty());
+}
+
+void TestCoinsQuery()
+{
+    cout << "\nWallet database coins query test\n";
+    auto db = createSqliteWalletDB();
+
+    vector<Coin> coins;
+    for (uint32_t i = 1; i <= 20; ++i)
+    {
+        Coin coin = CreateAvailCoin(Amount(i * 10));
+        if (!(i % 4))
+            coin.m_ID.m_AssetID = 2;
+        if (!(i % 5))
+            coin.m_spentHeight = 130;
+        coins.push_back(coin);
+    }
+    db->storeCoins(coins);
+
+    auto getPage = [&db](const CoinsQuery& q)
+    {
+        vector<Coin> res;
+        db->visitCoins(q, [&res](const Coin& c)
+        {
+            res.push_back(c);
+            return true;
+        });
+        return res;
+    };
+
+    CoinsQuery q;
+    auto v = getPage(q);
+    WALLET_CHECK(v.size() == 20);
+    WALLET_CHECK(v[0].m_ID.m_Value == 10 && v[19].m_ID.m_Value == 200); // creation order
+
+    q.m_Status = Coin::Status::Spent;
+    v = getPage(q);
+    WALLET_CHECK(v.size() == 4);
+    for (const auto& c : v)
+        WALLET_CHECK(c.m_status == Coin::Status::Spent);
+
+    // the page is counted after the status check
+    q.m_Skip = 1;
+    q.m_Count = 2;
+    v = getPage(q);
+    WALLET_CHECK(v.size() == 2 && v[0].m_ID.m_Value == 100 && v[1].m_ID.m_Value == 150);
+
+    q = CoinsQuery();
+    q.m_AssetID = 2;
+    q.m_AmountMin = 50;
+    q.m_AmountMax = 160;
+    q.m_Order = CoinsQuery::Order::AmountDesc;
+    v = getPage(q);
+    WALLET_CHECK(v.size() == 3 && v[0].m_ID.m_Value == 160 && v[2].m_ID.m_Value == 80);
+
+    // bounds beyond int64 don't wrap
+    q.m_AmountMax = std::numeric_limits<Amount>::max();
+    WALLET_CHECK(getPage(q).size() > 3);
+    q.m_AmountMin = std::numeric_limits<Amount>::max();
+    WALLET_CHECK(getPage(q).empty());
+
+    // keyset pagination, both orders
+    for (auto order : { CoinsQuery::Order::Default, CoinsQuery::Order::AmountAsc, CoinsQuery::Order::AmountDesc })
+    {
+        q = CoinsQuery();
+        q.m_Order = order;
+        auto all = getPage(q);
+        WALLET_CHECK(all.size() == 20);
+
+        q.m_Count = 3;
+        size_t n = 0;
+        for (bool bMore = true; bMore; )
+        {
+            auto page = getPage(q);
+            for (const auto& c : page)
+            {
+                WALLET_CHECK(n < all.size() && c.m_ID.m_Value == all[n].m_ID.m_Value);
+                n++;
+            }
+
+            bMore = (page.size() == q.m_Count);
+            if (bMore)
+                q.m_After = page.back().m_ID;
+        }
+        WALLET_CHECK(n == all.size());
+    }
+
+    // the cursor coin is gone. The default order can't be located, which must not look like the end of the list
+    q = CoinsQuery();
+    q.m_Count = 3;
+    auto page = getPage(q);
+    db->removeCoin(page.back().m_ID);
+    q.m_After = page.back().m_ID;
+
+    bool bThrown = false;
+    try
+    {
+        getPage(q);
+    }
+    catch (const DatabaseException&)
+    {
+        bThrown = true;
+    }
+    WALLET_CHECK(bThrown);
+
+    q.m_Order = CoinsQuery::Order::AmountAsc; // doesn't need the coin
+    WALLET_CHECK(getPage(q).size() == 3);
+}
+
 void TestWalletMessages()
 {
     cout << "\nWallet database wallet messages test\n";
@@ -1389,6 +1647,7 @@ int main()
     TestWalletDataBase();
     TestStoreCoins();
     TestStoreTxRecord();
+    TestTxHistory();
     TestTxRollback();
     TestUTXORollback();
     TestSelect();
@@ -1397,6 +1656,8 @@ int main()
     TestSelect4();
     TestSelect5();
     TestSelect6();
+    TestSelect7();
+    TestCoinsQuery();
     TestAddresses();
     TestExportImportTx();
     TestTxParameters();